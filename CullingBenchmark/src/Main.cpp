@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "VulkanPlayground/Graphics/Culling.h"
+
+using namespace VKPlayground;
+
+// Times scalar and SIMD frustum culling at 10k, 100k and 1M boxes, fails if the two paths don't see the same boxes
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	std::vector<CullingBenchmarkResult> results = Culling::RunBenchmark();
+
+	bool passed = true;
+	for (const CullingBenchmarkResult& result : results)
+	{
+		LOG_INFO("{0} boxes: {1} visible, {2} is {3:.2f}x the scalar throughput, {4} mismatches", result.BoxCount, result.VisibleCount,
+			Culling::GetInstructionSet(), result.SIMDBoxesPerSecond / result.ScalarBoxesPerSecond, result.MismatchCount);
+
+		passed = passed && result.MismatchCount == 0;
+	}
+
+	if (!passed)
+		LOG_ERROR("SIMD and scalar culling results differ");
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "pch.h"
+#include "VulkanPlayground/Graphics/MeshImporter.h"
+#include "VulkanPlayground/Graphics/MeshFile.h"
+#include "VulkanPlayground/Core/JobSystem.h"
+
+using namespace VKPlayground;
+
+static std::string GetOutputPath(const std::string& inputPath)
+{
+	size_t extension = inputPath.find_last_of('.');
+	size_t separator = inputPath.find_last_of("/\\");
+
+	if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+		return inputPath + ".vpmesh";
+
+	return inputPath.substr(0, extension) + ".vpmesh";
+}
+
+// Cooks a .gltf or .glb into a .vpmesh next to it, or into the output path if one is given
+int main(int argc, char** argv)
+{
+	Log::Init();
+
+	if (argc < 2 || argc > 3)
+	{
+		LOG_ERROR("Usage: MeshCooker <input.gltf|input.glb> [output.vpmesh]");
+		return 1;
+	}
+
+	std::string inputPath = argv[1];
+	std::string outputPath = argc == 3 ? argv[2] : GetOutputPath(inputPath);
+
+	// Primitives are encoded in parallel
+	JobSystem::Init();
+
+	bool result = false;
+	{
+		MeshImporter importer(inputPath);
+
+		// The importer logged why, don't leave an empty mesh file behind
+		if (importer.IsLoaded())
+			result = MeshFile::Write(outputPath, importer);
+		else
+			LOG_ERROR("Failed to cook {0}", inputPath);
+
+		if (result)
+		{
+			LOG_INFO("Cooked {0} into {1} ({2} vertices, {3} 16-bit and {4} 32-bit indices, {5} submeshes, {6} meshlets, {7} LODs, {8} nodes, {9} submesh instances)", inputPath, outputPath,
+				importer.GetVertexCount(), importer.GetIndexCount(VK_INDEX_TYPE_UINT16), importer.GetIndexCount(VK_INDEX_TYPE_UINT32), importer.GetSubMeshes().size(),
+				importer.GetMeshlets().size(), importer.GetLODs().size(), importer.GetNodes().size(), importer.GetSubMeshInstances().size());
+		}
+	}
+
+	JobSystem::Shutdown();
+
+	return result ? 0 : 1;
+}
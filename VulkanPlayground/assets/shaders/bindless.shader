@@ -0,0 +1,71 @@
+#Shader Vertex
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec4 a_Normal;
+layout(location = 3) in vec2 a_TexCoord;
+
+// Per instance
+layout(location = 4) in mat4 a_Transform;
+
+layout(location = 0) out vec3 v_Normal;
+layout(location = 1) out vec2 v_TexCoord;
+layout(location = 2) flat out uint v_Material;
+
+layout(set = 0, binding = 0) uniform CameraBuffer
+{
+    mat4 ViewProjection;
+    mat4 InverseViewProjection;
+} u_CameraBuffer;
+
+// Global bindless arrays, see BindlessDescriptors
+layout(set = 1, binding = 1) readonly buffer MaterialIndices
+{
+    uint Data[];
+} s_Buffers[];
+
+// Set once per command buffer, gl_InstanceIndex includes firstInstance so it addresses the instance slot directly
+layout(push_constant) uniform PushConstants
+{
+    uint MaterialBuffer;
+    uint MaterialOffset;
+} u_PushConstants;
+
+// Normals and tangents are octahedral encoded in the RG channels of an A2B10G10R10_UNORM attribute
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -t : t, normal.y >= 0.0 ? -t : t);
+    return normalize(normal);
+}
+
+void main() 
+{
+    gl_Position = u_CameraBuffer.ViewProjection * a_Transform * vec4(a_Position, 1.0);
+    v_Normal = DecodeOctahedral(a_Normal.xy);
+    v_TexCoord = a_TexCoord;
+    v_Material = s_Buffers[u_PushConstants.MaterialBuffer].Data[u_PushConstants.MaterialOffset + uint(gl_InstanceIndex)];
+}
+
+#Shader Fragment
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 v_Normal;
+layout(location = 1) in vec2 v_TexCoord;
+layout(location = 2) flat in uint v_Material;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 1, binding = 0) uniform sampler2D u_Textures[];
+
+void main() 
+{
+    vec3 albedo = texture(u_Textures[nonuniformEXT(v_Material)], v_TexCoord).rgb;
+    outColor.rgb = albedo * (v_Normal * 0.5 + 0.5);
+    outColor.a = 1.0;
+}
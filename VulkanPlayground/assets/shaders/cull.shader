@@ -0,0 +1,159 @@
+#Shader Compute
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct CullInstance
+{
+    mat4 Transform;
+    vec4 BoundsMin;
+    vec4 BoundsMax;
+    uint BatchIndex;
+    uint MeshletBatch; // ~0u if the batch is drawn as a whole
+};
+
+struct DrawCommand
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+layout(set = 0, binding = 0) uniform CullBuffer
+{
+    mat4 ViewProjection;
+    mat4 PreviousViewProjection;
+    vec4 FrustumPlanes[6];
+    vec4 CameraPosition;
+    vec4 DepthSize; // xy: depth attachment size, z: Hi-Z mip count
+    uint InstanceCount;
+    uint OcclusionEnabled;
+} u_CullBuffer;
+
+// r_ blocks are slices of the renderer's ring buffers, bound as dynamic storage buffers so the descriptor set stays the same every frame
+layout(set = 0, binding = 1) readonly buffer Instances
+{
+    CullInstance Data[];
+} r_Instances;
+
+layout(set = 0, binding = 2) buffer DrawCommands
+{
+    DrawCommand Data[];
+} r_DrawCommands;
+
+layout(set = 0, binding = 3) writeonly buffer VisibleInstances
+{
+    mat4 Data[];
+} s_VisibleInstances;
+
+layout(set = 0, binding = 4) uniform sampler2D u_HiZ;
+
+// Indirect dispatch of meshlet_cull.shader, one row of workgroups per visible instance of a meshlet batch
+layout(set = 0, binding = 5) buffer MeshletDispatch
+{
+    uint GroupCountX;
+    uint GroupCountY;
+    uint GroupCountZ;
+} r_MeshletDispatch;
+
+// Instance slot and meshlet batch of every appended instance
+layout(set = 0, binding = 6) writeonly buffer MeshletInstances
+{
+    uvec2 Data[];
+} s_MeshletInstances;
+
+vec4 GetCorner(CullInstance instance, int index)
+{
+    vec3 corner = vec3((index & 1) != 0 ? instance.BoundsMax.x : instance.BoundsMin.x,
+                       (index & 2) != 0 ? instance.BoundsMax.y : instance.BoundsMin.y,
+                       (index & 4) != 0 ? instance.BoundsMax.z : instance.BoundsMin.z);
+
+    return instance.Transform * vec4(corner, 1.0);
+}
+
+bool IsInsideFrustum(CullInstance instance)
+{
+    // The box is outside if all eight corners are outside the same clip plane
+    uvec4 outsideSides = uvec4(0);
+    uint outsideFar = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 clip = u_CullBuffer.ViewProjection * GetCorner(instance, i);
+
+        outsideSides += uvec4(clip.x < -clip.w, clip.x > clip.w, clip.y < -clip.w, clip.y > clip.w);
+        outsideFar += uint(clip.z > clip.w);
+    }
+
+    return all(lessThan(outsideSides, uvec4(8))) && outsideFar < 8;
+}
+
+bool IsOccluded(CullInstance instance)
+{
+    // Project into last frame's view since the Hi-Z pyramid was built from last frame's depth
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearestDepth = 1.0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 clip = u_CullBuffer.PreviousViewProjection * GetCorner(instance, i);
+
+        // Boxes crossing the near plane can't be projected, treat them as visible
+        if (clip.w <= 0.0)
+            return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = clamp(ndc.xy * 0.5 + 0.5, 0.0, 1.0);
+
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+
+    // Pick the mip where the box covers at most 2x2 texels, a texel of mip N covers 2^(N + 1) depth pixels
+    vec2 depthSize = u_CullBuffer.DepthSize.xy;
+    vec2 extent = (uvMax - uvMin) * depthSize;
+    int mipCount = int(u_CullBuffer.DepthSize.z);
+    int mip = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))) - 1, 0, mipCount - 1);
+
+    ivec2 mipMax = textureSize(u_HiZ, mip) - 1;
+    ivec2 texelMin = min(ivec2(uvMin * depthSize) >> (mip + 1), mipMax);
+    ivec2 texelMax = min(ivec2(uvMax * depthSize) >> (mip + 1), mipMax);
+
+    float farthestDepth = texelFetch(u_HiZ, texelMin, mip).r;
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, ivec2(texelMax.x, texelMin.y), mip).r);
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, ivec2(texelMin.x, texelMax.y), mip).r);
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, texelMax, mip).r);
+
+    return nearestDepth > farthestDepth;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= u_CullBuffer.InstanceCount)
+        return;
+
+    CullInstance instance = r_Instances.Data[index];
+
+    if (!IsInsideFrustum(instance))
+        return;
+
+    if (u_CullBuffer.OcclusionEnabled != 0 && IsOccluded(instance))
+        return;
+
+    // Compact surviving instances to the front of their batch's instance range
+    uint batchIndex = instance.BatchIndex;
+    uint slot = r_DrawCommands.Data[batchIndex].FirstInstance + atomicAdd(r_DrawCommands.Data[batchIndex].InstanceCount, 1);
+    s_VisibleInstances.Data[slot] = instance.Transform;
+
+    // The batch's own command isn't drawn, its meshlets are culled again and drawn from the meshlet pass's output
+    if (instance.MeshletBatch != ~0u)
+    {
+        uint meshletInstance = atomicAdd(r_MeshletDispatch.GroupCountY, 1);
+        s_MeshletInstances.Data[meshletInstance] = uvec2(slot, instance.MeshletBatch);
+    }
+}
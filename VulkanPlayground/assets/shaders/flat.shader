@@ -0,0 +1,37 @@
+#Shader Vertex
+#version 450
+
+layout(location = 0) in vec3 a_Position;
+
+// Per instance
+layout(location = 4) in mat4 a_Transform;
+
+layout(location = 0) out vec3 v_WorldPosition;
+
+layout(set = 0, binding = 0) uniform CameraBuffer
+{
+    mat4 ViewProjection;
+    mat4 InverseViewProjection;
+} u_CameraBuffer;
+
+void main() 
+{
+    vec4 worldPosition = a_Transform * vec4(a_Position, 1.0);
+    gl_Position = u_CameraBuffer.ViewProjection * worldPosition;
+    v_WorldPosition = worldPosition.xyz;
+}
+
+#Shader Fragment
+#version 450
+
+layout(location = 0) in vec3 v_WorldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main() 
+{
+    // Face normal from screen space derivatives
+    vec3 normal = normalize(cross(dFdx(v_WorldPosition), dFdy(v_WorldPosition)));
+    outColor.rgb = abs(normal);
+    outColor.a = 1.0;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#Shader Compute
+#version 450
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D u_Source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D u_Destination;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 destinationSize = imageSize(u_Destination);
+    if (any(greaterThanEqual(coord, destinationSize)))
+        return;
+
+    // Mip sizes round down, so the last texel of an odd sized source row or column also covers the leftover texel
+    ivec2 sourceSize = textureSize(u_Source, 0);
+    ivec2 sourceStart = coord * 2;
+    ivec2 sourceEnd = min(sourceStart + 1 + ivec2(equal(coord, destinationSize - 1)) * (sourceSize & 1), sourceSize - 1);
+
+    // Keep the farthest depth of the footprint so the pyramid never reports something as closer than it is
+    float depth = 0.0;
+    for (int y = sourceStart.y; y <= sourceEnd.y; y++)
+    {
+        for (int x = sourceStart.x; x <= sourceEnd.x; x++)
+        {
+            depth = max(depth, texelFetch(u_Source, ivec2(x, y), 0).r);
+        }
+    }
+
+    imageStore(u_Destination, coord, vec4(depth));
+}
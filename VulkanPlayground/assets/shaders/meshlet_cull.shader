@@ -0,0 +1,187 @@
+#Shader Compute
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(local_size_x = 64) in;
+
+struct Meshlet
+{
+    vec4 BoundingSphere;
+    vec4 NormalCone;
+    uint FirstIndex;
+    uint IndexCount;
+    uint VertexCount;
+    uint Padding;
+};
+
+struct MeshletBatch
+{
+    uint MeshletBuffer;
+    uint MeshletOffset;
+    uint MeshletCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstDraw;
+    uint ConeCulling;
+    uint Padding;
+};
+
+struct DrawCommand
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int VertexOffset;
+    uint FirstInstance;
+};
+
+layout(set = 0, binding = 0) uniform CullBuffer
+{
+    mat4 ViewProjection;
+    mat4 PreviousViewProjection;
+    vec4 FrustumPlanes[6];
+    vec4 CameraPosition;
+    vec4 DepthSize; // xy: depth attachment size, z: Hi-Z mip count
+    uint InstanceCount;
+    uint OcclusionEnabled;
+} u_CullBuffer;
+
+// r_ blocks are slices of the renderer's ring buffers, bound as dynamic storage buffers so the descriptor set stays the same every frame
+layout(set = 0, binding = 1) readonly buffer MeshletBatches
+{
+    MeshletBatch Data[];
+} r_MeshletBatches;
+
+// Instance slot and meshlet batch of every visible instance, appended by cull.shader
+layout(set = 0, binding = 2) readonly buffer MeshletInstances
+{
+    uvec2 Data[];
+} s_MeshletInstances;
+
+layout(set = 0, binding = 3) readonly buffer VisibleInstances
+{
+    mat4 Data[];
+} s_VisibleInstances;
+
+layout(set = 0, binding = 4) uniform sampler2D u_HiZ;
+
+layout(set = 0, binding = 5) writeonly buffer MeshletDraws
+{
+    DrawCommand Data[];
+} s_MeshletDraws;
+
+layout(set = 0, binding = 6) buffer MeshletDrawCounts
+{
+    uint Data[];
+} r_MeshletDrawCounts;
+
+// Global bindless arrays, see BindlessDescriptors. Every invocation of a workgroup reads the same batch, so the index is uniform.
+layout(set = 1, binding = 1) readonly buffer Meshlets
+{
+    Meshlet Data[];
+} s_Buffers[];
+
+bool IsInsideFrustum(vec3 center, float radius)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(u_CullBuffer.FrustumPlanes[i].xyz, center) + u_CullBuffer.FrustumPlanes[i].w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+bool IsBackfacing(vec3 center, float radius, vec3 axis, float cutoff)
+{
+    // Every triangle faces away if the view direction to the sphere lies inside the cone mirrored behind it
+    vec3 direction = center - u_CullBuffer.CameraPosition.xyz;
+    return dot(direction, axis) >= cutoff * length(direction) + radius;
+}
+
+bool IsOccluded(vec3 center, float radius)
+{
+    // Same test as cull.shader on the box around the sphere, projected into last frame's view
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearestDepth = 1.0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = u_CullBuffer.PreviousViewProjection * vec4(corner, 1.0);
+
+        if (clip.w <= 0.0)
+            return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = clamp(ndc.xy * 0.5 + 0.5, 0.0, 1.0);
+
+        uvMin = min(uvMin, uv);
+        uvMax = max(uvMax, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+
+    vec2 depthSize = u_CullBuffer.DepthSize.xy;
+    vec2 extent = (uvMax - uvMin) * depthSize;
+    int mipCount = int(u_CullBuffer.DepthSize.z);
+    int mip = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))) - 1, 0, mipCount - 1);
+
+    ivec2 mipMax = textureSize(u_HiZ, mip) - 1;
+    ivec2 texelMin = min(ivec2(uvMin * depthSize) >> (mip + 1), mipMax);
+    ivec2 texelMax = min(ivec2(uvMax * depthSize) >> (mip + 1), mipMax);
+
+    float farthestDepth = texelFetch(u_HiZ, texelMin, mip).r;
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, ivec2(texelMax.x, texelMin.y), mip).r);
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, ivec2(texelMin.x, texelMax.y), mip).r);
+    farthestDepth = max(farthestDepth, texelFetch(u_HiZ, texelMax, mip).r);
+
+    return nearestDepth > farthestDepth;
+}
+
+void main()
+{
+    // One row of workgroups per visible instance, sized for the batch with the most meshlets
+    uvec2 meshletInstance = s_MeshletInstances.Data[gl_WorkGroupID.y];
+    MeshletBatch batch = r_MeshletBatches.Data[meshletInstance.y];
+
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= batch.MeshletCount)
+        return;
+
+    Meshlet meshlet = s_Buffers[batch.MeshletBuffer].Data[batch.MeshletOffset + index];
+    mat4 transform = s_VisibleInstances.Data[meshletInstance.x];
+
+    // Scaling the radius by the longest axis keeps the sphere conservative under non-uniform scale
+    vec3 scale = vec3(length(transform[0].xyz), length(transform[1].xyz), length(transform[2].xyz));
+    vec3 center = (transform * vec4(meshlet.BoundingSphere.xyz, 1.0)).xyz;
+    float radius = meshlet.BoundingSphere.w * max(scale.x, max(scale.y, scale.z));
+
+    if (!IsInsideFrustum(center, radius))
+        return;
+
+    // The cone angle only survives uniform scale, mirroring transforms flip which side of a triangle is the front
+    bool uniformScale = max(scale.x, max(scale.y, scale.z)) <= min(scale.x, min(scale.y, scale.z)) * 1.001;
+    if (batch.ConeCulling != 0 && meshlet.NormalCone.w < 1.0 && uniformScale)
+    {
+        vec3 axis = normalize(mat3(transform) * meshlet.NormalCone.xyz);
+        if (determinant(mat3(transform)) < 0.0)
+            axis = -axis;
+
+        if (IsBackfacing(center, radius, axis, meshlet.NormalCone.w))
+            return;
+    }
+
+    if (u_CullBuffer.OcclusionEnabled != 0 && IsOccluded(center, radius))
+        return;
+
+    uint draw = atomicAdd(r_MeshletDrawCounts.Data[meshletInstance.y], 1u);
+
+    DrawCommand command;
+    command.IndexCount = meshlet.IndexCount;
+    command.InstanceCount = 1;
+    command.FirstIndex = batch.FirstIndex + meshlet.FirstIndex;
+    command.VertexOffset = batch.VertexOffset;
+    command.FirstInstance = meshletInstance.x;
+    s_MeshletDraws.Data[batch.FirstDraw + draw] = command;
+}
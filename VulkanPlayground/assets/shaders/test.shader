@@ -2,16 +2,12 @@
 #version 450
 
 layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec3 a_Normal;
-layout(location = 2) in vec3 a_Tangent;
-layout(location = 3) in vec2 a_TexCoord;
+layout(location = 1) in vec4 a_Normal;
 
-layout(location = 0) out vec3 v_Normal;
+// Per instance
+layout(location = 4) in mat4 a_Transform;
 
-layout(push_constant) uniform constants
-{
-    mat4 Transform;
-} PushConstants;
+layout(location = 0) out vec3 v_Normal;
 
 layout(set = 0, binding = 0) uniform CameraBuffer
 {
@@ -19,10 +15,21 @@ layout(set = 0, binding = 0) uniform CameraBuffer
     mat4 InverseViewProjection;
 } u_CameraBuffer;
 
+// Normals and tangents are octahedral encoded in the RG channels of an A2B10G10R10_UNORM attribute
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -t : t, normal.y >= 0.0 ? -t : t);
+    return normalize(normal);
+}
+
 void main() 
 {
-    gl_Position = u_CameraBuffer.ViewProjection * PushConstants.Transform * vec4(a_Position, 1.0);
-    v_Normal = a_Normal;
+    gl_Position = u_CameraBuffer.ViewProjection * a_Transform * vec4(a_Position, 1.0);
+    v_Normal = DecodeOctahedral(a_Normal.xy);
 }
 
 #Shader Fragment
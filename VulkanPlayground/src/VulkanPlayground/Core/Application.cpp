@@ -1,6 +1,11 @@
 #include "pch.h"
 #include "Application.h"
 #include "VulkanPlayground/Graphics/VulkanAllocator.h"
+#include "VulkanPlayground/Graphics/VulkanUploadQueue.h"
+#include "VulkanPlayground/Graphics/BindlessDescriptors.h"
+#include "VulkanPlayground/Graphics/GeometryArena.h"
+#include "VulkanPlayground/Graphics/PipelineCache.h"
+#include "VulkanPlayground/Core/JobSystem.h"
 #include <imgui.h>
 
 namespace VKPlayground {
@@ -24,10 +29,15 @@ namespace VKPlayground {
 		m_Renderer.reset();
 		m_ImGUILayer.reset();
 		m_SwapChain.reset();
+		PipelineCache::Shutdown();
+		BindlessDescriptors::Shutdown();
+		GeometryArena::Shutdown();
+		VulkanUploadQueue::Shutdown();
 		VulkanAllocator::Shutdown();
 		m_Device.reset();
 		m_Window.reset();
 		m_VulkanInstance.reset();
+		JobSystem::Shutdown();
 	}
 
 	void Application::Init()
@@ -36,6 +46,7 @@ namespace VKPlayground {
 		s_Instance = this;
 
 		Log::Init();
+		JobSystem::Init();
 		
 		m_Window = CreateRef<Window>(m_Name, 1280, 720);
 		m_VulkanInstance = CreateRef<VulkanInstance>(m_Name);
@@ -46,6 +57,10 @@ namespace VKPlayground {
 		m_SwapChain = CreateRef<VulkanSwapChain>();
 
 		VulkanAllocator::Init(m_Device);
+		VulkanUploadQueue::Init(m_Device);
+		BindlessDescriptors::Init(m_Device);
+		GeometryArena::Init(m_Device);
+		PipelineCache::Init(m_Device);
 
 		m_Renderer = CreateRef<Renderer>();
 		
@@ -95,6 +110,9 @@ namespace VKPlayground {
 			Render();
 
 			m_Renderer->EndFrame();
+
+			// Submit this frame's buffer uploads ahead of the frame itself
+			VulkanUploadQueue::Flush();
 			m_SwapChain->Present();
 		}
 
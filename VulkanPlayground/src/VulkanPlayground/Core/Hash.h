@@ -0,0 +1,36 @@
+#pragma once
+
+namespace VKPlayground {
+
+	namespace Hash {
+
+		static constexpr uint64_t FNVOffsetBasis = 14695981039346656037ull;
+		static constexpr uint64_t FNVPrime = 1099511628211ull;
+
+		// 64-bit FNV-1a, pass a previous result as hash to chain multiple inputs together
+		inline uint64_t FNV1a(const void* data, size_t size, uint64_t hash = FNVOffsetBasis)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= FNVPrime;
+			}
+
+			return hash;
+		}
+
+		inline uint64_t FNV1a(const std::string& string, uint64_t hash = FNVOffsetBasis)
+		{
+			return FNV1a(string.data(), string.size(), hash);
+		}
+
+		template<typename T>
+		inline uint64_t Combine(uint64_t hash, const T& value)
+		{
+			return FNV1a(&value, sizeof(T), hash);
+		}
+
+	}
+
+}
@@ -0,0 +1,305 @@
+#include "pch.h"
+#include "JobSystem.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+namespace VKPlayground {
+
+	struct Job
+	{
+		JobFunction Function;
+		JobCounter* Counter = nullptr;
+		const JobCounter* Dependency = nullptr;
+	};
+
+	// The owning thread pushes and pops at the back, other threads steal from the front
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	struct JobSystemData
+	{
+		std::vector<std::thread> Workers;
+		std::vector<Scope<WorkQueue>> Queues;
+
+		// Jobs waiting for their dependency to finish
+		std::mutex DeferredMutex;
+		std::vector<Job> DeferredJobs;
+
+		// Low priority jobs shared by all workers
+		std::mutex BackgroundMutex;
+		std::deque<Job> BackgroundJobs;
+
+		std::atomic<uint32_t> QueuedJobs = 0;
+		std::atomic<uint32_t> QueuedBackgroundJobs = 0;
+		std::atomic<bool> Running = true;
+
+		std::mutex WakeMutex;
+		std::condition_variable WakeCondition;
+	};
+
+	static JobSystemData* s_Data = nullptr;
+
+	static const uint32_t s_InvalidThreadIndex = UINT32_MAX;
+	static thread_local uint32_t s_ThreadIndex = s_InvalidThreadIndex;
+
+	namespace Utils {
+
+		static void Push(Job&& job)
+		{
+			// Threads that don't belong to the system hand their jobs to the main thread's queue
+			uint32_t queueIndex = s_ThreadIndex != s_InvalidThreadIndex ? s_ThreadIndex : 0;
+
+			{
+				WorkQueue& queue = *s_Data->Queues[queueIndex];
+				std::lock_guard<std::mutex> lock(queue.Mutex);
+				queue.Jobs.push_back(std::move(job));
+			}
+
+			s_Data->QueuedJobs++;
+
+			// Take the lock so a worker can't miss the wake up between checking QueuedJobs and going to sleep
+			{
+				std::lock_guard<std::mutex> lock(s_Data->WakeMutex);
+			}
+			s_Data->WakeCondition.notify_one();
+		}
+
+		static bool TryPop(Job& outJob)
+		{
+			uint32_t queueCount = (uint32_t)s_Data->Queues.size();
+
+			// Newest job from our own queue first, its data is most likely still in cache
+			if (s_ThreadIndex != s_InvalidThreadIndex)
+			{
+				WorkQueue& queue = *s_Data->Queues[s_ThreadIndex];
+				std::lock_guard<std::mutex> lock(queue.Mutex);
+				if (!queue.Jobs.empty())
+				{
+					outJob = std::move(queue.Jobs.back());
+					queue.Jobs.pop_back();
+					s_Data->QueuedJobs--;
+					return true;
+				}
+			}
+
+			// Steal the oldest job of another thread, starting with our neighbour to spread out contention
+			uint32_t start = s_ThreadIndex != s_InvalidThreadIndex ? s_ThreadIndex + 1 : 0;
+			for (uint32_t i = 0; i < queueCount; i++)
+			{
+				uint32_t victim = (start + i) % queueCount;
+				if (victim == s_ThreadIndex)
+					continue;
+
+				WorkQueue& queue = *s_Data->Queues[victim];
+				std::lock_guard<std::mutex> lock(queue.Mutex);
+				if (!queue.Jobs.empty())
+				{
+					outJob = std::move(queue.Jobs.front());
+					queue.Jobs.pop_front();
+					s_Data->QueuedJobs--;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		static bool TryPopBackground(Job& outJob)
+		{
+			std::lock_guard<std::mutex> lock(s_Data->BackgroundMutex);
+			if (s_Data->BackgroundJobs.empty())
+				return false;
+
+			outJob = std::move(s_Data->BackgroundJobs.front());
+			s_Data->BackgroundJobs.pop_front();
+			s_Data->QueuedBackgroundJobs--;
+			return true;
+		}
+
+		static void ReleaseDeferredJobs()
+		{
+			std::vector<Job> readyJobs;
+
+			{
+				std::lock_guard<std::mutex> lock(s_Data->DeferredMutex);
+
+				auto& deferred = s_Data->DeferredJobs;
+				auto it = std::partition(deferred.begin(), deferred.end(), [](const Job& job) { return !job.Dependency->IsDone(); });
+				std::move(it, deferred.end(), std::back_inserter(readyJobs));
+				deferred.erase(it, deferred.end());
+			}
+
+			for (Job& job : readyJobs)
+			{
+				Push(std::move(job));
+			}
+		}
+
+		static void Execute(Job& job)
+		{
+			job.Function();
+
+			// The last job of a group may unblock jobs that depend on it
+			if (job.Counter && job.Counter->Value.fetch_sub(1) == 1)
+				ReleaseDeferredJobs();
+		}
+
+		static void WorkerLoop(uint32_t threadIndex)
+		{
+			s_ThreadIndex = threadIndex;
+
+			while (s_Data->Running)
+			{
+				Job job;
+				if (TryPop(job) || TryPopBackground(job))
+				{
+					Execute(job);
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(s_Data->WakeMutex);
+				s_Data->WakeCondition.wait(lock, []() { return !s_Data->Running || s_Data->QueuedJobs > 0 || s_Data->QueuedBackgroundJobs > 0; });
+			}
+		}
+
+	}
+
+	void JobSystem::Run(const JobFunction& job, JobCounter* counter, const JobCounter* dependency)
+	{
+		if (counter)
+			counter->Value++;
+
+		Job entry = { job, counter, dependency };
+
+		if (dependency && !dependency->IsDone())
+		{
+			std::lock_guard<std::mutex> lock(s_Data->DeferredMutex);
+
+			// Check again under the lock, the dependency may have finished and released the deferred list in the meantime
+			if (!dependency->IsDone())
+			{
+				s_Data->DeferredJobs.push_back(std::move(entry));
+				return;
+			}
+		}
+
+		Utils::Push(std::move(entry));
+	}
+
+	void JobSystem::RunBackground(const JobFunction& job, JobCounter* counter)
+	{
+		if (counter)
+			counter->Value++;
+
+		{
+			std::lock_guard<std::mutex> lock(s_Data->BackgroundMutex);
+			s_Data->BackgroundJobs.push_back({ job, counter, nullptr });
+		}
+
+		s_Data->QueuedBackgroundJobs++;
+
+		{
+			std::lock_guard<std::mutex> lock(s_Data->WakeMutex);
+		}
+		s_Data->WakeCondition.notify_one();
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task, uint32_t minGroupSize)
+	{
+		if (count == 0)
+			return;
+
+		// One group per thread unless that would make groups smaller than requested
+		uint32_t threadCount = GetThreadCount();
+		uint32_t groupSize = std::max((count + threadCount - 1) / threadCount, std::max(minGroupSize, 1u));
+
+		JobCounter counter;
+		for (uint32_t start = 0; start < count; start += groupSize)
+		{
+			uint32_t end = std::min(start + groupSize, count);
+			Run([&task, start, end]()
+			{
+				for (uint32_t i = start; i < end; i++)
+				{
+					task(i);
+				}
+			}, &counter);
+		}
+
+		Wait(counter);
+	}
+
+	void JobSystem::Wait(const JobCounter& counter)
+	{
+		while (!counter.IsDone())
+		{
+			Job job;
+			if (Utils::TryPop(job))
+				Utils::Execute(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	uint32_t JobSystem::GetThreadCount()
+	{
+		return (uint32_t)s_Data->Queues.size();
+	}
+
+	uint32_t JobSystem::GetThreadIndex()
+	{
+		return s_ThreadIndex;
+	}
+
+	void JobSystem::Init(uint32_t workerCount)
+	{
+		s_Data = new JobSystemData();
+
+		// Leave a core for the main thread, it runs jobs as well while it waits on them
+		if (workerCount == 0)
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		s_Data->Queues.resize(workerCount + 1);
+		for (auto& queue : s_Data->Queues)
+		{
+			queue = CreateScope<WorkQueue>();
+		}
+
+		s_ThreadIndex = 0;
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			s_Data->Workers.emplace_back(Utils::WorkerLoop, i + 1);
+		}
+
+		LOG_INFO("Initialized job system with {0} workers", workerCount);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_Data->WakeMutex);
+			s_Data->Running = false;
+		}
+
+		s_Data->WakeCondition.notify_all();
+
+		for (std::thread& worker : s_Data->Workers)
+		{
+			worker.join();
+		}
+
+		ASSERT(s_Data->DeferredJobs.empty(), "Job system shut down with jobs still waiting on dependencies");
+		ASSERT(s_Data->BackgroundJobs.empty(), "Job system shut down with background jobs still queued");
+
+		s_ThreadIndex = s_InvalidThreadIndex;
+
+		delete s_Data;
+		s_Data = nullptr;
+	}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+
+namespace VKPlayground {
+
+	// Number of unfinished jobs in a group, jobs can be made to wait on a counter reaching zero
+	struct JobCounter
+	{
+		std::atomic<uint32_t> Value = 0;
+
+		inline bool IsDone() const { return Value.load(std::memory_order_acquire) == 0; }
+	};
+
+	using JobFunction = std::function<void()>;
+
+	// Work-stealing scheduler shared by the whole engine, every worker owns a deque and steals from the others when it runs dry
+	class JobSystem
+	{
+	public:
+		// Queues a job, counter is incremented now and decremented once the job has finished.
+		// A job with a dependency is held back until that counter reaches zero.
+		static void Run(const JobFunction& job, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr);
+
+		// Queues a long running job that only workers pick up, and only once they have nothing else to do.
+		// Wait never runs these, so a frame waiting on its own jobs can't get stuck behind one.
+		static void RunBackground(const JobFunction& job, JobCounter* counter = nullptr);
+
+		// Calls task(index) for every index in [0, count) split into groups of at least minGroupSize, returns once all have finished
+		static void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task, uint32_t minGroupSize = 1);
+
+		// Runs queued jobs on the calling thread until the counter reaches zero
+		static void Wait(const JobCounter& counter);
+
+		// Workers plus the main thread
+		static uint32_t GetThreadCount();
+
+		// 0 on the main thread and 1 to GetThreadCount() - 1 on workers, other threads must not use per-thread resources
+		static uint32_t GetThreadIndex();
+
+	public:
+		static void Init(uint32_t workerCount = 0);
+		static void Shutdown();
+	};
+
+}
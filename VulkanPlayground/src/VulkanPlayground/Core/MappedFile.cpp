@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace VKPlayground {
+
+#ifdef _WIN32
+
+	MappedFile::MappedFile(const std::string& path)
+	{
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			LOG_WARN("Failed to open file for mapping: {0}", path);
+			return;
+		}
+
+		m_FileHandle = file;
+
+		LARGE_INTEGER size = {};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+			return;
+
+		m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_MappingHandle)
+		{
+			LOG_WARN("Failed to map file: {0}", path);
+			return;
+		}
+
+		m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		m_Size = m_Data ? (size_t)size.QuadPart : 0;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle)
+			CloseHandle(m_FileHandle);
+	}
+
+#else
+
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_FileDescriptor = open(path.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0)
+		{
+			LOG_WARN("Failed to open file for mapping: {0}", path);
+			return;
+		}
+
+		struct stat fileStat = {};
+		if (fstat(m_FileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+			return;
+
+		void* data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+		if (data == MAP_FAILED)
+		{
+			LOG_WARN("Failed to map file: {0}", path);
+			return;
+		}
+
+		// Meshes are read front to back once
+		madvise(data, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+		m_Data = static_cast<const uint8_t*>(data);
+		m_Size = (size_t)fileStat.st_size;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_Data)
+			munmap(const_cast<uint8_t*>(m_Data), m_Size);
+		if (m_FileDescriptor >= 0)
+			close(m_FileDescriptor);
+	}
+
+#endif
+
+}
\ No newline at end of file
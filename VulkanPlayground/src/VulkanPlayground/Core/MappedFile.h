@@ -0,0 +1,33 @@
+#pragma once
+
+namespace VKPlayground {
+
+	// Read-only view of a whole file mapped into memory, pages are read in by the OS on first access
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+	public:
+		inline bool IsValid() const { return m_Data != nullptr; }
+
+		inline const uint8_t* GetData() const { return m_Data; }
+		inline size_t GetSize() const { return m_Size; }
+
+	private:
+		const uint8_t* m_Data = nullptr;
+		size_t m_Size = 0;
+
+#ifdef _WIN32
+		void* m_FileHandle = nullptr;
+		void* m_MappingHandle = nullptr;
+#else
+		int m_FileDescriptor = -1;
+#endif
+	};
+
+}
\ No newline at end of file
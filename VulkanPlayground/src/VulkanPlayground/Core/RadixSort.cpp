@@ -0,0 +1,68 @@
+#include "pch.h"
+#include "RadixSort.h"
+
+namespace VKPlayground {
+
+	static const uint32_t s_DigitCount = 8;
+	static const uint32_t s_BucketCount = 256;
+
+	void RadixSort(const uint64_t* keys, uint32_t count, std::vector<uint32_t>& outIndices, std::vector<uint32_t>& scratch)
+	{
+		outIndices.resize(count);
+		scratch.resize(count);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			outIndices[i] = i;
+		}
+
+		if (count < 2)
+			return;
+
+		// Build histograms for every digit in a single pass over the keys
+		uint32_t histograms[s_DigitCount][s_BucketCount] = {};
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint64_t key = keys[i];
+			for (uint32_t digit = 0; digit < s_DigitCount; digit++)
+			{
+				histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+			}
+		}
+
+		uint32_t* src = outIndices.data();
+		uint32_t* dst = scratch.data();
+
+		for (uint32_t digit = 0; digit < s_DigitCount; digit++)
+		{
+			uint32_t* histogram = histograms[digit];
+			uint32_t shift = digit * 8;
+
+			// All keys share this digit, the pass would not change the order
+			if (histogram[(keys[src[0]] >> shift) & 0xFF] == count)
+				continue;
+
+			// Exclusive prefix sum turns counts into output offsets
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < s_BucketCount; bucket++)
+			{
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t index = src[i];
+				dst[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+			}
+
+			std::swap(src, dst);
+		}
+
+		// An odd number of passes leaves the result in scratch
+		if (src != outIndices.data())
+			outIndices.swap(scratch);
+	}
+
+}
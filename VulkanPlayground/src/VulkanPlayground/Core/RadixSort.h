@@ -0,0 +1,9 @@
+#pragma once
+
+namespace VKPlayground {
+
+	// Fills outIndices with the order that sorts keys ascending. LSD radix sort over 8-bit digits,
+	// digits that are identical for every key are skipped. Scratch is reused between calls to avoid allocations.
+	void RadixSort(const uint64_t* keys, uint32_t count, std::vector<uint32_t>& outIndices, std::vector<uint32_t>& scratch);
+
+}
@@ -0,0 +1,338 @@
+#include "pch.h"
+#include "TLSFAllocator.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		// Index of the highest set bit, value must not be 0
+		static uint32_t FindLastSet(uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse(&index, value);
+			return index;
+#else
+			return 31 - __builtin_clz(value);
+#endif
+		}
+
+		// Index of the lowest set bit, value must not be 0
+		static uint32_t FindFirstSet(uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return index;
+#else
+			return __builtin_ctz(value);
+#endif
+		}
+
+		static void MapSize(uint32_t size, uint32_t secondLevelBits, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+		{
+			// Sizes below the second level count each get their own list, above that every power of two is split linearly
+			uint32_t secondLevelCount = 1 << secondLevelBits;
+			if (size < secondLevelCount)
+			{
+				outFirstLevel = 0;
+				outSecondLevel = size;
+				return;
+			}
+
+			uint32_t highestBit = FindLastSet(size);
+			outFirstLevel = highestBit - secondLevelBits + 1;
+			outSecondLevel = (size >> (highestBit - secondLevelBits)) - secondLevelCount;
+		}
+
+		static uint32_t AlignUp(uint32_t offset, uint32_t alignment)
+		{
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+	}
+
+	TLSFAllocator::TLSFAllocator(uint32_t size)
+	{
+		Reset(size);
+	}
+
+	void TLSFAllocator::Reset(uint32_t size)
+	{
+		m_Nodes.clear();
+		m_UnusedNodes.clear();
+
+		m_FirstLevelBitmap = 0;
+		for (uint32_t i = 0; i < FirstLevelCount; i++)
+		{
+			m_SecondLevelBitmaps[i] = 0;
+			for (uint32_t j = 0; j < SecondLevelCount; j++)
+				m_FreeLists[i][j] = TLSFInvalidNode;
+		}
+
+		m_Capacity = size;
+		m_FreeSize = size;
+		m_AllocationCount = 0;
+
+		m_FirstNode = CreateNode(0, size);
+		m_LastNode = m_FirstNode;
+
+		if (size > 0)
+			InsertFree(m_FirstNode);
+	}
+
+	uint32_t TLSFAllocator::Allocate(uint32_t size, uint32_t alignment)
+	{
+		ASSERT(size > 0 && alignment > 0, "Invalid allocation size");
+
+		// Any block of size + alignment - 1 bytes has an aligned offset with size bytes behind it
+		uint64_t searchSize = (uint64_t)size + alignment - 1;
+		if (searchSize > m_FreeSize)
+			return TLSFInvalidNode;
+
+		uint32_t node = FindFree((uint32_t)searchSize);
+		if (node == TLSFInvalidNode)
+			return TLSFInvalidNode;
+
+		return Claim(node, size, alignment);
+	}
+
+	uint32_t TLSFAllocator::AllocateBelow(uint32_t size, uint32_t alignment, uint32_t limit)
+	{
+		ASSERT(size > 0 && alignment > 0, "Invalid allocation size");
+
+		for (uint32_t node = m_FirstNode; node != TLSFInvalidNode && m_Nodes[node].Offset < limit; node = m_Nodes[node].NextPhysical)
+		{
+			const Node& block = m_Nodes[node];
+			if (!block.Free)
+				continue;
+
+			uint64_t offset = Utils::AlignUp(block.Offset, alignment);
+			if (offset + size <= (uint64_t)block.Offset + block.Size && offset + size <= limit)
+				return Claim(node, size, alignment);
+		}
+
+		return TLSFInvalidNode;
+	}
+
+	void TLSFAllocator::Free(uint32_t node)
+	{
+		ASSERT(node < m_Nodes.size() && !m_Nodes[node].Free, "Freeing a node that isn't allocated");
+
+		m_FreeSize += m_Nodes[node].Size;
+		m_AllocationCount--;
+
+		// The lower block of a pair absorbs the upper one, so m_FirstNode never goes away
+		uint32_t next = m_Nodes[node].NextPhysical;
+		if (next != TLSFInvalidNode && m_Nodes[next].Free)
+		{
+			RemoveFree(next);
+			m_Nodes[node].Size += m_Nodes[next].Size;
+			m_Nodes[node].NextPhysical = m_Nodes[next].NextPhysical;
+			if (m_Nodes[node].NextPhysical != TLSFInvalidNode)
+				m_Nodes[m_Nodes[node].NextPhysical].PreviousPhysical = node;
+			else
+				m_LastNode = node;
+
+			ReleaseNode(next);
+		}
+
+		uint32_t previous = m_Nodes[node].PreviousPhysical;
+		if (previous != TLSFInvalidNode && m_Nodes[previous].Free)
+		{
+			RemoveFree(previous);
+			m_Nodes[previous].Size += m_Nodes[node].Size;
+			m_Nodes[previous].NextPhysical = m_Nodes[node].NextPhysical;
+			if (m_Nodes[previous].NextPhysical != TLSFInvalidNode)
+				m_Nodes[m_Nodes[previous].NextPhysical].PreviousPhysical = previous;
+			else
+				m_LastNode = previous;
+
+			ReleaseNode(node);
+			node = previous;
+		}
+
+		InsertFree(node);
+	}
+
+	uint32_t TLSFAllocator::GetLargestFreeBlock() const
+	{
+		if (m_FirstLevelBitmap == 0)
+			return 0;
+
+		// Blocks in the highest non-empty class can still differ in size, so that one list is scanned
+		uint32_t firstLevel = Utils::FindLastSet(m_FirstLevelBitmap);
+		uint32_t secondLevel = Utils::FindLastSet(m_SecondLevelBitmaps[firstLevel]);
+
+		uint32_t largest = 0;
+		for (uint32_t node = m_FreeLists[firstLevel][secondLevel]; node != TLSFInvalidNode; node = m_Nodes[node].NextFree)
+			largest = std::max(largest, m_Nodes[node].Size);
+
+		return largest;
+	}
+
+	uint32_t TLSFAllocator::GetUsedEnd() const
+	{
+		const Node& last = m_Nodes[m_LastNode];
+		return last.Free ? last.Offset : m_Capacity;
+	}
+
+	uint32_t TLSFAllocator::CreateNode(uint32_t offset, uint32_t size)
+	{
+		uint32_t node;
+		if (!m_UnusedNodes.empty())
+		{
+			node = m_UnusedNodes.back();
+			m_UnusedNodes.pop_back();
+		}
+		else
+		{
+			node = (uint32_t)m_Nodes.size();
+			m_Nodes.emplace_back();
+		}
+
+		m_Nodes[node] = Node();
+		m_Nodes[node].Offset = offset;
+		m_Nodes[node].Size = size;
+		return node;
+	}
+
+	void TLSFAllocator::ReleaseNode(uint32_t node)
+	{
+		m_UnusedNodes.push_back(node);
+	}
+
+	void TLSFAllocator::InsertFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		Utils::MapSize(m_Nodes[node].Size, SecondLevelBits, firstLevel, secondLevel);
+
+		Node& block = m_Nodes[node];
+		block.Free = true;
+		block.PreviousFree = TLSFInvalidNode;
+		block.NextFree = m_FreeLists[firstLevel][secondLevel];
+
+		if (block.NextFree != TLSFInvalidNode)
+			m_Nodes[block.NextFree].PreviousFree = node;
+
+		m_FreeLists[firstLevel][secondLevel] = node;
+		m_FirstLevelBitmap |= 1u << firstLevel;
+		m_SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	}
+
+	void TLSFAllocator::RemoveFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		Utils::MapSize(m_Nodes[node].Size, SecondLevelBits, firstLevel, secondLevel);
+
+		Node& block = m_Nodes[node];
+		if (block.PreviousFree != TLSFInvalidNode)
+			m_Nodes[block.PreviousFree].NextFree = block.NextFree;
+		else
+			m_FreeLists[firstLevel][secondLevel] = block.NextFree;
+
+		if (block.NextFree != TLSFInvalidNode)
+			m_Nodes[block.NextFree].PreviousFree = block.PreviousFree;
+
+		if (m_FreeLists[firstLevel][secondLevel] == TLSFInvalidNode)
+		{
+			m_SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (m_SecondLevelBitmaps[firstLevel] == 0)
+				m_FirstLevelBitmap &= ~(1u << firstLevel);
+		}
+
+		block.Free = false;
+		block.PreviousFree = TLSFInvalidNode;
+		block.NextFree = TLSFInvalidNode;
+	}
+
+	uint32_t TLSFAllocator::FindFree(uint32_t size) const
+	{
+		// Rounding up to the next class boundary makes every block of the class found below large enough
+		uint64_t roundedSize = size;
+		if (size >= SecondLevelCount)
+			roundedSize += (1u << (Utils::FindLastSet(size) - SecondLevelBits)) - 1;
+
+		uint32_t firstLevel, secondLevel;
+		if (roundedSize <= UINT32_MAX)
+		{
+			Utils::MapSize((uint32_t)roundedSize, SecondLevelBits, firstLevel, secondLevel);
+
+			uint32_t secondLevelMap = m_SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+			if (secondLevelMap == 0)
+			{
+				uint32_t firstLevelMap = firstLevel + 1 < FirstLevelCount ? m_FirstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+				if (firstLevelMap != 0)
+				{
+					firstLevel = Utils::FindFirstSet(firstLevelMap);
+					secondLevelMap = m_SecondLevelBitmaps[firstLevel];
+				}
+			}
+
+			if (secondLevelMap != 0)
+				return m_FreeLists[firstLevel][Utils::FindFirstSet(secondLevelMap)];
+		}
+
+		// Nothing in a larger class, the blocks of the request's own class can still fit it
+		Utils::MapSize(size, SecondLevelBits, firstLevel, secondLevel);
+		for (uint32_t node = m_FreeLists[firstLevel][secondLevel]; node != TLSFInvalidNode; node = m_Nodes[node].NextFree)
+		{
+			if (m_Nodes[node].Size >= size)
+				return node;
+		}
+
+		return TLSFInvalidNode;
+	}
+
+	uint32_t TLSFAllocator::Claim(uint32_t node, uint32_t size, uint32_t alignment)
+	{
+		RemoveFree(node);
+
+		uint32_t offset = Utils::AlignUp(m_Nodes[node].Offset, alignment);
+		uint32_t padding = offset - m_Nodes[node].Offset;
+
+		// The space in front of an aligned offset becomes its own free block, the block before it is never free
+		if (padding > 0)
+		{
+			uint32_t head = node;
+			node = CreateNode(offset, m_Nodes[head].Size - padding);
+			m_Nodes[head].Size = padding;
+
+			m_Nodes[node].PreviousPhysical = head;
+			m_Nodes[node].NextPhysical = m_Nodes[head].NextPhysical;
+			if (m_Nodes[node].NextPhysical != TLSFInvalidNode)
+				m_Nodes[m_Nodes[node].NextPhysical].PreviousPhysical = node;
+			else
+				m_LastNode = node;
+
+			m_Nodes[head].NextPhysical = node;
+			InsertFree(head);
+		}
+
+		if (m_Nodes[node].Size > size)
+		{
+			uint32_t tail = CreateNode(offset + size, m_Nodes[node].Size - size);
+			m_Nodes[node].Size = size;
+
+			m_Nodes[tail].PreviousPhysical = node;
+			m_Nodes[tail].NextPhysical = m_Nodes[node].NextPhysical;
+			if (m_Nodes[tail].NextPhysical != TLSFInvalidNode)
+				m_Nodes[m_Nodes[tail].NextPhysical].PreviousPhysical = tail;
+			else
+				m_LastNode = tail;
+
+			m_Nodes[node].NextPhysical = tail;
+
+			InsertFree(tail);
+		}
+
+		m_FreeSize -= size;
+		m_AllocationCount++;
+		return node;
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+namespace VKPlayground {
+
+	static constexpr uint32_t TLSFInvalidNode = ~0u;
+
+	// Two-level segregated fit allocator over a range of offsets, it never touches the memory it hands out.
+	// Free blocks are kept in lists by size class with a bitmap per level, so allocating and freeing are constant time.
+	// Neighbouring free blocks are merged on free, the returned node identifies the allocation until it is freed.
+	class TLSFAllocator
+	{
+	public:
+		TLSFAllocator(uint32_t size = 0);
+
+		void Reset(uint32_t size);
+
+		// Offset is a multiple of alignment, which doesn't have to be a power of two. TLSFInvalidNode if no free block fits.
+		uint32_t Allocate(uint32_t size, uint32_t alignment = 1);
+
+		// First fit from the start of the range for blocks ending at or below limit, used to compact allocations downwards
+		uint32_t AllocateBelow(uint32_t size, uint32_t alignment, uint32_t limit);
+
+		void Free(uint32_t node);
+
+		inline uint32_t GetOffset(uint32_t node) const { return m_Nodes[node].Offset; }
+		inline uint32_t GetSize(uint32_t node) const { return m_Nodes[node].Size; }
+
+		inline uint32_t GetCapacity() const { return m_Capacity; }
+		inline uint32_t GetFreeSize() const { return m_FreeSize; }
+		inline uint32_t GetAllocationCount() const { return m_AllocationCount; }
+
+		// Largest single allocation that would currently succeed without alignment
+		uint32_t GetLargestFreeBlock() const;
+
+		// Offset where the last allocated block ends, everything above it is one free block
+		uint32_t GetUsedEnd() const;
+
+	private:
+		static constexpr uint32_t SecondLevelBits = 4;
+		static constexpr uint32_t SecondLevelCount = 1 << SecondLevelBits;
+		static constexpr uint32_t FirstLevelCount = 32 - SecondLevelBits + 1;
+
+		// Blocks tile the whole range in offset order, free blocks are additionally linked into the list of their size class
+		struct Node
+		{
+			uint32_t Offset = 0;
+			uint32_t Size = 0;
+			uint32_t PreviousPhysical = TLSFInvalidNode;
+			uint32_t NextPhysical = TLSFInvalidNode;
+			uint32_t PreviousFree = TLSFInvalidNode;
+			uint32_t NextFree = TLSFInvalidNode;
+			bool Free = false;
+		};
+
+		uint32_t CreateNode(uint32_t offset, uint32_t size);
+		void ReleaseNode(uint32_t node);
+
+		void InsertFree(uint32_t node);
+		void RemoveFree(uint32_t node);
+		uint32_t FindFree(uint32_t size) const;
+
+		// Takes size bytes at the aligned offset out of a free block, the space around it goes back into the free lists
+		uint32_t Claim(uint32_t node, uint32_t size, uint32_t alignment);
+
+	private:
+		std::vector<Node> m_Nodes;
+		std::vector<uint32_t> m_UnusedNodes;
+
+		uint32_t m_FirstLevelBitmap = 0;
+		uint32_t m_SecondLevelBitmaps[FirstLevelCount] = {};
+		uint32_t m_FreeLists[FirstLevelCount][SecondLevelCount];
+
+		// The node at offset 0 always survives merges, so the physical list can be walked from it
+		uint32_t m_FirstNode = TLSFInvalidNode;
+		uint32_t m_LastNode = TLSFInvalidNode;
+
+		uint32_t m_Capacity = 0;
+		uint32_t m_FreeSize = 0;
+		uint32_t m_AllocationCount = 0;
+	};
+
+}
@@ -0,0 +1,277 @@
+#include "pch.h"
+#include "BindlessDescriptors.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/VulkanTools.h"
+#include <mutex>
+
+namespace VKPlayground {
+
+	static const uint32_t s_MaxImages = 4096;
+	static const uint32_t s_MaxBuffers = 1024;
+
+	static const uint32_t s_ImageBinding = 0;
+	static const uint32_t s_BufferBinding = 1;
+
+	struct ReleasedIndex
+	{
+		uint32_t Index;
+		uint64_t FrameNumber;
+	};
+
+	struct IndexAllocator
+	{
+		uint32_t Capacity = 0;
+		uint32_t NextIndex = 0;
+		std::vector<uint32_t> FreeIndices;
+		std::vector<ReleasedIndex> ReleasedIndices;
+	};
+
+	struct BindlessDescriptorsData
+	{
+		Ref<VulkanDevice> Device;
+		bool Supported = false;
+
+		VkDescriptorSetLayout DescriptorSetLayout = nullptr;
+		VkDescriptorPool DescriptorPool = nullptr;
+		VkDescriptorSet DescriptorSet = nullptr;
+
+		IndexAllocator Images;
+		IndexAllocator Buffers;
+		uint64_t FrameNumber = 0;
+
+		// Images and buffers can be created on loader threads
+		std::mutex Mutex;
+	};
+
+	static BindlessDescriptorsData* s_Data = nullptr;
+
+	namespace Utils {
+
+		static uint32_t AllocateIndex(IndexAllocator& allocator)
+		{
+			if (!allocator.FreeIndices.empty())
+			{
+				uint32_t index = allocator.FreeIndices.back();
+				allocator.FreeIndices.pop_back();
+				return index;
+			}
+
+			ASSERT(allocator.NextIndex < allocator.Capacity, "Out of bindless descriptor slots");
+			return allocator.NextIndex++;
+		}
+
+		static void RecycleIndices(IndexAllocator& allocator, uint32_t framesInFlight)
+		{
+			auto it = std::partition(allocator.ReleasedIndices.begin(), allocator.ReleasedIndices.end(), [framesInFlight](const ReleasedIndex& released)
+			{
+				return s_Data->FrameNumber - released.FrameNumber <= framesInFlight;
+			});
+
+			for (auto recycled = it; recycled != allocator.ReleasedIndices.end(); recycled++)
+			{
+				allocator.FreeIndices.push_back(recycled->Index);
+			}
+
+			allocator.ReleasedIndices.erase(it, allocator.ReleasedIndices.end());
+		}
+
+		static void WriteDescriptor(uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+		{
+			VkWriteDescriptorSet writeDescriptor = {};
+			writeDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptor.dstSet = s_Data->DescriptorSet;
+			writeDescriptor.dstBinding = binding;
+			writeDescriptor.dstArrayElement = index;
+			writeDescriptor.descriptorCount = 1;
+			writeDescriptor.descriptorType = type;
+			writeDescriptor.pImageInfo = imageInfo;
+			writeDescriptor.pBufferInfo = bufferInfo;
+
+			vkUpdateDescriptorSets(s_Data->Device->GetLogicalDevice(), 1, &writeDescriptor, 0, nullptr);
+		}
+
+	}
+
+	bool BindlessDescriptors::IsSupported()
+	{
+		return s_Data && s_Data->Supported;
+	}
+
+	uint32_t BindlessDescriptors::RegisterImage(const VkDescriptorImageInfo& imageInfo)
+	{
+		if (!IsSupported())
+			return BindlessInvalidIndex;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		uint32_t index = Utils::AllocateIndex(s_Data->Images);
+		Utils::WriteDescriptor(s_ImageBinding, index, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfo, nullptr);
+		return index;
+	}
+
+	uint32_t BindlessDescriptors::RegisterBuffer(const VkDescriptorBufferInfo& bufferInfo)
+	{
+		if (!IsSupported())
+			return BindlessInvalidIndex;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		uint32_t index = Utils::AllocateIndex(s_Data->Buffers);
+		Utils::WriteDescriptor(s_BufferBinding, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+		return index;
+	}
+
+	void BindlessDescriptors::UpdateBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo)
+	{
+		if (!IsSupported() || index == BindlessInvalidIndex)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		Utils::WriteDescriptor(s_BufferBinding, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+	}
+
+	void BindlessDescriptors::ReleaseImage(uint32_t index)
+	{
+		if (!IsSupported() || index == BindlessInvalidIndex)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		s_Data->Images.ReleasedIndices.push_back({ index, s_Data->FrameNumber });
+	}
+
+	void BindlessDescriptors::ReleaseBuffer(uint32_t index)
+	{
+		if (!IsSupported() || index == BindlessInvalidIndex)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		s_Data->Buffers.ReleasedIndices.push_back({ index, s_Data->FrameNumber });
+	}
+
+	void BindlessDescriptors::BeginFrame()
+	{
+		if (!IsSupported())
+			return;
+
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		s_Data->FrameNumber++;
+		Utils::RecycleIndices(s_Data->Images, framesInFlight);
+		Utils::RecycleIndices(s_Data->Buffers, framesInFlight);
+	}
+
+	VkDescriptorSetLayout BindlessDescriptors::GetDescriptorSetLayout()
+	{
+		return s_Data->DescriptorSetLayout;
+	}
+
+	VkDescriptorSet BindlessDescriptors::GetDescriptorSet()
+	{
+		return s_Data->DescriptorSet;
+	}
+
+	void BindlessDescriptors::Init(Ref<VulkanDevice> device)
+	{
+		s_Data = new BindlessDescriptorsData();
+		s_Data->Device = device;
+
+		const VkPhysicalDeviceFeatures& coreFeatures = device->GetEnabledFeatures();
+		const VkPhysicalDeviceVulkan12Features& features = device->GetEnabledVulkan12Features();
+		s_Data->Supported = features.descriptorIndexing && features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound &&
+			features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind &&
+			features.shaderSampledImageArrayNonUniformIndexing &&
+			coreFeatures.shaderSampledImageArrayDynamicIndexing && coreFeatures.shaderStorageBufferArrayDynamicIndexing;
+
+		if (!s_Data->Supported)
+		{
+			LOG_WARN("Descriptor indexing is not supported, bindless descriptors are disabled");
+			return;
+		}
+
+		// Keep the global arrays within what the device can bind after update
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(device->GetPhysicalDevice(), &properties);
+
+		s_Data->Images.Capacity = std::min(s_MaxImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+		s_Data->Buffers.Capacity = std::min(s_MaxBuffers, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+		VkDescriptorSetLayoutBinding bindings[2] = {};
+		bindings[0].binding = s_ImageBinding;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = s_Data->Images.Capacity;
+		bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+		bindings[1].binding = s_BufferBinding;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = s_Data->Buffers.Capacity;
+		bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+		// Unused slots may stay empty and slots can be written while the set is bound in frames in flight
+		VkDescriptorBindingFlags bindingFlags[2] =
+		{
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+		};
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = 2;
+		bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &bindingFlagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->GetLogicalDevice(), &layoutInfo, nullptr, &s_Data->DescriptorSetLayout));
+
+		VkDescriptorPoolSize poolSizes[] =
+		{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, s_Data->Images.Capacity },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, s_Data->Buffers.Capacity }
+		};
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 2;
+		poolInfo.pPoolSizes = poolSizes;
+
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device->GetLogicalDevice(), &poolInfo, nullptr, &s_Data->DescriptorPool));
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = s_Data->DescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &s_Data->DescriptorSetLayout;
+
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->GetLogicalDevice(), &allocInfo, &s_Data->DescriptorSet));
+
+		LOG_INFO("Initialized bindless descriptors with {0} image and {1} buffer slots", s_Data->Images.Capacity, s_Data->Buffers.Capacity);
+	}
+
+	void BindlessDescriptors::Shutdown()
+	{
+		VkDevice device = s_Data->Device->GetLogicalDevice();
+
+		if (s_Data->Supported)
+		{
+			vkDestroyDescriptorPool(device, s_Data->DescriptorPool, nullptr);
+			vkDestroyDescriptorSetLayout(device, s_Data->DescriptorSetLayout, nullptr);
+		}
+
+		delete s_Data;
+		s_Data = nullptr;
+	}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "VulkanPlayground/Core/Core.h"
+#include "VulkanDevice.h"
+#include <vulkan/vulkan.h>
+
+namespace VKPlayground {
+
+	static const uint32_t BindlessInvalidIndex = UINT32_MAX;
+
+	// One global update-after-bind descriptor set holding every sampled image and registered storage buffer.
+	// Shaders declare it as set BindlessDescriptors::SetIndex and index the arrays with IDs handed out here,
+	// so the set is bound once per command buffer instead of once per draw.
+	class BindlessDescriptors
+	{
+	public:
+		// Set number shaders use for the global arrays, binding 0 is sampler2D[] and binding 1 is buffer[]
+		static const uint32_t SetIndex = 1;
+
+		// Requires the descriptor indexing features of Vulkan 1.2, every call is a no-op if they are missing
+		static bool IsSupported();
+
+		static uint32_t RegisterImage(const VkDescriptorImageInfo& imageInfo);
+		static uint32_t RegisterBuffer(const VkDescriptorBufferInfo& bufferInfo);
+
+		// Points an existing index at a different buffer, the old one must no longer be read by frames in flight
+		static void UpdateBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo);
+
+		// Indices are handed out again once no frame in flight can still index them
+		static void ReleaseImage(uint32_t index);
+		static void ReleaseBuffer(uint32_t index);
+
+		static void BeginFrame();
+
+		static VkDescriptorSetLayout GetDescriptorSetLayout();
+		static VkDescriptorSet GetDescriptorSet();
+
+	public:
+		static void Init(Ref<VulkanDevice> device);
+		static void Shutdown();
+	};
+
+}
@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "Culling.h"
+#include <chrono>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__AVX__)
+	#define CULLING_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CULLING_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		static glm::vec4 NormalizePlane(const glm::vec4& plane)
+		{
+			return plane / glm::length(glm::vec3(plane));
+		}
+
+		// A box is outside if it lies completely behind any plane, its extents projected onto the plane normal give the
+		// distance from its center to the corner closest to the inside of the frustum.
+		// Summed in the same order as the SIMD paths, so boxes touching a plane land on the same side in both.
+		static bool IsBoxVisible(const Frustum& frustum, const BoundingBoxSoA& boxes, uint32_t index)
+		{
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				float distance = (boxes.CenterX[index] * plane.x + boxes.CenterY[index] * plane.y) + (boxes.CenterZ[index] * plane.z + plane.w);
+				float radius = (boxes.ExtentX[index] * std::abs(plane.x) + boxes.ExtentY[index] * std::abs(plane.y)) + boxes.ExtentZ[index] * std::abs(plane.z);
+
+				if (distance + radius < 0.0f)
+					return false;
+			}
+
+			return true;
+		}
+
+	}
+
+	Frustum Frustum::FromViewProjection(const glm::mat4& viewProjection)
+	{
+		// Gribb/Hartmann plane extraction from the rows of the view projection matrix
+		glm::mat4 m = glm::transpose(viewProjection);
+
+		Frustum frustum;
+		frustum.Planes[0] = Utils::NormalizePlane(m[3] + m[0]); // Left
+		frustum.Planes[1] = Utils::NormalizePlane(m[3] - m[0]); // Right
+		frustum.Planes[2] = Utils::NormalizePlane(m[3] + m[1]); // Bottom
+		frustum.Planes[3] = Utils::NormalizePlane(m[3] - m[1]); // Top
+		frustum.Planes[4] = Utils::NormalizePlane(m[3] + m[2]); // Near, -w <= z so it also holds for zero to one depth projections
+		frustum.Planes[5] = Utils::NormalizePlane(m[3] - m[2]); // Far
+		return frustum;
+	}
+
+	void BoundingBoxSoA::Clear()
+	{
+		CenterX.clear(); CenterY.clear(); CenterZ.clear();
+		ExtentX.clear(); ExtentY.clear(); ExtentZ.clear();
+	}
+
+	void BoundingBoxSoA::Reserve(uint32_t count)
+	{
+		CenterX.reserve(count); CenterY.reserve(count); CenterZ.reserve(count);
+		ExtentX.reserve(count); ExtentY.reserve(count); ExtentZ.reserve(count);
+	}
+
+	void BoundingBoxSoA::Add(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform)
+	{
+		glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+		glm::vec3 localExtent = (localMax - localMin) * 0.5f;
+
+		// Arvo's method, the world extent along each axis is the local extent projected through the absolute rotation/scale
+		glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+		glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])));
+		glm::vec3 extent = absolute * localExtent;
+
+		CenterX.push_back(center.x); CenterY.push_back(center.y); CenterZ.push_back(center.z);
+		ExtentX.push_back(extent.x); ExtentY.push_back(extent.y); ExtentZ.push_back(extent.z);
+	}
+
+	uint32_t Culling::CullFrustum(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& outVisibleIndices)
+	{
+		const uint32_t count = boxes.GetCount();
+		outVisibleIndices.resize(count);
+
+		uint32_t visibleCount = 0;
+		uint32_t i = 0;
+
+#if defined(CULLING_AVX)
+		// 8 boxes per iteration
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 centerX = _mm256_loadu_ps(&boxes.CenterX[i]);
+			__m256 centerY = _mm256_loadu_ps(&boxes.CenterY[i]);
+			__m256 centerZ = _mm256_loadu_ps(&boxes.CenterZ[i]);
+			__m256 extentX = _mm256_loadu_ps(&boxes.ExtentX[i]);
+			__m256 extentY = _mm256_loadu_ps(&boxes.ExtentY[i]);
+			__m256 extentZ = _mm256_loadu_ps(&boxes.ExtentZ[i]);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+												_mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extentX, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(extentY, _mm256_set1_ps(std::abs(plane.y)))),
+											  _mm256_mul_ps(extentZ, _mm256_set1_ps(std::abs(plane.z))));
+
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			uint32_t visibleMask = ~(uint32_t)_mm256_movemask_ps(outside) & 0xFF;
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				if (visibleMask & (1u << lane))
+					outVisibleIndices[visibleCount++] = i + lane;
+			}
+		}
+#elif defined(CULLING_SSE)
+		// 4 boxes per iteration
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 centerX = _mm_loadu_ps(&boxes.CenterX[i]);
+			__m128 centerY = _mm_loadu_ps(&boxes.CenterY[i]);
+			__m128 centerZ = _mm_loadu_ps(&boxes.CenterZ[i]);
+			__m128 extentX = _mm_loadu_ps(&boxes.ExtentX[i]);
+			__m128 extentY = _mm_loadu_ps(&boxes.ExtentY[i]);
+			__m128 extentZ = _mm_loadu_ps(&boxes.ExtentZ[i]);
+
+			__m128 outside = _mm_setzero_ps();
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+											 _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(std::abs(plane.y)))),
+										   _mm_mul_ps(extentZ, _mm_set1_ps(std::abs(plane.z))));
+
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			}
+
+			uint32_t visibleMask = ~(uint32_t)_mm_movemask_ps(outside) & 0xF;
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				if (visibleMask & (1u << lane))
+					outVisibleIndices[visibleCount++] = i + lane;
+			}
+		}
+#endif
+
+		// Remaining boxes that don't fill a whole register
+		for (; i < count; i++)
+		{
+			if (Utils::IsBoxVisible(frustum, boxes, i))
+				outVisibleIndices[visibleCount++] = i;
+		}
+
+		outVisibleIndices.resize(visibleCount);
+		return visibleCount;
+	}
+
+	uint32_t Culling::CullFrustumScalar(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& outVisibleIndices)
+	{
+		const uint32_t count = boxes.GetCount();
+		outVisibleIndices.resize(count);
+
+		uint32_t visibleCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (Utils::IsBoxVisible(frustum, boxes, i))
+				outVisibleIndices[visibleCount++] = i;
+		}
+
+		outVisibleIndices.resize(visibleCount);
+		return visibleCount;
+	}
+
+	const char* Culling::GetInstructionSet()
+	{
+#if defined(CULLING_AVX)
+		return "AVX";
+#elif defined(CULLING_SSE)
+		return "SSE";
+#else
+		return "Scalar";
+#endif
+	}
+
+	std::vector<CullingBenchmarkResult> Culling::RunBenchmark()
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		// Camera looking down -Z at a volume wider than the frustum so only part of the boxes are visible
+		glm::mat4 projection = glm::perspectiveFov(glm::radians(45.0f), 1280.0f, 720.0f, 0.1f, 100.0f);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = Frustum::FromViewProjection(projection * view);
+
+		std::mt19937 random(1337);
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> depth(-110.0f, 10.0f);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+		std::vector<CullingBenchmarkResult> results;
+		std::vector<uint32_t> scalarVisibleIndices;
+		std::vector<uint32_t> visibleIndices;
+
+		for (uint32_t boxCount : { 10000u, 100000u, 1000000u })
+		{
+			BoundingBoxSoA boxes;
+			boxes.Reserve(boxCount);
+			for (uint32_t i = 0; i < boxCount; i++)
+			{
+				glm::vec3 extent = glm::vec3(size(random));
+				glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), depth(random)));
+				boxes.Add(-extent, extent, transform);
+			}
+
+			// Repeat small counts so every measurement covers the same number of boxes
+			const uint32_t iterations = std::max(10000000u / boxCount, 1u);
+
+			CullingBenchmarkResult& result = results.emplace_back();
+			result.BoxCount = boxCount;
+
+			auto startTime = Clock::now();
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				Culling::CullFrustumScalar(frustum, boxes, scalarVisibleIndices);
+			}
+			double scalarSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+			startTime = Clock::now();
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				result.VisibleCount = Culling::CullFrustum(frustum, boxes, visibleIndices);
+			}
+			double simdSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+			// Both lists are sorted, every index in only one of them is a box the paths disagree on
+			std::vector<uint32_t> mismatches;
+			std::set_symmetric_difference(scalarVisibleIndices.begin(), scalarVisibleIndices.end(), visibleIndices.begin(), visibleIndices.end(), std::back_inserter(mismatches));
+			result.MismatchCount = (uint32_t)mismatches.size();
+
+			if (result.MismatchCount > 0)
+				LOG_ERROR("SIMD and scalar culling disagree on {0} of {1} boxes", result.MismatchCount, boxCount);
+
+			result.ScalarBoxesPerSecond = (double)boxCount * iterations / scalarSeconds;
+			result.SIMDBoxesPerSecond = (double)boxCount * iterations / simdSeconds;
+
+			LOG_INFO("Frustum culling {0} boxes ({1} visible): scalar {2:.1f}M boxes/s, {3} {4:.1f}M boxes/s",
+				boxCount, result.VisibleCount, result.ScalarBoxesPerSecond / 1e6, GetInstructionSet(), result.SIMDBoxesPerSecond / 1e6);
+		}
+
+		return results;
+	}
+
+}
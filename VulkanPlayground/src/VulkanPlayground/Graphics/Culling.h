@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace VKPlayground {
+
+	struct Frustum
+	{
+		// Plane normals point into the frustum, w is the distance term
+		glm::vec4 Planes[6];
+
+		static Frustum FromViewProjection(const glm::mat4& viewProjection);
+	};
+
+	// World space bounding boxes stored as center/extent arrays so several boxes can be tested per SIMD instruction
+	struct BoundingBoxSoA
+	{
+		std::vector<float> CenterX, CenterY, CenterZ;
+		std::vector<float> ExtentX, ExtentY, ExtentZ;
+
+		void Clear();
+		void Reserve(uint32_t count);
+
+		// Transforms a local space box and stores the world space box that encloses it
+		void Add(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform);
+
+		inline uint32_t GetCount() const { return (uint32_t)CenterX.size(); }
+	};
+
+	struct CullingBenchmarkResult
+	{
+		uint32_t BoxCount = 0;
+		uint32_t VisibleCount = 0;
+
+		// Boxes the SIMD and scalar paths classified differently, has to be zero
+		uint32_t MismatchCount = 0;
+
+		double ScalarBoxesPerSecond = 0.0;
+		double SIMDBoxesPerSecond = 0.0;
+	};
+
+	class Culling
+	{
+	public:
+		// Writes the indices of all boxes intersecting the frustum into outVisibleIndices and returns how many there are
+		static uint32_t CullFrustum(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& outVisibleIndices);
+		static uint32_t CullFrustumScalar(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& outVisibleIndices);
+
+		// Name of the instruction set CullFrustum was compiled for
+		static const char* GetInstructionSet();
+
+		// Times both paths over random boxes at 10k, 100k and 1M instances
+		static std::vector<CullingBenchmarkResult> RunBenchmark();
+	};
+
+}
@@ -0,0 +1,323 @@
+#include "pch.h"
+#include "GeometryArena.h"
+#include "VulkanAllocator.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/TLSFAllocator.h"
+#include <mutex>
+
+namespace VKPlayground {
+
+	// Size of every buffer a pool creates, an allocation larger than that gets a buffer of its own size
+	static const uint32_t s_BlockSizes[(uint32_t)GeometryPool::Count] = { 64 * 1024 * 1024, 32 * 1024 * 1024 };
+
+	// Allocations Defragment tries to move per call, each try walks the block's ranges from the start
+	static const uint32_t s_MaxDefragmentAttempts = 64;
+
+	struct ArenaBlock
+	{
+		VkBuffer Buffer = nullptr;
+		VmaAllocation Allocation = nullptr;
+		TLSFAllocator Allocator;
+	};
+
+	struct ArenaAllocation
+	{
+		GeometryPool Pool = GeometryPool::Vertices;
+		uint32_t Block = 0;
+		uint32_t Node = TLSFInvalidNode;
+		uint32_t Alignment = 1;
+
+		// Last frame the range was written in, copies into it are only ordered before other copies once that frame was flushed
+		uint64_t FrameNumber = 0;
+	};
+
+	struct RetiredRange
+	{
+		GeometryPool Pool;
+		uint32_t Block;
+		uint32_t Node;
+		uint64_t FrameNumber;
+	};
+
+	struct GeometryArenaData
+	{
+		Ref<VulkanDevice> Device;
+
+		std::vector<ArenaBlock> Blocks[(uint32_t)GeometryPool::Count];
+
+		std::vector<ArenaAllocation> Allocations;
+		std::vector<uint32_t> FreeAllocations;
+
+		// Freed or moved ranges stay allocated until no frame in flight can still read them
+		std::vector<RetiredRange> RetiredRanges;
+
+		uint64_t FrameNumber = 0;
+		uint32_t MovedAllocations = 0;
+		uint64_t MovedBytes = 0;
+
+		// Meshes can be loaded on other threads
+		std::mutex Mutex;
+	};
+
+	static GeometryArenaData* s_Data = nullptr;
+
+	namespace Utils {
+
+		static ArenaBlock& CreateBlock(GeometryPool pool, uint32_t size)
+		{
+			ArenaBlock& block = s_Data->Blocks[(uint32_t)pool].emplace_back();
+			block.Allocator.Reset(size);
+
+			// Defragmentation copies within the buffer, so it is a transfer source as well
+			VkBufferCreateInfo bufferCreateInfo = {};
+			bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferCreateInfo.size = size;
+			bufferCreateInfo.usage = (pool == GeometryPool::Vertices ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT) | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VulkanAllocator allocator("GeometryArena");
+			block.Allocation = allocator.AllocateBuffer(bufferCreateInfo, VMA_MEMORY_USAGE_GPU_ONLY, block.Buffer);
+
+			LOG_INFO("Created {0} MB geometry arena buffer for {1}", size / (1024 * 1024), pool == GeometryPool::Vertices ? "vertices" : "indices");
+			return block;
+		}
+
+		static GeometryRange GetRange(const ArenaAllocation& allocation)
+		{
+			const ArenaBlock& block = s_Data->Blocks[(uint32_t)allocation.Pool][allocation.Block];
+			return { block.Buffer, block.Allocator.GetOffset(allocation.Node), block.Allocator.GetSize(allocation.Node) };
+		}
+
+		static void RetireRange(const ArenaAllocation& allocation)
+		{
+			s_Data->RetiredRanges.push_back({ allocation.Pool, allocation.Block, allocation.Node, s_Data->FrameNumber });
+		}
+
+	}
+
+	uint32_t GeometryArena::Allocate(GeometryPool pool, uint32_t size, uint32_t alignment)
+	{
+		ASSERT(size > 0 && alignment > 0, "Invalid geometry allocation");
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		// Earlier buffers are filled first, so draws mostly come from the same one
+		std::vector<ArenaBlock>& blocks = s_Data->Blocks[(uint32_t)pool];
+		uint32_t blockIndex = 0;
+		uint32_t node = TLSFInvalidNode;
+
+		for (; blockIndex < blocks.size(); blockIndex++)
+		{
+			node = blocks[blockIndex].Allocator.Allocate(size, alignment);
+			if (node != TLSFInvalidNode)
+				break;
+		}
+
+		if (node == TLSFInvalidNode)
+		{
+			ArenaBlock& block = Utils::CreateBlock(pool, std::max(s_BlockSizes[(uint32_t)pool], size + alignment - 1));
+			node = block.Allocator.Allocate(size, alignment);
+			blockIndex = (uint32_t)blocks.size() - 1;
+		}
+
+		uint32_t allocation;
+		if (!s_Data->FreeAllocations.empty())
+		{
+			allocation = s_Data->FreeAllocations.back();
+			s_Data->FreeAllocations.pop_back();
+		}
+		else
+		{
+			allocation = (uint32_t)s_Data->Allocations.size();
+			s_Data->Allocations.emplace_back();
+		}
+
+		ArenaAllocation& arenaAllocation = s_Data->Allocations[allocation];
+		arenaAllocation.Pool = pool;
+		arenaAllocation.Block = blockIndex;
+		arenaAllocation.Node = node;
+		arenaAllocation.Alignment = alignment;
+		arenaAllocation.FrameNumber = s_Data->FrameNumber;
+
+		return allocation;
+	}
+
+	void GeometryArena::Free(uint32_t allocation)
+	{
+		if (allocation == GeometryInvalidAllocation)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		ArenaAllocation& arenaAllocation = s_Data->Allocations[allocation];
+		ASSERT(arenaAllocation.Node != TLSFInvalidNode, "Geometry allocation was already freed");
+
+		GeometryRange range = Utils::GetRange(arenaAllocation);
+		VulkanUploadQueue::Discard(range.Buffer, range.Offset, range.Size);
+
+		// The handle can be reused right away, the range itself may still be read by frames in flight
+		Utils::RetireRange(arenaAllocation);
+		arenaAllocation.Node = TLSFInvalidNode;
+		s_Data->FreeAllocations.push_back(allocation);
+	}
+
+	GeometryRange GeometryArena::GetRange(uint32_t allocation)
+	{
+		if (allocation == GeometryInvalidAllocation)
+			return {};
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		return Utils::GetRange(s_Data->Allocations[allocation]);
+	}
+
+	void* GeometryArena::Stage(uint32_t allocation)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		ArenaAllocation& arenaAllocation = s_Data->Allocations[allocation];
+		arenaAllocation.FrameNumber = s_Data->FrameNumber;
+
+		GeometryRange range = Utils::GetRange(arenaAllocation);
+		return VulkanUploadQueue::StageBuffer(range.Buffer, range.Size, range.Offset);
+	}
+
+	void GeometryArena::Upload(uint32_t allocation, const void* data)
+	{
+		void* staging = Stage(allocation);
+		memcpy(staging, data, GetRange(allocation).Size);
+	}
+
+	void GeometryArena::Defragment(uint64_t maxBytes)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		s_Data->MovedAllocations = 0;
+		s_Data->MovedBytes = 0;
+
+		// Ranges written this frame can still have an upload queued ahead of the move in the same submission
+		std::vector<uint32_t> candidates;
+		for (uint32_t i = 0; i < (uint32_t)s_Data->Allocations.size(); i++)
+		{
+			const ArenaAllocation& allocation = s_Data->Allocations[i];
+			if (allocation.Node == TLSFInvalidNode || allocation.FrameNumber == s_Data->FrameNumber)
+				continue;
+
+			// Only buffers with free space below their last range have anything to compact
+			const TLSFAllocator& allocator = s_Data->Blocks[(uint32_t)allocation.Pool][allocation.Block].Allocator;
+			if (allocator.GetCapacity() - allocator.GetFreeSize() < allocator.GetUsedEnd())
+				candidates.push_back(i);
+		}
+
+		// Topmost ranges first, moving those is what shrinks the used part of a buffer
+		std::sort(candidates.begin(), candidates.end(), [](uint32_t a, uint32_t b)
+		{
+			const ArenaAllocation& allocationA = s_Data->Allocations[a];
+			const ArenaAllocation& allocationB = s_Data->Allocations[b];
+			uint32_t offsetA = s_Data->Blocks[(uint32_t)allocationA.Pool][allocationA.Block].Allocator.GetOffset(allocationA.Node);
+			uint32_t offsetB = s_Data->Blocks[(uint32_t)allocationB.Pool][allocationB.Block].Allocator.GetOffset(allocationB.Node);
+			return offsetA > offsetB;
+		});
+
+		uint32_t attempts = 0;
+		for (uint32_t i : candidates)
+		{
+			if (s_Data->MovedBytes >= maxBytes || attempts++ >= s_MaxDefragmentAttempts)
+				break;
+
+			ArenaAllocation& allocation = s_Data->Allocations[i];
+			ArenaBlock& block = s_Data->Blocks[(uint32_t)allocation.Pool][allocation.Block];
+
+			uint32_t offset = block.Allocator.GetOffset(allocation.Node);
+			uint32_t size = block.Allocator.GetSize(allocation.Node);
+
+			// The new range ends at or below the old one, the two never overlap and the old one is still allocated while it is read
+			uint32_t node = block.Allocator.AllocateBelow(size, allocation.Alignment, offset);
+			if (node == TLSFInvalidNode)
+				continue;
+
+			VulkanUploadQueue::CopyBuffer(block.Buffer, block.Buffer, size, offset, block.Allocator.GetOffset(node));
+
+			Utils::RetireRange(allocation);
+			allocation.Node = node;
+			allocation.FrameNumber = s_Data->FrameNumber;
+
+			s_Data->MovedAllocations++;
+			s_Data->MovedBytes += size;
+		}
+	}
+
+	void GeometryArena::BeginFrame()
+	{
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		s_Data->FrameNumber++;
+
+		auto& retired = s_Data->RetiredRanges;
+		auto it = std::partition(retired.begin(), retired.end(), [framesInFlight](const RetiredRange& range)
+		{
+			return s_Data->FrameNumber - range.FrameNumber <= framesInFlight;
+		});
+
+		for (auto released = it; released != retired.end(); released++)
+		{
+			s_Data->Blocks[(uint32_t)released->Pool][released->Block].Allocator.Free(released->Node);
+		}
+
+		retired.erase(it, retired.end());
+	}
+
+	GeometryArenaStats GeometryArena::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		GeometryArenaStats stats;
+		stats.MovedAllocations = s_Data->MovedAllocations;
+		stats.MovedBytes = s_Data->MovedBytes;
+
+		for (uint32_t pool = 0; pool < (uint32_t)GeometryPool::Count; pool++)
+		{
+			GeometryPoolStats& poolStats = stats.Pools[pool];
+			for (const ArenaBlock& block : s_Data->Blocks[pool])
+			{
+				uint32_t usedSize = block.Allocator.GetCapacity() - block.Allocator.GetFreeSize();
+
+				poolStats.BlockCount++;
+				poolStats.AllocationCount += block.Allocator.GetAllocationCount();
+				poolStats.Capacity += block.Allocator.GetCapacity();
+				poolStats.UsedSize += usedSize;
+				poolStats.HoleSize += block.Allocator.GetUsedEnd() - usedSize;
+			}
+		}
+
+		return stats;
+	}
+
+	void GeometryArena::Init(Ref<VulkanDevice> device)
+	{
+		s_Data = new GeometryArenaData();
+		s_Data->Device = device;
+
+		LOG_INFO("Initialized geometry arena");
+	}
+
+	void GeometryArena::Shutdown()
+	{
+		VulkanAllocator allocator("GeometryArena");
+
+		for (uint32_t pool = 0; pool < (uint32_t)GeometryPool::Count; pool++)
+		{
+			for (ArenaBlock& block : s_Data->Blocks[pool])
+			{
+				VulkanUploadQueue::Discard(block.Buffer);
+				allocator.DestroyBuffer(block.Buffer, block.Allocation);
+			}
+		}
+
+		delete s_Data;
+		s_Data = nullptr;
+	}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "VulkanPlayground/Core/Core.h"
+#include "VulkanDevice.h"
+#include <vulkan/vulkan.h>
+
+namespace VKPlayground {
+
+	static const uint32_t GeometryInvalidAllocation = UINT32_MAX;
+
+	enum class GeometryPool
+	{
+		Vertices = 0,
+		Indices,		// 16- and 32-bit indices share the buffers, ranges are aligned to their index size
+		Count
+	};
+
+	// Where an allocation currently lives, Offset can change between frames when the arena is defragmented
+	struct GeometryRange
+	{
+		VkBuffer Buffer = nullptr;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+	};
+
+	struct GeometryPoolStats
+	{
+		uint32_t BlockCount = 0;
+		uint32_t AllocationCount = 0;
+		uint64_t Capacity = 0;
+		uint64_t UsedSize = 0;
+
+		// Free bytes below the last allocation of each block, defragmentation moves allocations down into them
+		uint64_t HoleSize = 0;
+	};
+
+	struct GeometryArenaStats
+	{
+		GeometryPoolStats Pools[(uint32_t)GeometryPool::Count];
+
+		// Moved by the last Defragment call
+		uint32_t MovedAllocations = 0;
+		uint64_t MovedBytes = 0;
+	};
+
+	// Vertices and indices of every mesh suballocated from a few large device local buffers per pool.
+	// Ranges are handed out by a TLSF allocator per buffer, so draws of different meshes only differ by offsets
+	// and the renderer binds geometry once per buffer instead of once per mesh.
+	// Freed ranges are only reused once no frame in flight can still read them.
+	class GeometryArena
+	{
+	public:
+		// Offset of the range is a multiple of alignment, which can be a vertex stride that isn't a power of two
+		static uint32_t Allocate(GeometryPool pool, uint32_t size, uint32_t alignment);
+		static void Free(uint32_t allocation);
+
+		// Empty range for GeometryInvalidAllocation
+		static GeometryRange GetRange(uint32_t allocation);
+
+		// Staging memory covering the whole range of a new allocation, copied in on the next VulkanUploadQueue::Flush
+		static void* Stage(uint32_t allocation);
+		static void Upload(uint32_t allocation, const void* data);
+
+		// Moves allocations from the top of each buffer into free ranges further down until maxBytes were copied.
+		// Copies go through the upload queue, the old ranges are released like freed ones.
+		static void Defragment(uint64_t maxBytes);
+
+		static void BeginFrame();
+
+		static GeometryArenaStats GetStats();
+
+	public:
+		static void Init(Ref<VulkanDevice> device);
+		static void Shutdown();
+	};
+
+}
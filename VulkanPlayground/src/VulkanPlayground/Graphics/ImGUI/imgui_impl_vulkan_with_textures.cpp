@@ -1418,15 +1418,20 @@ static std::unordered_map<void*, VkDetails> s_VulkanCache;
 ImTextureID ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkImageView image_view, VkImageLayout image_layout)
 {
     ImGui_ImplVulkan_Data* bd = ImGui_ImplVulkan_GetBackendData();
-    ImGui_ImplVulkan_InitInfo* v = &bd->VulkanInitInfo;
 
-    VkDescriptorSetAllocateInfo alloc_info = {};
-    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.descriptorSetCount = 1;
-    alloc_info.pSetLayouts = &bd->DescriptorSetLayout;
+    VkDescriptorImageInfo desc_image = {};
+    desc_image.sampler = sampler;
+    desc_image.imageView = image_view;
+    desc_image.imageLayout = image_layout;
 
-    VkDescriptorSet descriptor_set = VKPlayground::Renderer::AllocateDescriptorSet(alloc_info);
-    ImGui_ImplVulkan_UpdateTextureInfo(descriptor_set, sampler, image_view, image_layout);
+    VkWriteDescriptorSet write_desc = {};
+    write_desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write_desc.descriptorCount = 1;
+    write_desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write_desc.pImageInfo = &desc_image;
+
+    // Called every frame for the same images, the renderer's cache hands back the set written the first time
+    VkDescriptorSet descriptor_set = VKPlayground::Renderer::GetDescriptorSet(bd->DescriptorSetLayout, { write_desc });
     return (ImTextureID)descriptor_set;
 }
 
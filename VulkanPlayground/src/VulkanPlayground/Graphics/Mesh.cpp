@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "Mesh.h"
-#include "glm/gtc/type_ptr.hpp"
+#include "MeshFile.h"
+#include "VulkanUploadQueue.h"
 
 namespace VKPlayground {
 
@@ -12,163 +13,147 @@ namespace VKPlayground {
 
 	Mesh::~Mesh()
 	{
+		GeometryArena::Free(m_VertexAllocation);
+		GeometryArena::Free(m_IndexAllocation16);
+		GeometryArena::Free(m_IndexAllocation32);
+
+		if (m_MeshletBuffer)
+		{
+			VulkanUploadQueue::Discard(m_MeshletBuffer->GetVulkanBuffer());
+			BindlessDescriptors::ReleaseBuffer(m_MeshletBufferIndex);
+		}
 	}
 
 	void Mesh::Init()
 	{
-		tinygltf::TinyGLTF loader;
-		std::string error;
-		std::string warning;
+		if (MeshFile::IsMeshFile(m_Path))
+			LoadCooked();
+		else
+			LoadSource();
+	}
+
+	void Mesh::LoadSource()
+	{
+		MeshImporter importer(m_Path);
+		ASSERT(importer.IsLoaded(), "Failed to load mesh: " + m_Path);
+		if (!importer.IsLoaded())
+			return;
+
+		m_SubMeshes = importer.GetSubMeshes();
+		m_LODs = importer.GetLODs();
+		m_SubMeshInstances = importer.GetSubMeshInstances();
+		m_VertexFormat = importer.GetVertexFormat();
+
+		uint32_t vertexBufferSize = importer.GetVertexCount() * m_VertexFormat.GetStride();
 
-		bool result = loader.LoadASCIIFromFile(&m_Model, &error, &warning, m_Path);
-		ASSERT(warning.empty(), warning);
-		ASSERT(error.empty(), error);
+		CreateGeometry(vertexBufferSize, importer.GetIndexCount(VK_INDEX_TYPE_UINT16), importer.GetIndexCount(VK_INDEX_TYPE_UINT32));
 
-		LoadData();
-		CalculateNodeTransforms(m_Model);
+		// Encode from the source buffers directly into staging memory
+		if (m_VertexAllocation != GeometryInvalidAllocation)
+			importer.WriteVertices(static_cast<uint8_t*>(GeometryArena::Stage(m_VertexAllocation)));
 
-		m_VertexBuffer = CreateRef<VulkanVertexBuffer>(m_Vertices.data(), sizeof(Vertex) * m_Vertices.size());
-		m_IndexBuffer = CreateRef<VulkanIndexBuffer>(m_Indices.data(), sizeof(uint16_t) * m_Indices.size(), m_Indices.size());
+		uint16_t* indices16 = m_IndexAllocation16 != GeometryInvalidAllocation ? static_cast<uint16_t*>(GeometryArena::Stage(m_IndexAllocation16)) : nullptr;
+		uint32_t* indices32 = m_IndexAllocation32 != GeometryInvalidAllocation ? static_cast<uint32_t*>(GeometryArena::Stage(m_IndexAllocation32)) : nullptr;
+		importer.WriteIndices(indices16, indices32);
+
+		CreateMeshletBuffer(importer.GetMeshlets().data(), (uint32_t)importer.GetMeshlets().size());
+		CreateTransformHierarchy(importer.GetNodes().data(), (uint32_t)importer.GetNodes().size());
 	}
 
-	void Mesh::LoadData()
+	void Mesh::LoadCooked()
 	{
-		m_SubMeshes.reserve(m_Model.meshes.size());
+		MappedFile file(m_Path);
+
+		const MeshFileHeader* header = MeshFile::ReadHeader(file);
+		ASSERT(header, "Invalid mesh file: " + m_Path);
 
-		int subMeshVertexOffset = 0;
-		int subMeshIndexOffset = 0;
-		int meshIndex = 1;
-		uint32_t indexCount = 0;
+		m_VertexFormat = VertexFormat::Compact(header->HalfPositions, header->UnormTextureCoords);
+		ASSERT(m_VertexFormat.GetHash() == header->VertexFormatHash, "Mesh file was cooked with a different vertex format: " + m_Path);
 
-		for (tinygltf::Mesh mesh : m_Model.meshes)
+		const uint8_t* data = file.GetData();
+		const MeshFileSubMesh* subMeshes = reinterpret_cast<const MeshFileSubMesh*>(data + header->SubMeshes.Offset);
+
+		m_SubMeshes.resize(header->SubMeshCount);
+		for (uint32_t i = 0; i < header->SubMeshCount; i++)
 		{
-			uint32_t vertexCount = m_Model.accessors[0].count;
-			int subMeshIndexCount = 0;
-
-			for (int i = 0; i < mesh.primitives.size(); i++)
-			{
-				if (m_Vertices.size() < vertexCount * meshIndex)
-					m_Vertices.resize(vertexCount * meshIndex);
-
-				// Positions
-				{
-					const tinygltf::Accessor& accessor = m_Model.accessors[mesh.primitives[i].attributes["POSITION"]];
-					const tinygltf::BufferView& bufferView = m_Model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = m_Model.buffers[bufferView.buffer];
-					const float* positions = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-
-					for (int j = 0; j < accessor.count; j++)
-					{
-						m_Vertices[subMeshVertexOffset + j].Position.x = positions[j * 3 + 0];
-						m_Vertices[subMeshVertexOffset + j].Position.y = positions[j * 3 + 1];
-						m_Vertices[subMeshVertexOffset + j].Position.z = positions[j * 3 + 2];
-					}
-				}
-
-				// Normals
-				{
-					const tinygltf::Accessor& accessor = m_Model.accessors[mesh.primitives[i].attributes["NORMAL"]];
-					const tinygltf::BufferView& bufferView = m_Model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = m_Model.buffers[bufferView.buffer];
-					const float* normals = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-
-					for (int j = 0; j < accessor.count; j++)
-					{
-						m_Vertices[subMeshVertexOffset + j].Normal.x = normals[j * 3 + 0];
-						m_Vertices[subMeshVertexOffset + j].Normal.y = normals[j * 3 + 1];
-						m_Vertices[subMeshVertexOffset + j].Normal.z = normals[j * 3 + 2];
-					}
-				}
-
-				// Tangents
-				{
-					const tinygltf::Accessor& accessor = m_Model.accessors[mesh.primitives[i].attributes["TANGENT"]];
-					const tinygltf::BufferView& bufferView = m_Model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = m_Model.buffers[bufferView.buffer];
-					const float* tangents = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-
-					for (int j = 0; j < accessor.count; j++)
-					{
-						m_Vertices[subMeshVertexOffset + j].Tangent.x = tangents[j * 4 + 0];
-						m_Vertices[subMeshVertexOffset + j].Tangent.y = tangents[j * 4 + 1];
-						m_Vertices[subMeshVertexOffset + j].Tangent.z = tangents[j * 4 + 2];
-						//	m_Vertices[subMeshVertexOffset+ j].Tangent.w = tangents[j * 4 + 3];
-					}
-				}
-
-				// Texture Coordinates
-				{
-					const tinygltf::Accessor& accessor = m_Model.accessors[mesh.primitives[i].attributes["TEXCOORD_0"]];
-					const tinygltf::BufferView& bufferView = m_Model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = m_Model.buffers[bufferView.buffer];
-					const float* texCoords = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-
-					for (int j = 0; j < accessor.count; j++)
-					{
-						m_Vertices[subMeshVertexOffset + j].TextureCoords.x = texCoords[j * 2 + 0];
-						m_Vertices[subMeshVertexOffset + j].TextureCoords.y = texCoords[j * 2 + 1];
-					}
-				}
-
-				// Indices
-				{
-					const tinygltf::Accessor& accessor = m_Model.accessors[mesh.primitives[i].indices];
-					const tinygltf::BufferView& bufferView = m_Model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = m_Model.buffers[bufferView.buffer];
-					const uint16_t* indices = reinterpret_cast<const uint16_t*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-
-					m_Indices.resize(accessor.count * meshIndex);
-
-					for (int j = 0; j < accessor.count; j++)
-					{
-						m_Indices[indexCount + j] = indices[j];
-					}
-
-					indexCount += accessor.count;
-					subMeshIndexCount = accessor.count;
-				}
-
-				meshIndex++;
-			}
-
-			SubMesh& subMesh = m_SubMeshes.emplace_back();
-
-			subMesh.VertexOffset = subMeshVertexOffset;
-			subMesh.IndexOffset = subMeshIndexOffset;
-			subMesh.IndexCount = subMeshIndexCount;
-
-			subMeshVertexOffset += vertexCount;
-			subMeshIndexOffset += indexCount;
+			m_SubMeshes[i].VertexOffset = subMeshes[i].VertexOffset;
+			m_SubMeshes[i].VertexCount = subMeshes[i].VertexCount;
+			m_SubMeshes[i].IndexOffset = subMeshes[i].IndexOffset;
+			m_SubMeshes[i].IndexCount = subMeshes[i].IndexCount;
+			m_SubMeshes[i].IndexType = subMeshes[i].IndexSize == sizeof(uint32_t) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+			m_SubMeshes[i].MeshletOffset = subMeshes[i].MeshletOffset;
+			m_SubMeshes[i].MeshletCount = subMeshes[i].MeshletCount;
+			m_SubMeshes[i].LODOffset = subMeshes[i].LODOffset;
+			m_SubMeshes[i].LODCount = subMeshes[i].LODCount;
+			m_SubMeshes[i].BoundsMin = subMeshes[i].BoundsMin;
+			m_SubMeshes[i].BoundsMax = subMeshes[i].BoundsMax;
 		}
 
+		const SubMeshLOD* lods = reinterpret_cast<const SubMeshLOD*>(data + header->LODs.Offset);
+		m_LODs.assign(lods, lods + header->LODCount);
+
+		const SubMeshInstance* subMeshInstances = reinterpret_cast<const SubMeshInstance*>(data + header->SubMeshInstances.Offset);
+		m_SubMeshInstances.assign(subMeshInstances, subMeshInstances + header->SubMeshInstanceCount);
+
+		CreateTransformHierarchy(reinterpret_cast<const MeshNode*>(data + header->Nodes.Offset), header->NodeCount);
+
+		// Cooked data is already in its GPU layout, each buffer is one copy from the mapped file into staging memory
+		uint32_t vertexBufferSize = (uint32_t)header->Vertices.Size;
+
+		CreateGeometry(vertexBufferSize, header->IndexCount16, header->IndexCount32);
+
+		if (m_VertexAllocation != GeometryInvalidAllocation)
+			GeometryArena::Upload(m_VertexAllocation, data + header->Vertices.Offset);
+		if (m_IndexAllocation16 != GeometryInvalidAllocation)
+			GeometryArena::Upload(m_IndexAllocation16, data + header->Indices16.Offset);
+		if (m_IndexAllocation32 != GeometryInvalidAllocation)
+			GeometryArena::Upload(m_IndexAllocation32, data + header->Indices32.Offset);
+
+		CreateMeshletBuffer(reinterpret_cast<const Meshlet*>(data + header->Meshlets.Offset), header->MeshletCount);
+	}
+
+	void Mesh::CreateGeometry(uint32_t vertexBufferSize, uint32_t indexCount16, uint32_t indexCount32)
+	{
+		// Ranges are aligned to their element size, so the renderer can turn their offsets into vertex and index offsets
+		if (vertexBufferSize > 0)
+			m_VertexAllocation = GeometryArena::Allocate(GeometryPool::Vertices, vertexBufferSize, m_VertexFormat.GetStride());
+
+		if (indexCount16 > 0)
+			m_IndexAllocation16 = GeometryArena::Allocate(GeometryPool::Indices, indexCount16 * (uint32_t)sizeof(uint16_t), sizeof(uint16_t));
+
+		if (indexCount32 > 0)
+			m_IndexAllocation32 = GeometryArena::Allocate(GeometryPool::Indices, indexCount32 * (uint32_t)sizeof(uint32_t), sizeof(uint32_t));
 	}
 
-	void Mesh::CalculateNodeTransforms(const tinygltf::Model& model)
+	void Mesh::CreateMeshletBuffer(const Meshlet* meshlets, uint32_t meshletCount)
 	{
-		for (int i = 0; i < model.nodes.size(); i++)
+		// Only read by the meshlet culling pass, which indexes it through the bindless set
+		if (meshletCount == 0 || !BindlessDescriptors::IsSupported())
+			return;
+
+		uint32_t size = meshletCount * (uint32_t)sizeof(Meshlet);
+		m_MeshletBuffer = CreateRef<VulkanBuffer>(nullptr, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		VulkanUploadQueue::UploadBuffer(m_MeshletBuffer->GetVulkanBuffer(), meshlets, size);
+
+		m_MeshletBufferIndex = BindlessDescriptors::RegisterBuffer({ m_MeshletBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE });
+	}
+
+	// Node indices and parents are passed to the hierarchy unchanged
+	static_assert(InvalidMeshNode == InvalidTransformNode, "Mesh nodes and transform nodes have to use the same invalid index");
+
+	void Mesh::CreateTransformHierarchy(const MeshNode* nodes, uint32_t nodeCount)
+	{
+		m_TransformHierarchy.Clear();
+		m_TransformHierarchy.Reserve(nodeCount);
+
+		for (uint32_t i = 0; i < nodeCount; i++)
 		{
-			tinygltf::Node node = model.nodes[i];
-
-			glm::mat4 transform;
-
-			if (node.translation.size() == 3) 
-			{
-				transform = glm::translate(transform, glm::vec3(glm::make_vec3(node.translation.data())));
-			}
-			if (node.rotation.size() == 4) 
-			{
-				glm::quat q = glm::make_quat(node.rotation.data());
-				transform *= glm::mat4(q);
-			}
-			if (node.scale.size() == 3) 
-			{
-				transform = glm::scale(transform, glm::vec3(glm::make_vec3(node.scale.data())));
-			}
-			if (node.matrix.size() == 16) 
-			{
-				transform = glm::make_mat4x4(node.matrix.data());
-			};
+			const MeshNode& node = nodes[i];
+			glm::quat rotation(node.Rotation.w, node.Rotation.x, node.Rotation.y, node.Rotation.z);
+			m_TransformHierarchy.AddNode(node.Parent, node.Translation, rotation, node.Scale);
 		}
+
+		m_TransformHierarchy.Update();
 	}
 
-}
\ No newline at end of file
+}
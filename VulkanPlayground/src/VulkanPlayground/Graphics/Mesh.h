@@ -1,52 +1,67 @@
 #pragma once
 #include "VulkanPlayground/Graphics/VulkanBuffers.h"
-#include <tinygltf/tiny_gltf.h>
+#include "VulkanPlayground/Graphics/GeometryArena.h"
+#include "VulkanPlayground/Graphics/BindlessDescriptors.h"
+#include "VulkanPlayground/Graphics/VertexFormat.h"
+#include "VulkanPlayground/Graphics/MeshImporter.h"
+#include "VulkanPlayground/Graphics/TransformHierarchy.h"
 #include <glm/glm.hpp>
 
 namespace VKPlayground {
 
-	struct SubMesh
-	{
-		uint32_t VertexOffset = 0;
-		uint32_t IndexOffset = 0;
-		uint32_t IndexCount = 0;
-	};
-
-	struct Vertex
-	{
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::vec3 Tangent;
-		glm::vec2 TextureCoords;
-	};
-
 	class Mesh
 	{
 	public:
+		// Loads .gltf and .glb sources as well as .vpmesh files cooked from them by MeshCooker
 		Mesh(const std::string& path);
 		~Mesh();
 
 		inline const std::vector<SubMesh>& GetSubMeshes() const { return m_SubMeshes; }
 
-		inline Ref<VulkanVertexBuffer> GetVertexBuffer() const { return m_VertexBuffer; }
-		inline Ref<VulkanIndexBuffer> GetIndexBuffer() const { return m_IndexBuffer; }
+		// Levels of detail of every submesh, indexed by SubMesh::LODOffset
+		inline const std::vector<SubMeshLOD>& GetLODs() const { return m_LODs; }
+
+		// Submeshes placed at the nodes of the source file, nodes index into the transform hierarchy
+		inline const std::vector<SubMeshInstance>& GetSubMeshInstances() const { return m_SubMeshInstances; }
+
+		// Local transforms can be changed at runtime, the renderer updates the world matrices of changed nodes when the mesh is submitted
+		inline TransformHierarchy& GetTransformHierarchy() { return m_TransformHierarchy; }
+		inline const TransformHierarchy& GetTransformHierarchy() const { return m_TransformHierarchy; }
+
+		// Layout of the data in the vertex range, picked per mesh when it is loaded
+		inline const VertexFormat& GetVertexFormat() const { return m_VertexFormat; }
+
+		// Ranges of the geometry arena holding the mesh, they can move between frames so they are looked up when the mesh is submitted.
+		// Submesh offsets are relative to the start of the range, a mesh only has index ranges for the index types its submeshes use.
+		inline GeometryRange GetVertexRange() const { return GeometryArena::GetRange(m_VertexAllocation); }
+		inline GeometryRange GetIndexRange(VkIndexType indexType) const { return GeometryArena::GetRange(indexType == VK_INDEX_TYPE_UINT32 ? m_IndexAllocation32 : m_IndexAllocation16); }
+
+		// Bindless buffer holding every submesh's Meshlet records, BindlessInvalidIndex if bindless descriptors aren't supported
+		inline uint32_t GetMeshletBufferIndex() const { return m_MeshletBufferIndex; }
 
 	private:
 		void Init();
-		void LoadData();
-		void CalculateNodeTransforms(const tinygltf::Model& model);
+		void LoadSource();
+		void LoadCooked();
+		void CreateGeometry(uint32_t vertexBufferSize, uint32_t indexCount16, uint32_t indexCount32);
+		void CreateMeshletBuffer(const Meshlet* meshlets, uint32_t meshletCount);
+		void CreateTransformHierarchy(const MeshNode* nodes, uint32_t nodeCount);
 
 	private:
 		std::string m_Path;
 
 		std::vector<SubMesh> m_SubMeshes;
-		std::vector<Vertex> m_Vertices;
-		std::vector<uint16_t> m_Indices;
+		std::vector<SubMeshLOD> m_LODs;
+		std::vector<SubMeshInstance> m_SubMeshInstances;
+		TransformHierarchy m_TransformHierarchy;
+		VertexFormat m_VertexFormat;
 
-		Ref<VulkanVertexBuffer> m_VertexBuffer;
-		Ref<VulkanIndexBuffer> m_IndexBuffer;
+		uint32_t m_VertexAllocation = GeometryInvalidAllocation;
+		uint32_t m_IndexAllocation16 = GeometryInvalidAllocation;
+		uint32_t m_IndexAllocation32 = GeometryInvalidAllocation;
 
-		tinygltf::Model m_Model;
+		Ref<VulkanBuffer> m_MeshletBuffer;
+		uint32_t m_MeshletBufferIndex = BindlessInvalidIndex;
 	};
 
 }
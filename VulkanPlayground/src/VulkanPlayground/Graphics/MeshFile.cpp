@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "MeshFile.h"
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		static uint64_t AlignSection(uint64_t offset)
+		{
+			return (offset + MeshFileAlignment - 1) & ~(uint64_t)(MeshFileAlignment - 1);
+		}
+
+		static MeshFileSection AllocateSection(uint64_t& offset, uint64_t size)
+		{
+			MeshFileSection section;
+			section.Offset = AlignSection(offset);
+			section.Size = size;
+
+			offset = section.Offset + size;
+			return section;
+		}
+
+		static bool IsSectionValid(const MeshFileSection& section, size_t fileSize)
+		{
+			return section.Offset % MeshFileAlignment == 0 && section.Offset <= fileSize && section.Size <= fileSize - section.Offset;
+		}
+
+		static void WriteSection(std::vector<uint8_t>& file, const MeshFileSection& section, const void* data)
+		{
+			if (section.Size > 0)
+				memcpy(file.data() + section.Offset, data, section.Size);
+		}
+
+	}
+
+	bool MeshFile::Write(const std::string& path, const MeshImporter& importer)
+	{
+		const VertexFormat& vertexFormat = importer.GetVertexFormat();
+		const std::vector<SubMesh>& subMeshes = importer.GetSubMeshes();
+
+		MeshFileHeader header;
+		header.HalfPositions = vertexFormat.GetElement(VertexSemantic::POSITION)->Format == VK_FORMAT_R16G16B16A16_SFLOAT;
+		header.UnormTextureCoords = vertexFormat.GetElement(VertexSemantic::TEXCOORD)->Format == VK_FORMAT_R16G16_UNORM;
+		header.VertexStride = vertexFormat.GetStride();
+		header.VertexFormatHash = vertexFormat.GetHash();
+		header.VertexCount = importer.GetVertexCount();
+		header.IndexCount16 = importer.GetIndexCount(VK_INDEX_TYPE_UINT16);
+		header.IndexCount32 = importer.GetIndexCount(VK_INDEX_TYPE_UINT32);
+		header.SubMeshCount = (uint32_t)subMeshes.size();
+		header.MeshletCount = (uint32_t)importer.GetMeshlets().size();
+		header.LODCount = (uint32_t)importer.GetLODs().size();
+		header.NodeCount = (uint32_t)importer.GetNodes().size();
+		header.SubMeshInstanceCount = (uint32_t)importer.GetSubMeshInstances().size();
+
+		header.BoundsMin = subMeshes.empty() ? glm::vec3(0.0f) : glm::vec3(std::numeric_limits<float>::max());
+		header.BoundsMax = subMeshes.empty() ? glm::vec3(0.0f) : glm::vec3(std::numeric_limits<float>::lowest());
+
+		std::vector<MeshFileSubMesh> fileSubMeshes(subMeshes.size());
+		for (size_t i = 0; i < subMeshes.size(); i++)
+		{
+			fileSubMeshes[i].VertexOffset = subMeshes[i].VertexOffset;
+			fileSubMeshes[i].VertexCount = subMeshes[i].VertexCount;
+			fileSubMeshes[i].IndexOffset = subMeshes[i].IndexOffset;
+			fileSubMeshes[i].IndexCount = subMeshes[i].IndexCount;
+			fileSubMeshes[i].IndexSize = subMeshes[i].IndexType == VK_INDEX_TYPE_UINT32 ? sizeof(uint32_t) : sizeof(uint16_t);
+			fileSubMeshes[i].MeshletOffset = subMeshes[i].MeshletOffset;
+			fileSubMeshes[i].MeshletCount = subMeshes[i].MeshletCount;
+			fileSubMeshes[i].LODOffset = subMeshes[i].LODOffset;
+			fileSubMeshes[i].LODCount = subMeshes[i].LODCount;
+			fileSubMeshes[i].BoundsMin = subMeshes[i].BoundsMin;
+			fileSubMeshes[i].BoundsMax = subMeshes[i].BoundsMax;
+
+			header.BoundsMin = glm::min(header.BoundsMin, subMeshes[i].BoundsMin);
+			header.BoundsMax = glm::max(header.BoundsMax, subMeshes[i].BoundsMax);
+		}
+
+		uint64_t offset = sizeof(MeshFileHeader);
+		header.Vertices = Utils::AllocateSection(offset, (uint64_t)header.VertexCount * header.VertexStride);
+		header.Indices16 = Utils::AllocateSection(offset, (uint64_t)header.IndexCount16 * sizeof(uint16_t));
+		header.Indices32 = Utils::AllocateSection(offset, (uint64_t)header.IndexCount32 * sizeof(uint32_t));
+		header.SubMeshes = Utils::AllocateSection(offset, fileSubMeshes.size() * sizeof(MeshFileSubMesh));
+		header.Meshlets = Utils::AllocateSection(offset, (uint64_t)header.MeshletCount * sizeof(Meshlet));
+		header.LODs = Utils::AllocateSection(offset, (uint64_t)header.LODCount * sizeof(SubMeshLOD));
+		header.Nodes = Utils::AllocateSection(offset, (uint64_t)header.NodeCount * sizeof(MeshNode));
+		header.SubMeshInstances = Utils::AllocateSection(offset, (uint64_t)header.SubMeshInstanceCount * sizeof(SubMeshInstance));
+
+		// Assembled in memory so alignment padding is always zero, which keeps the output deterministic
+		std::vector<uint8_t> file(Utils::AlignSection(offset), 0);
+		memcpy(file.data(), &header, sizeof(header));
+
+		importer.WriteVertices(file.data() + header.Vertices.Offset);
+		importer.WriteIndices(reinterpret_cast<uint16_t*>(file.data() + header.Indices16.Offset), reinterpret_cast<uint32_t*>(file.data() + header.Indices32.Offset));
+		Utils::WriteSection(file, header.SubMeshes, fileSubMeshes.data());
+		Utils::WriteSection(file, header.Meshlets, importer.GetMeshlets().data());
+		Utils::WriteSection(file, header.LODs, importer.GetLODs().data());
+		Utils::WriteSection(file, header.Nodes, importer.GetNodes().data());
+		Utils::WriteSection(file, header.SubMeshInstances, importer.GetSubMeshInstances().data());
+
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_WARN("Failed to write mesh file: {0}", path);
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+		return (bool)stream;
+	}
+
+	const MeshFileHeader* MeshFile::ReadHeader(const MappedFile& file)
+	{
+		if (!file.IsValid() || file.GetSize() < sizeof(MeshFileHeader))
+			return nullptr;
+
+		const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(file.GetData());
+		if (header->Magic != MeshFileMagic)
+			return nullptr;
+
+		if (header->Version != MeshFileVersion)
+		{
+			LOG_WARN("Mesh file version {0} doesn't match {1}, it has to be cooked again", header->Version, MeshFileVersion);
+			return nullptr;
+		}
+
+		size_t size = file.GetSize();
+		bool sectionsValid = Utils::IsSectionValid(header->Vertices, size)
+			&& Utils::IsSectionValid(header->Indices16, size)
+			&& Utils::IsSectionValid(header->Indices32, size)
+			&& Utils::IsSectionValid(header->SubMeshes, size)
+			&& Utils::IsSectionValid(header->Meshlets, size)
+			&& Utils::IsSectionValid(header->LODs, size)
+			&& Utils::IsSectionValid(header->Nodes, size)
+			&& Utils::IsSectionValid(header->SubMeshInstances, size);
+
+		if (!sectionsValid
+			|| header->Vertices.Size != (uint64_t)header->VertexCount * header->VertexStride
+			|| header->Indices16.Size != (uint64_t)header->IndexCount16 * sizeof(uint16_t)
+			|| header->Indices32.Size != (uint64_t)header->IndexCount32 * sizeof(uint32_t)
+			|| header->SubMeshes.Size != (uint64_t)header->SubMeshCount * sizeof(MeshFileSubMesh)
+			|| header->Meshlets.Size != (uint64_t)header->MeshletCount * sizeof(Meshlet)
+			|| header->LODs.Size != (uint64_t)header->LODCount * sizeof(SubMeshLOD)
+			|| header->Nodes.Size != (uint64_t)header->NodeCount * sizeof(MeshNode)
+			|| header->SubMeshInstances.Size != (uint64_t)header->SubMeshInstanceCount * sizeof(SubMeshInstance))
+			return nullptr;
+
+		return header;
+	}
+
+	bool MeshFile::IsMeshFile(const std::string& path)
+	{
+		return path.size() >= 7 && path.compare(path.size() - 7, 7, ".vpmesh") == 0;
+	}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "VulkanPlayground/Graphics/MeshImporter.h"
+#include "VulkanPlayground/Core/MappedFile.h"
+
+namespace VKPlayground {
+
+	static constexpr uint32_t MeshFileMagic = 0x48534D56;	// "VMSH"
+	static constexpr uint32_t MeshFileVersion = 5;
+
+	// Every section starts on this boundary so it can be read straight from a mapped file
+	static constexpr uint32_t MeshFileAlignment = 16;
+
+	struct MeshFileSection
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+	};
+
+	// Fixed size header at the start of a .vpmesh, every field is explicitly sized so the layout has no padding
+	struct MeshFileHeader
+	{
+		uint32_t Magic = MeshFileMagic;
+		uint32_t Version = MeshFileVersion;
+
+		// VertexFormat::Compact() arguments, checked against VertexStride and VertexFormatHash on load
+		uint32_t HalfPositions = 0;
+		uint32_t UnormTextureCoords = 0;
+		uint32_t VertexStride = 0;
+		uint32_t Reserved = 0;
+		uint64_t VertexFormatHash = 0;
+
+		// Submeshes whose vertices fit 16-bit indices use the 16-bit stream, the rest the 32-bit one
+		uint32_t VertexCount = 0;
+		uint32_t IndexCount16 = 0;
+		uint32_t IndexCount32 = 0;
+		uint32_t SubMeshCount = 0;
+		uint32_t MeshletCount = 0;
+		uint32_t LODCount = 0;
+		uint32_t NodeCount = 0;
+		uint32_t SubMeshInstanceCount = 0;
+
+		glm::vec3 BoundsMin = glm::vec3(0.0f);
+		glm::vec3 BoundsMax = glm::vec3(0.0f);
+
+		MeshFileSection Vertices;
+		MeshFileSection Indices16;
+		MeshFileSection Indices32;
+		MeshFileSection SubMeshes;
+
+		// Meshlet, LOD, node and instance records in the same layout as Meshlet, SubMeshLOD, MeshNode and SubMeshInstance
+		MeshFileSection Meshlets;
+		MeshFileSection LODs;
+		MeshFileSection Nodes;
+		MeshFileSection SubMeshInstances;
+	};
+
+	struct MeshFileSubMesh
+	{
+		uint32_t VertexOffset = 0;
+		uint32_t VertexCount = 0;
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+
+		// Size in bytes of one index, 2 or 4
+		uint32_t IndexSize = 0;
+
+		uint32_t MeshletOffset = 0;
+		uint32_t MeshletCount = 0;
+		uint32_t LODOffset = 0;
+		uint32_t LODCount = 0;
+		uint32_t Reserved = 0;
+
+		glm::vec3 BoundsMin = glm::vec3(0.0f);
+		glm::vec3 BoundsMax = glm::vec3(0.0f);
+	};
+
+	static_assert(sizeof(MeshFileHeader) == 216, "MeshFileHeader layout changed, bump MeshFileVersion");
+	static_assert(sizeof(MeshFileSubMesh) == 64, "MeshFileSubMesh layout changed, bump MeshFileVersion");
+	static_assert(sizeof(SubMeshLOD) == 12, "SubMeshLOD layout changed, bump MeshFileVersion");
+	static_assert(sizeof(MeshNode) == 44, "MeshNode layout changed, bump MeshFileVersion");
+	static_assert(sizeof(SubMeshInstance) == 8, "SubMeshInstance layout changed, bump MeshFileVersion");
+
+	// Cooked mesh format (.vpmesh) written offline by MeshCooker. Vertices are stored already encoded in their
+	// VertexFormat and indices in their final width, so loading is a header check and one copy per buffer.
+	class MeshFile
+	{
+	public:
+		// Output only depends on the imported data, cooking an unchanged source twice gives identical files
+		static bool Write(const std::string& path, const MeshImporter& importer);
+
+		// nullptr if the mapped file isn't a .vpmesh this build can read or a section lies outside of it
+		static const MeshFileHeader* ReadHeader(const MappedFile& file);
+
+		static bool IsMeshFile(const std::string& path);
+	};
+
+}
@@ -0,0 +1,646 @@
+#include "pch.h"
+#include "MeshImporter.h"
+#include "VulkanPlayground/Core/JobSystem.h"
+#include "glm/gtc/type_ptr.hpp"
+#include <tinygltf/json.hpp>
+
+namespace VKPlayground {
+
+	// Largest coordinate stored as a half float, spacing between representable values stays below 1/128 up to here
+	static const float s_HalfPositionRange = 16.0f;
+
+	static const uint32_t s_GLBMagic = 0x46546C67;		// "glTF"
+	static const uint32_t s_GLBChunkJSON = 0x4E4F534A;	// "JSON"
+	static const uint32_t s_GLBChunkBIN = 0x004E4942;	// "BIN\0"
+
+	// Vertices a 16-bit index can address
+	static const uint32_t s_MaxVertexCount16 = 65536;
+
+	// Vertices or indices encoded per job, large enough that scheduling doesn't show up next to the encoding
+	static const uint32_t s_ImportRangeSize = 16 * 1024;
+
+	// Submeshes this small cost less to draw in full than a level of detail saves
+	static const uint32_t s_MinLODTriangles = 64;
+
+	// A level has to drop at least this share of the previous one's triangles, less means the simplifier ran out of collapses
+	static const float s_MinLODReduction = 0.2f;
+
+	static const glm::vec3 s_DefaultNormal = glm::vec3(0.0f, 0.0f, 1.0f);
+	static const glm::vec4 s_DefaultTangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+	static const glm::vec2 s_DefaultTextureCoords = glm::vec2(0.0f);
+
+	// Smallest valid data URI, tinygltf decodes it instead of copying the binary chunk
+	static const char* s_PlaceholderBufferURI = "data:application/octet-stream;base64,AA==";
+
+	namespace Utils {
+
+		// Range of one submesh's vertices or indices encoded by a single job
+		struct ImportRange
+		{
+			uint32_t SubMesh = 0;
+			uint32_t First = 0;
+			uint32_t Count = 0;
+		};
+
+		static bool IsBinaryFile(const std::string& path)
+		{
+			return path.size() >= 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+		}
+
+		static std::string GetBaseDirectory(const std::string& path)
+		{
+			size_t separator = path.find_last_of("/\\");
+			return separator != std::string::npos ? path.substr(0, separator) : "";
+		}
+
+		static MeshSourceStream GetAccessorStream(const tinygltf::Model& model, int accessorIndex, const uint8_t* binaryChunk, int binaryBuffer)
+		{
+			const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+			const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+
+			// The binary chunk of a .glb is read from the mapped file, every other buffer was loaded by tinygltf
+			const uint8_t* bufferData = bufferView.buffer == binaryBuffer ? binaryChunk : model.buffers[bufferView.buffer].data.data();
+
+			MeshSourceStream stream;
+			stream.Data = bufferData + bufferView.byteOffset + accessor.byteOffset;
+			stream.Stride = (uint32_t)accessor.ByteStride(bufferView);
+			stream.ComponentCount = (uint32_t)tinygltf::GetNumComponentsInType(accessor.type);
+			stream.ComponentType = accessor.componentType;
+			stream.Count = (uint32_t)accessor.count;
+
+			return stream;
+		}
+
+		static MeshSourceStream GetAttributeStream(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& name, const uint8_t* binaryChunk, int binaryBuffer)
+		{
+			auto it = primitive.attributes.find(name);
+			if (it == primitive.attributes.end())
+				return MeshSourceStream();
+
+			ASSERT(model.accessors[it->second].componentType == TINYGLTF_COMPONENT_TYPE_FLOAT, "Only float vertex attributes are supported: " + name);
+			return GetAccessorStream(model, it->second, binaryChunk, binaryBuffer);
+		}
+
+		template<typename T>
+		static void ConvertIndices(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t* destination)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				T index;
+				memcpy(&index, source + (size_t)i * stride, sizeof(T));
+				destination[i] = index;
+			}
+		}
+
+		static void CopyIndices(const MeshSourceStream& stream, uint32_t first, uint32_t count, uint32_t* destination)
+		{
+			const uint8_t* source = stream.Data + (size_t)first * stream.Stride;
+
+			switch (stream.ComponentType)
+			{
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  ConvertIndices<uint8_t>(source, stream.Stride, count, destination); return;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: ConvertIndices<uint16_t>(source, stream.Stride, count, destination); return;
+				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:   ConvertIndices<uint32_t>(source, stream.Stride, count, destination); return;
+			}
+
+			ASSERT(false, "Unsupported index type");
+		}
+
+		// Splits every submesh into ranges of at most s_ImportRangeSize so large primitives spread over all workers too
+		static void ParallelForRanges(uint32_t subMeshCount, const std::function<uint32_t(uint32_t)>& getCount, const std::function<void(const ImportRange&)>& task)
+		{
+			std::vector<ImportRange> ranges;
+			for (uint32_t i = 0; i < subMeshCount; i++)
+			{
+				uint32_t count = getCount(i);
+				for (uint32_t first = 0; first < count; first += s_ImportRangeSize)
+					ranges.push_back({ i, first, std::min(s_ImportRangeSize, count - first) });
+			}
+
+			JobSystem::ParallelFor((uint32_t)ranges.size(), [&](uint32_t i)
+			{
+				task(ranges[i]);
+			});
+		}
+
+		// Splits a node matrix into translation, rotation and scale, shear can't be represented and is dropped
+		static void DecomposeTransform(const glm::mat4& matrix, MeshNode& node)
+		{
+			glm::vec3 columns[3] = { glm::vec3(matrix[0]), glm::vec3(matrix[1]), glm::vec3(matrix[2]) };
+
+			node.Translation = glm::vec3(matrix[3]);
+			node.Scale = glm::vec3(glm::length(columns[0]), glm::length(columns[1]), glm::length(columns[2]));
+
+			// A mirroring matrix has no rotation, one negative scale axis takes the reflection
+			if (glm::determinant(glm::mat3(matrix)) < 0.0f)
+				node.Scale.x = -node.Scale.x;
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (node.Scale[i] != 0.0f)
+				{
+					columns[i] /= node.Scale[i];
+				}
+				else
+				{
+					columns[i] = glm::vec3(0.0f);
+					columns[i][i] = 1.0f;
+				}
+			}
+
+			glm::quat rotation = glm::normalize(glm::quat_cast(glm::mat3(columns[0], columns[1], columns[2])));
+			node.Rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+		}
+
+		static void ReadNodeTransform(const tinygltf::Node& source, MeshNode& node)
+		{
+			if (source.matrix.size() == 16)
+			{
+				DecomposeTransform(glm::mat4(glm::make_mat4(source.matrix.data())), node);
+				return;
+			}
+
+			if (source.translation.size() == 3)
+				node.Translation = glm::vec3(glm::make_vec3(source.translation.data()));
+			if (source.rotation.size() == 4)
+				node.Rotation = glm::vec4(glm::make_vec4(source.rotation.data()));
+			if (source.scale.size() == 3)
+				node.Scale = glm::vec3(glm::make_vec3(source.scale.data()));
+		}
+
+	}
+
+	MeshImporter::MeshImporter(const std::string& path)
+		: m_Path(path)
+	{
+		if (Utils::IsBinaryFile(m_Path))
+		{
+			m_Loaded = LoadBinary();
+		}
+		else
+		{
+			tinygltf::TinyGLTF loader;
+			std::string error;
+			std::string warning;
+
+			m_Loaded = loader.LoadASCIIFromFile(&m_Model, &error, &warning, m_Path);
+			if (!warning.empty())
+				LOG_WARN("{0}: {1}", m_Path, warning);
+			if (!m_Loaded)
+				LOG_ERROR("Failed to load mesh {0}: {1}", m_Path, error);
+		}
+
+		// Everything stays empty if the file couldn't be read
+		if (!m_Loaded)
+			return;
+
+		ReadLayout();
+		ReadNodes();
+		Optimize();
+	}
+
+	MeshImporter::~MeshImporter()
+	{
+	}
+
+	bool MeshImporter::LoadBinary()
+	{
+		m_File = CreateScope<MappedFile>(m_Path);
+		if (!m_File->IsValid())
+		{
+			LOG_ERROR("Failed to map mesh: {0}", m_Path);
+			return false;
+		}
+
+		const uint8_t* data = m_File->GetData();
+		size_t size = m_File->GetSize();
+
+		// 12 byte header followed by chunks, each starting with its length and type
+		uint32_t header[3] = {};
+		uint32_t jsonChunk[2] = {};
+		if (size < sizeof(header) + sizeof(jsonChunk))
+		{
+			LOG_ERROR("Invalid glb file: {0}", m_Path);
+			return false;
+		}
+
+		memcpy(header, data, sizeof(header));
+		if (header[0] != s_GLBMagic || header[1] != 2)
+		{
+			LOG_ERROR("Unsupported glb file: {0}", m_Path);
+			return false;
+		}
+
+		if (header[2] > size)
+		{
+			LOG_ERROR("Truncated glb file: {0}", m_Path);
+			return false;
+		}
+
+		size_t offset = sizeof(header);
+		memcpy(jsonChunk, data + offset, sizeof(jsonChunk));
+		offset += sizeof(jsonChunk);
+
+		if (jsonChunk[1] != s_GLBChunkJSON || offset + jsonChunk[0] > header[2])
+		{
+			LOG_ERROR("Invalid glb json chunk: {0}", m_Path);
+			return false;
+		}
+
+		const char* jsonData = reinterpret_cast<const char*>(data + offset);
+		offset += jsonChunk[0];
+
+		uint32_t chunk[2] = {};
+		if (offset + sizeof(chunk) <= header[2])
+		{
+			memcpy(chunk, data + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+
+			if (chunk[1] == s_GLBChunkBIN && offset + chunk[0] <= header[2])
+			{
+				m_BinaryChunk = data + offset;
+				m_BinaryChunkSize = chunk[0];
+			}
+		}
+
+		nlohmann::json json = nlohmann::json::parse(jsonData, jsonData + jsonChunk[0], nullptr, false);
+		if (json.is_discarded())
+		{
+			LOG_ERROR("Failed to parse glb json: {0}", m_Path);
+			return false;
+		}
+
+		// Only the first buffer may refer to the binary chunk, tinygltf would copy it into a vector so it gets a placeholder instead
+		auto buffers = json.find("buffers");
+		if (m_BinaryChunk && buffers != json.end() && !buffers->empty() && (*buffers)[0].count("uri") == 0)
+		{
+			nlohmann::json& buffer = (*buffers)[0];
+			if (buffer.value("byteLength", (size_t)0) > m_BinaryChunkSize)
+			{
+				LOG_ERROR("glb buffer is larger than its binary chunk: {0}", m_Path);
+				return false;
+			}
+
+			buffer["uri"] = s_PlaceholderBufferURI;
+			buffer["byteLength"] = 1;
+			m_BinaryBuffer = 0;
+		}
+
+		// Images aren't used by meshes, the ones stored in buffer views would be read from the placeholder
+		json.erase("images");
+
+		std::string patchedJson = json.dump();
+
+		tinygltf::TinyGLTF loader;
+		std::string error;
+		std::string warning;
+
+		bool result = loader.LoadASCIIFromString(&m_Model, &error, &warning, patchedJson.c_str(), (unsigned int)patchedJson.size(), Utils::GetBaseDirectory(m_Path));
+		if (!warning.empty())
+			LOG_WARN("{0}: {1}", m_Path, warning);
+		if (!result)
+			LOG_ERROR("Failed to load mesh {0}: {1}", m_Path, error);
+
+		return result;
+	}
+
+	void MeshImporter::ReadLayout()
+	{
+		// Only accessor headers are read here, so buffer sizes and the vertex format are known before anything is copied
+		uint32_t vertexCount = 0;
+		uint32_t indexCount16 = 0;
+		uint32_t indexCount32 = 0;
+		bool halfPositions = true;
+		bool unormTextureCoords = true;
+
+		for (const tinygltf::Mesh& mesh : m_Model.meshes)
+		{
+			for (const tinygltf::Primitive& primitive : mesh.primitives)
+			{
+				ASSERT(primitive.mode == TINYGLTF_MODE_TRIANGLES, "Only triangle lists are supported");
+				ASSERT(primitive.indices >= 0, "Only indexed primitives are supported");
+
+				PrimitiveStreams& streams = m_Primitives.emplace_back();
+				streams.Positions = Utils::GetAttributeStream(m_Model, primitive, "POSITION", m_BinaryChunk, m_BinaryBuffer);
+				streams.Normals = Utils::GetAttributeStream(m_Model, primitive, "NORMAL", m_BinaryChunk, m_BinaryBuffer);
+				streams.Tangents = Utils::GetAttributeStream(m_Model, primitive, "TANGENT", m_BinaryChunk, m_BinaryBuffer);
+				streams.TextureCoords = Utils::GetAttributeStream(m_Model, primitive, "TEXCOORD_0", m_BinaryChunk, m_BinaryBuffer);
+				streams.Indices = Utils::GetAccessorStream(m_Model, primitive.indices, m_BinaryChunk, m_BinaryBuffer);
+				ASSERT(streams.Positions.Data, "Primitive has no positions");
+
+				const MeshSourceStream& positions = streams.Positions;
+				const tinygltf::Accessor& positionAccessor = m_Model.accessors[primitive.attributes.at("POSITION")];
+
+				SubMesh& subMesh = m_SubMeshes.emplace_back();
+				subMesh.VertexOffset = vertexCount;
+				subMesh.VertexCount = positions.Count;
+				subMesh.IndexCount = streams.Indices.Count;
+
+				// Indices are relative to the submesh's first vertex, so only its own vertex count decides the width
+				subMesh.IndexType = positions.Count <= s_MaxVertexCount16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+				uint32_t& indexCount = subMesh.IndexType == VK_INDEX_TYPE_UINT32 ? indexCount32 : indexCount16;
+				subMesh.IndexOffset = indexCount;
+
+				// glTF requires min and max on positions, only scan when an exporter left them out
+				if (positionAccessor.minValues.size() == 3 && positionAccessor.maxValues.size() == 3)
+				{
+					subMesh.BoundsMin = glm::vec3(glm::make_vec3(positionAccessor.minValues.data()));
+					subMesh.BoundsMax = glm::vec3(glm::make_vec3(positionAccessor.maxValues.data()));
+				}
+				else
+				{
+					subMesh.BoundsMin = glm::vec3(std::numeric_limits<float>::max());
+					subMesh.BoundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+					for (uint32_t i = 0; i < positions.Count; i++)
+					{
+						glm::vec3 position;
+						memcpy(&position, positions.Data + (size_t)i * positions.Stride, sizeof(position));
+
+						subMesh.BoundsMin = glm::min(subMesh.BoundsMin, position);
+						subMesh.BoundsMax = glm::max(subMesh.BoundsMax, position);
+					}
+				}
+
+				halfPositions &= glm::all(glm::lessThanEqual(glm::max(glm::abs(subMesh.BoundsMin), glm::abs(subMesh.BoundsMax)), glm::vec3(s_HalfPositionRange)));
+
+				// UNORM can't hold repeating texture coordinates
+				const MeshSourceStream& textureCoords = streams.TextureCoords;
+				if (textureCoords.Data)
+				{
+					const tinygltf::Accessor& accessor = m_Model.accessors[primitive.attributes.at("TEXCOORD_0")];
+					if (accessor.minValues.size() == 2 && accessor.maxValues.size() == 2)
+					{
+						unormTextureCoords &= accessor.minValues[0] >= 0.0 && accessor.minValues[1] >= 0.0 && accessor.maxValues[0] <= 1.0 && accessor.maxValues[1] <= 1.0;
+					}
+					else
+					{
+						for (uint32_t i = 0; i < textureCoords.Count && unormTextureCoords; i++)
+						{
+							glm::vec2 textureCoord;
+							memcpy(&textureCoord, textureCoords.Data + (size_t)i * textureCoords.Stride, sizeof(textureCoord));
+
+							unormTextureCoords &= glm::all(glm::greaterThanEqual(textureCoord, glm::vec2(0.0f))) && glm::all(glm::lessThanEqual(textureCoord, glm::vec2(1.0f)));
+						}
+					}
+				}
+
+				vertexCount += positions.Count;
+				indexCount += subMesh.IndexCount;
+			}
+		}
+
+		m_VertexFormat = VertexFormat::Compact(halfPositions, unormTextureCoords);
+		m_VertexCount = vertexCount;
+		m_IndexCount16 = indexCount16;
+		m_IndexCount32 = indexCount32;
+	}
+
+	void MeshImporter::ReadNodes()
+	{
+		// Primitives were laid out in mesh order, so each glTF mesh's submeshes start where the previous mesh's end
+		std::vector<uint32_t> firstSubMeshes(m_Model.meshes.size());
+		uint32_t subMeshCount = 0;
+		for (size_t i = 0; i < m_Model.meshes.size(); i++)
+		{
+			firstSubMeshes[i] = subMeshCount;
+			subMeshCount += (uint32_t)m_Model.meshes[i].primitives.size();
+		}
+
+		// Roots of the default scene, every node that isn't a child if the file has no scenes
+		std::vector<int> roots;
+		if (!m_Model.scenes.empty())
+		{
+			int scene = m_Model.defaultScene >= 0 && m_Model.defaultScene < (int)m_Model.scenes.size() ? m_Model.defaultScene : 0;
+			roots = m_Model.scenes[scene].nodes;
+		}
+		else
+		{
+			std::vector<bool> isChild(m_Model.nodes.size(), false);
+			for (const tinygltf::Node& node : m_Model.nodes)
+			{
+				for (int child : node.children)
+				{
+					if (child >= 0 && child < (int)isChild.size())
+						isChild[child] = true;
+				}
+			}
+
+			for (int i = 0; i < (int)m_Model.nodes.size(); i++)
+			{
+				if (!isChild[i])
+					roots.push_back(i);
+			}
+		}
+
+		// Breadth first puts every parent in front of its children, nodes are only taken once so broken files with cycles still end
+		std::vector<bool> visited(m_Model.nodes.size(), false);
+		std::vector<int> sourceNodes;
+
+		auto addNode = [&](int sourceNode, uint32_t parent)
+		{
+			if (sourceNode < 0 || sourceNode >= (int)m_Model.nodes.size() || visited[sourceNode])
+				return;
+
+			visited[sourceNode] = true;
+			sourceNodes.push_back(sourceNode);
+			m_Nodes.emplace_back().Parent = parent;
+		};
+
+		for (int root : roots)
+			addNode(root, InvalidMeshNode);
+
+		for (uint32_t i = 0; i < (uint32_t)sourceNodes.size(); i++)
+		{
+			const tinygltf::Node& node = m_Model.nodes[sourceNodes[i]];
+			Utils::ReadNodeTransform(node, m_Nodes[i]);
+
+			if (node.mesh >= 0 && node.mesh < (int)m_Model.meshes.size())
+			{
+				for (uint32_t primitive = 0; primitive < (uint32_t)m_Model.meshes[node.mesh].primitives.size(); primitive++)
+					m_SubMeshInstances.push_back({ firstSubMeshes[node.mesh] + primitive, i });
+			}
+
+			for (int child : node.children)
+				addNode(child, i);
+		}
+
+		// Files without nodes referring to meshes still draw every submesh once
+		if (m_SubMeshInstances.empty())
+		{
+			for (uint32_t i = 0; i < (uint32_t)m_SubMeshes.size(); i++)
+				m_SubMeshInstances.push_back({ i, InvalidMeshNode });
+		}
+	}
+
+	void MeshImporter::Optimize()
+	{
+		std::vector<VertexCacheStatistics> sourceStatistics(m_SubMeshes.size());
+		std::vector<VertexCacheStatistics> optimizedStatistics(m_SubMeshes.size());
+
+		JobSystem::ParallelFor((uint32_t)m_SubMeshes.size(), [&](uint32_t i)
+		{
+			const SubMesh& subMesh = m_SubMeshes[i];
+			PrimitiveStreams& streams = m_Primitives[i];
+			ASSERT(subMesh.IndexCount % 3 == 0, "Index count has to be a multiple of 3");
+
+			std::vector<uint32_t>& indices = streams.OptimizedIndices;
+			indices.resize(subMesh.IndexCount);
+			Utils::CopyIndices(streams.Indices, 0, subMesh.IndexCount, indices.data());
+
+			std::vector<glm::vec3> positions(subMesh.VertexCount);
+			for (uint32_t j = 0; j < subMesh.VertexCount; j++)
+				memcpy(&positions[j], streams.Positions.Data + (size_t)j * streams.Positions.Stride, sizeof(glm::vec3));
+
+			sourceStatistics[i] = MeshOptimizer::AnalyzeVertexCache(indices.data(), subMesh.IndexCount, subMesh.VertexCount);
+
+			MeshOptimizer::OptimizeVertexCache(indices.data(), subMesh.IndexCount, subMesh.VertexCount);
+			MeshOptimizer::OptimizeOverdraw(indices.data(), subMesh.IndexCount, positions.data(), subMesh.VertexCount);
+
+			// Built on the final triangle order, renumbering the vertices afterwards leaves the index ranges valid
+			streams.Meshlets = MeshOptimizer::BuildMeshlets(indices.data(), subMesh.IndexCount, positions.data(), subMesh.VertexCount);
+
+			// Every level halves the one before it, errors add up since each level is measured against the previous one
+			streams.LODs.push_back({ 0, subMesh.IndexCount, 0.0f });
+			while (streams.LODs.size() < MeshMaxLODs)
+			{
+				SubMeshLOD previous = streams.LODs.back();
+				if (previous.IndexCount < s_MinLODTriangles * 3)
+					break;
+
+				float error = 0.0f;
+				std::vector<uint32_t> simplified = MeshOptimizer::Simplify(indices.data() + previous.IndexOffset, previous.IndexCount, positions.data(), subMesh.VertexCount,
+					previous.IndexCount / 6 * 3, &error);
+
+				if (simplified.size() > previous.IndexCount * (1.0f - s_MinLODReduction))
+					break;
+
+				MeshOptimizer::OptimizeVertexCache(simplified.data(), (uint32_t)simplified.size(), subMesh.VertexCount);
+
+				streams.LODs.push_back({ (uint32_t)indices.size(), (uint32_t)simplified.size(), previous.Error + error });
+				indices.insert(indices.end(), simplified.begin(), simplified.end());
+			}
+
+			// Vertex order follows the full detail triangles, the LODs only use vertices LOD0 does and are renumbered to match
+			streams.VertexOrder.resize(subMesh.VertexCount);
+			MeshOptimizer::OptimizeVertexFetch(indices.data(), subMesh.IndexCount, subMesh.VertexCount, streams.VertexOrder.data());
+
+			if (streams.LODs.size() > 1)
+			{
+				std::vector<uint32_t> remap(subMesh.VertexCount);
+				for (uint32_t j = 0; j < subMesh.VertexCount; j++)
+					remap[streams.VertexOrder[j]] = j;
+
+				for (size_t j = subMesh.IndexCount; j < indices.size(); j++)
+					indices[j] = remap[indices[j]];
+			}
+
+			optimizedStatistics[i] = MeshOptimizer::AnalyzeVertexCache(indices.data(), subMesh.IndexCount, subMesh.VertexCount);
+		});
+
+		VertexCacheStatistics source;
+		VertexCacheStatistics optimized;
+
+		// The LODs grow every submesh's index range, so the offsets ReadLayout assigned are laid out again
+		m_IndexCount16 = 0;
+		m_IndexCount32 = 0;
+
+		for (size_t i = 0; i < m_SubMeshes.size(); i++)
+		{
+			SubMesh& subMesh = m_SubMeshes[i];
+			PrimitiveStreams& streams = m_Primitives[i];
+
+			uint32_t& indexCount = subMesh.IndexType == VK_INDEX_TYPE_UINT32 ? m_IndexCount32 : m_IndexCount16;
+			subMesh.IndexOffset = indexCount;
+			indexCount += (uint32_t)streams.OptimizedIndices.size();
+
+			subMesh.LODOffset = (uint32_t)m_LODs.size();
+			subMesh.LODCount = (uint32_t)streams.LODs.size();
+			for (const SubMeshLOD& lod : streams.LODs)
+				m_LODs.push_back({ subMesh.IndexOffset + lod.IndexOffset, lod.IndexCount, lod.Error });
+
+			std::vector<Meshlet>& meshlets = streams.Meshlets;
+			subMesh.MeshletOffset = (uint32_t)m_Meshlets.size();
+			subMesh.MeshletCount = (uint32_t)meshlets.size();
+			m_Meshlets.insert(m_Meshlets.end(), meshlets.begin(), meshlets.end());
+			meshlets = std::vector<Meshlet>();
+
+			source.TransformedVertexCount += sourceStatistics[i].TransformedVertexCount;
+			source.TriangleCount += sourceStatistics[i].TriangleCount;
+			source.VertexCount += sourceStatistics[i].VertexCount;
+
+			optimized.TransformedVertexCount += optimizedStatistics[i].TransformedVertexCount;
+			optimized.TriangleCount += optimizedStatistics[i].TriangleCount;
+			optimized.VertexCount += optimizedStatistics[i].VertexCount;
+		}
+
+		LOG_INFO("Optimized {0}: ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}, {5} meshlets, {6} LODs", m_Path, source.GetACMR(), optimized.GetACMR(), source.GetATVR(), optimized.GetATVR(),
+			m_Meshlets.size(), m_LODs.size());
+	}
+
+	void MeshImporter::WriteVertices(uint8_t* destination) const
+	{
+		uint32_t vertexStride = m_VertexFormat.GetStride();
+
+		// Defaults for attributes a primitive doesn't have, written with a source stride of zero
+		const MeshSourceStream defaultNormal = { reinterpret_cast<const uint8_t*>(&s_DefaultNormal), 0, 3 };
+		const MeshSourceStream defaultTangent = { reinterpret_cast<const uint8_t*>(&s_DefaultTangent), 0, 4 };
+		const MeshSourceStream defaultTextureCoords = { reinterpret_cast<const uint8_t*>(&s_DefaultTextureCoords), 0, 2 };
+
+		Utils::ParallelForRanges((uint32_t)m_SubMeshes.size(), [&](uint32_t subMesh) { return m_SubMeshes[subMesh].VertexCount; }, [&](const Utils::ImportRange& range)
+		{
+			const SubMesh& subMesh = m_SubMeshes[range.SubMesh];
+			const PrimitiveStreams& streams = m_Primitives[range.SubMesh];
+
+			// Every attribute of a range is written by the same job, so each job fills one contiguous block of the destination
+			uint8_t* vertices = destination + (size_t)(subMesh.VertexOffset + range.First) * vertexStride;
+			const uint32_t* vertexOrder = streams.VertexOrder.data() + range.First;
+
+			std::vector<uint8_t> gathered((size_t)range.Count * sizeof(glm::vec4));
+
+			auto encode = [&](VertexSemantic semantic, const MeshSourceStream& source, const MeshSourceStream& fallback)
+			{
+				const MeshSourceStream& stream = source.Data ? source : fallback;
+				if (stream.Stride == 0)
+				{
+					m_VertexFormat.EncodeElement(semantic, stream.Data, 0, stream.ComponentCount, range.Count, vertices);
+					return;
+				}
+
+				// Source vertices are read in fetch order, gathered first so the encode kernels still see one contiguous stream
+				uint32_t elementSize = stream.ComponentCount * sizeof(float);
+				for (uint32_t i = 0; i < range.Count; i++)
+					memcpy(gathered.data() + (size_t)i * elementSize, stream.Data + (size_t)vertexOrder[i] * stream.Stride, elementSize);
+
+				m_VertexFormat.EncodeElement(semantic, gathered.data(), elementSize, stream.ComponentCount, range.Count, vertices);
+			};
+
+			encode(VertexSemantic::POSITION, streams.Positions, streams.Positions);
+			encode(VertexSemantic::NORMAL, streams.Normals, defaultNormal);
+			encode(VertexSemantic::TANGENT, streams.Tangents, defaultTangent);
+			encode(VertexSemantic::TEXCOORD, streams.TextureCoords, defaultTextureCoords);
+		});
+	}
+
+	void MeshImporter::WriteIndices(uint16_t* destination16, uint32_t* destination32) const
+	{
+		// Ranges cover the LODs after each submesh's full detail indices as well
+		Utils::ParallelForRanges((uint32_t)m_SubMeshes.size(), [&](uint32_t subMesh) { return (uint32_t)m_Primitives[subMesh].OptimizedIndices.size(); }, [&](const Utils::ImportRange& range)
+		{
+			const SubMesh& subMesh = m_SubMeshes[range.SubMesh];
+			const uint32_t* indices = m_Primitives[range.SubMesh].OptimizedIndices.data() + range.First;
+
+			if (subMesh.IndexType == VK_INDEX_TYPE_UINT32)
+			{
+				memcpy(destination32 + subMesh.IndexOffset + range.First, indices, range.Count * sizeof(uint32_t));
+			}
+			else
+			{
+				uint16_t* destination = destination16 + subMesh.IndexOffset + range.First;
+				for (uint32_t i = 0; i < range.Count; i++)
+					destination[i] = (uint16_t)indices[i];
+			}
+		});
+	}
+
+}
\ No newline at end of file
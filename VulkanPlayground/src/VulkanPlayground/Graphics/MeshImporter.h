@@ -0,0 +1,163 @@
+#pragma once
+#include "VulkanPlayground/Graphics/VertexFormat.h"
+#include "VulkanPlayground/Graphics/MeshOptimizer.h"
+#include "VulkanPlayground/Core/MappedFile.h"
+#include <tinygltf/tiny_gltf.h>
+#include <glm/glm.hpp>
+
+namespace VKPlayground {
+
+	// Levels of detail per submesh including the full detail one
+	static constexpr uint32_t MeshMaxLODs = 5;
+
+	// Parent of root nodes and node of submeshes drawn without a transform
+	static constexpr uint32_t InvalidMeshNode = ~0u;
+
+	// One level of detail of a submesh, every level indexes the submesh's vertices from the same index buffer
+	struct SubMeshLOD
+	{
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+
+		// Local space distance the simplified surface can be off from the full detail one, 0 for LOD0
+		float Error = 0.0f;
+	};
+
+	struct SubMesh
+	{
+		uint32_t VertexOffset = 0;
+		uint32_t VertexCount = 0;
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+
+		// 16-bit unless the submesh has more vertices than that can address, IndexOffset counts indices of this width
+		VkIndexType IndexType = VK_INDEX_TYPE_UINT16;
+
+		// Range of the mesh's meshlets covering this submesh, their FirstIndex is relative to IndexOffset
+		uint32_t MeshletOffset = 0;
+		uint32_t MeshletCount = 0;
+
+		// Range of the mesh's LODs from full detail to coarsest, the first one is IndexOffset and IndexCount
+		uint32_t LODOffset = 0;
+		uint32_t LODCount = 0;
+
+		// Local space bounding box
+		glm::vec3 BoundsMin = glm::vec3(0.0f);
+		glm::vec3 BoundsMax = glm::vec3(0.0f);
+	};
+
+	// Node of the glTF scene with its local transform, nodes are flattened so every parent comes before its children
+	struct MeshNode
+	{
+		// Index into the flattened nodes, InvalidMeshNode for roots
+		uint32_t Parent = InvalidMeshNode;
+
+		glm::vec3 Translation = glm::vec3(0.0f);
+		glm::vec4 Rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);	// Quaternion in glTF order, xyzw
+		glm::vec3 Scale = glm::vec3(1.0f);
+	};
+
+	// Submesh drawn at a node, a submesh is listed once for every node that refers to its glTF mesh
+	struct SubMeshInstance
+	{
+		uint32_t SubMesh = 0;
+
+		// InvalidMeshNode if the file has no nodes and the submesh is drawn without a transform
+		uint32_t Node = InvalidMeshNode;
+	};
+
+	// One attribute or index stream of a primitive in the source buffers, Data is nullptr if the primitive doesn't have it
+	struct MeshSourceStream
+	{
+		const uint8_t* Data = nullptr;
+		uint32_t Stride = 0;
+		uint32_t ComponentCount = 0;
+		int ComponentType = 0;
+		uint32_t Count = 0;
+	};
+
+	// Reads .gltf and .glb files into the layout the renderer draws from, without touching Vulkan so the cook tool can use it too.
+	// The constructor reads accessor headers to size the mesh and reorders every primitive's triangles and vertices,
+	// the Write functions then encode into memory the caller owns.
+	class MeshImporter
+	{
+	public:
+		MeshImporter(const std::string& path);
+		~MeshImporter();
+
+	public:
+		// False if the file couldn't be read or isn't valid glTF, the error is logged and the importer is left empty
+		inline bool IsLoaded() const { return m_Loaded; }
+
+		inline const std::vector<SubMesh>& GetSubMeshes() const { return m_SubMeshes; }
+		inline const VertexFormat& GetVertexFormat() const { return m_VertexFormat; }
+		inline uint32_t GetVertexCount() const { return m_VertexCount; }
+		inline uint32_t GetIndexCount(VkIndexType indexType) const { return indexType == VK_INDEX_TYPE_UINT32 ? m_IndexCount32 : m_IndexCount16; }
+		inline const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; }
+		inline const std::vector<SubMeshLOD>& GetLODs() const { return m_LODs; }
+		inline const std::vector<MeshNode>& GetNodes() const { return m_Nodes; }
+		inline const std::vector<SubMeshInstance>& GetSubMeshInstances() const { return m_SubMeshInstances; }
+
+		inline const tinygltf::Model& GetModel() const { return m_Model; }
+
+		// destination has to hold GetVertexCount() vertices of GetVertexFormat().GetStride() bytes.
+		// Both writes split every primitive into ranges that are encoded in parallel on the job system.
+		void WriteVertices(uint8_t* destination) const;
+
+		// Submeshes are written to the destination of their IndexType, each has to hold GetIndexCount() indices of that type
+		void WriteIndices(uint16_t* destination16, uint32_t* destination32) const;
+
+	private:
+		struct PrimitiveStreams
+		{
+			MeshSourceStream Positions;
+			MeshSourceStream Normals;
+			MeshSourceStream Tangents;
+			MeshSourceStream TextureCoords;
+			MeshSourceStream Indices;
+
+			// Triangle order after the vertex cache, overdraw and vertex fetch passes, relative to the submesh's first vertex.
+			// The simplified LODs follow the full detail indices.
+			std::vector<uint32_t> OptimizedIndices;
+
+			// Source vertex of every output vertex, vertices are written in the order OptimizedIndices first uses them
+			std::vector<uint32_t> VertexOrder;
+
+			std::vector<Meshlet> Meshlets;
+
+			// IndexOffset is relative to the start of OptimizedIndices
+			std::vector<SubMeshLOD> LODs;
+		};
+
+		bool LoadBinary();
+		void ReadLayout();
+		void ReadNodes();
+		void Optimize();
+
+	private:
+		std::string m_Path;
+		tinygltf::Model m_Model;
+		bool m_Loaded = false;
+
+		// A .glb stays mapped while its binary chunk is read in place instead of being copied into a tinygltf::Buffer
+		Scope<MappedFile> m_File;
+		const uint8_t* m_BinaryChunk = nullptr;
+		size_t m_BinaryChunkSize = 0;
+		int m_BinaryBuffer = -1;
+
+		std::vector<SubMesh> m_SubMeshes;
+		std::vector<Meshlet> m_Meshlets;
+		std::vector<SubMeshLOD> m_LODs;
+		std::vector<MeshNode> m_Nodes;
+		std::vector<SubMeshInstance> m_SubMeshInstances;
+
+		// Resolved once per primitive in SubMesh order, the write passes never look at the glTF maps
+		std::vector<PrimitiveStreams> m_Primitives;
+
+		VertexFormat m_VertexFormat;
+		uint32_t m_VertexCount = 0;
+		uint32_t m_IndexCount16 = 0;
+		uint32_t m_IndexCount32 = 0;
+	};
+
+}
@@ -0,0 +1,810 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+
+namespace VKPlayground {
+
+	// Post-transform cache entries assumed by every pass, small enough to hold on all current hardware
+	static const uint32_t s_VertexCacheSize = 16;
+
+	static const uint32_t s_InvalidVertex = ~0u;
+
+	// Normal cones wider than this (about 168 degrees) are practically never backfacing and are left disabled
+	static const float s_MinConeDot = 0.1f;
+
+	// Weight of the planes that hold open borders in place relative to the surface planes around them
+	static const float s_BorderWeight = 10.0f;
+
+	// Cosine of the largest turn a collapse may give a triangle around the moved vertex, about 45 degrees. Only rejecting
+	// flipped triangles lets thin ones turn over a little at a time across passes.
+	static const float s_MinNormalDot = 0.7f;
+
+	// Collapses costing more than this multiple of the ones needed to reach the target wait for the next pass, when cheaper ones might have opened up
+	static const double s_PassErrorScale = 1.5;
+
+	namespace Utils {
+
+		// Triangles using each vertex, a vertex used twice by a degenerate triangle lists it twice
+		struct TriangleAdjacency
+		{
+			std::vector<uint32_t> Offsets;
+			std::vector<uint32_t> Counts;
+			std::vector<uint32_t> Triangles;
+		};
+
+		static TriangleAdjacency BuildAdjacency(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+		{
+			TriangleAdjacency adjacency;
+			adjacency.Offsets.resize(vertexCount);
+			adjacency.Counts.resize(vertexCount, 0);
+			adjacency.Triangles.resize(indexCount);
+
+			for (uint32_t i = 0; i < indexCount; i++)
+			{
+				ASSERT(indices[i] < vertexCount, "Index out of range");
+				adjacency.Counts[indices[i]]++;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				adjacency.Offsets[i] = offset;
+				offset += adjacency.Counts[i];
+			}
+
+			// Offsets are advanced while filling and moved back afterwards
+			for (uint32_t i = 0; i < indexCount; i++)
+				adjacency.Triangles[adjacency.Offsets[indices[i]]++] = i / 3;
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+				adjacency.Offsets[i] -= adjacency.Counts[i];
+
+			return adjacency;
+		}
+
+		// Timestamp cache used by the reordering passes, a vertex counts as cached if it was transformed in the last s_VertexCacheSize misses
+		static uint32_t UpdateCache(const uint32_t* triangle, std::vector<uint32_t>& cacheTime, uint32_t& time)
+		{
+			uint32_t misses = 0;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				uint32_t vertex = triangle[i];
+				if (time - cacheTime[vertex] > s_VertexCacheSize)
+				{
+					cacheTime[vertex] = time++;
+					misses++;
+				}
+			}
+
+			return misses;
+		}
+
+		static void ResetCache(uint32_t& time)
+		{
+			time += s_VertexCacheSize + 1;
+		}
+
+		static uint32_t GetNextVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& liveTriangles, const std::vector<uint32_t>& cacheTime, uint32_t time,
+			std::vector<uint32_t>& deadEnds, uint32_t& cursor)
+		{
+			// Prefer the oldest candidate that will still be cached once all of its remaining triangles are emitted
+			uint32_t bestVertex = s_InvalidVertex;
+			int bestPriority = -1;
+
+			for (uint32_t vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0)
+					continue;
+
+				int priority = 0;
+				if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= s_VertexCacheSize)
+					priority = (int)(time - cacheTime[vertex]);
+
+				if (priority > bestPriority)
+				{
+					bestVertex = vertex;
+					bestPriority = priority;
+				}
+			}
+
+			if (bestVertex != s_InvalidVertex)
+				return bestVertex;
+
+			// Dead end, go back to the most recently emitted vertex that still has triangles
+			while (!deadEnds.empty())
+			{
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+
+				if (liveTriangles[vertex] > 0)
+					return vertex;
+			}
+
+			// Disconnected part of the mesh, continue with the next vertex in input order
+			for (; cursor < liveTriangles.size(); cursor++)
+			{
+				if (liveTriangles[cursor] > 0)
+					return cursor;
+			}
+
+			return s_InvalidVertex;
+		}
+
+		// Area weighted sum of squared plane distances, the symmetric 4x4 matrix of the quadric error metric split into A, b and c
+		struct Quadric
+		{
+			double A00 = 0.0, A11 = 0.0, A22 = 0.0;
+			double A01 = 0.0, A02 = 0.0, A12 = 0.0;
+			double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+			double C = 0.0;
+			double Weight = 0.0;
+		};
+
+		static void AddPlane(Quadric& quadric, const glm::vec3& normal, float distance, float weight)
+		{
+			quadric.A00 += weight * normal.x * normal.x;
+			quadric.A11 += weight * normal.y * normal.y;
+			quadric.A22 += weight * normal.z * normal.z;
+			quadric.A01 += weight * normal.x * normal.y;
+			quadric.A02 += weight * normal.x * normal.z;
+			quadric.A12 += weight * normal.y * normal.z;
+			quadric.B0 += weight * normal.x * distance;
+			quadric.B1 += weight * normal.y * distance;
+			quadric.B2 += weight * normal.z * distance;
+			quadric.C += weight * distance * distance;
+			quadric.Weight += weight;
+		}
+
+		static void AddQuadric(Quadric& quadric, const Quadric& other)
+		{
+			quadric.A00 += other.A00;
+			quadric.A11 += other.A11;
+			quadric.A22 += other.A22;
+			quadric.A01 += other.A01;
+			quadric.A02 += other.A02;
+			quadric.A12 += other.A12;
+			quadric.B0 += other.B0;
+			quadric.B1 += other.B1;
+			quadric.B2 += other.B2;
+			quadric.C += other.C;
+			quadric.Weight += other.Weight;
+		}
+
+		// Weighted mean squared distance of the point to the planes
+		static double EvaluateQuadric(const Quadric& quadric, const glm::vec3& point)
+		{
+			if (quadric.Weight <= 0.0)
+				return 0.0;
+
+			double x = point.x, y = point.y, z = point.z;
+			double error = quadric.A00 * x * x + quadric.A11 * y * y + quadric.A22 * z * z
+				+ 2.0 * (quadric.A01 * x * y + quadric.A02 * x * z + quadric.A12 * y * z)
+				+ 2.0 * (quadric.B0 * x + quadric.B1 * y + quadric.B2 * z)
+				+ quadric.C;
+
+			return std::abs(error) / quadric.Weight;
+		}
+
+		static double EvaluateCollapse(const Quadric& source, const Quadric& target, const glm::vec3& point)
+		{
+			Quadric quadric = source;
+			AddQuadric(quadric, target);
+			return EvaluateQuadric(quadric, point);
+		}
+
+		enum class VertexKind : uint8_t
+		{
+			Manifold, // Interior vertex, can collapse onto any neighbour
+			Border,   // On exactly two open edges, can only collapse along them
+			Locked    // Shares its position with another vertex or sits on a non-manifold border, never moves
+		};
+
+		static uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+		{
+			return ((uint64_t)a << 32) | b;
+		}
+
+		// Triangles around source that survive moving it onto target must keep facing roughly the same way
+		static bool FlipsTriangle(uint32_t source, uint32_t target, const TriangleAdjacency& adjacency, const std::vector<uint32_t>& indices,
+			const std::vector<uint32_t>& collapseTarget, const glm::vec3* positions)
+		{
+			uint32_t begin = adjacency.Offsets[source];
+			uint32_t end = begin + adjacency.Counts[source];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t triangle = adjacency.Triangles[i];
+				uint32_t a = collapseTarget[indices[triangle * 3 + 0]];
+				uint32_t b = collapseTarget[indices[triangle * 3 + 1]];
+				uint32_t c = collapseTarget[indices[triangle * 3 + 2]];
+
+				// Degenerate already or removed by this collapse
+				if (a == b || b == c || c == a || a == target || b == target || c == target)
+					continue;
+
+				glm::vec3 before = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+
+				glm::vec3 pa = positions[a == source ? target : a];
+				glm::vec3 pb = positions[b == source ? target : b];
+				glm::vec3 pc = positions[c == source ? target : c];
+				glm::vec3 after = glm::cross(pb - pa, pc - pa);
+
+				if (glm::dot(before, after) <= s_MinNormalDot * glm::length(before) * glm::length(after))
+					return true;
+			}
+
+			return false;
+		}
+
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+	{
+		ASSERT(indexCount % 3 == 0, "Index count has to be a multiple of 3");
+
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		Utils::TriangleAdjacency adjacency = Utils::BuildAdjacency(indices, indexCount, vertexCount);
+
+		std::vector<uint32_t> liveTriangles = adjacency.Counts;
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<uint8_t> emitted(triangleCount, 0);
+
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		deadEnds.reserve(indexCount);
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+
+		uint32_t time = s_VertexCacheSize + 1;
+		uint32_t cursor = 0;
+		uint32_t vertex = indices[0];
+
+		while (vertex != s_InvalidVertex)
+		{
+			candidates.clear();
+
+			uint32_t begin = adjacency.Offsets[vertex];
+			uint32_t end = begin + adjacency.Counts[vertex];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t triangle = adjacency.Triangles[i];
+				if (emitted[triangle])
+					continue;
+
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					uint32_t triangleVertex = indices[triangle * 3 + j];
+					output.push_back(triangleVertex);
+					deadEnds.push_back(triangleVertex);
+					candidates.push_back(triangleVertex);
+					liveTriangles[triangleVertex]--;
+
+					if (time - cacheTime[triangleVertex] > s_VertexCacheSize)
+						cacheTime[triangleVertex] = time++;
+				}
+
+				emitted[triangle] = 1;
+			}
+
+			vertex = Utils::GetNextVertex(candidates, liveTriangles, cacheTime, time, deadEnds, cursor);
+		}
+
+		ASSERT(output.size() == indexCount, "Vertex cache optimization lost triangles");
+		memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, float threshold)
+	{
+		ASSERT(indexCount % 3 == 0, "Index count has to be a multiple of 3");
+
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		uint32_t time = s_VertexCacheSize + 1;
+
+		// Hard boundaries are where the cache order starts over with three misses, the order between them doesn't affect the cache
+		std::vector<uint32_t> hardClusters;
+		for (uint32_t i = 0; i < triangleCount; i++)
+		{
+			if (Utils::UpdateCache(indices + i * 3, cacheTime, time) == 3 || i == 0)
+				hardClusters.push_back(i);
+		}
+		hardClusters.push_back(triangleCount);
+
+		// Soft boundaries split a hard cluster further wherever the part before it is already within the miss ratio target
+		std::vector<uint32_t> clusters;
+		for (size_t i = 0; i + 1 < hardClusters.size(); i++)
+		{
+			uint32_t start = hardClusters[i];
+			uint32_t end = hardClusters[i + 1];
+
+			Utils::ResetCache(time);
+			uint32_t misses = 0;
+			for (uint32_t j = start; j < end; j++)
+				misses += Utils::UpdateCache(indices + j * 3, cacheTime, time);
+
+			float targetMissRatio = (float)misses / (end - start) * threshold;
+
+			Utils::ResetCache(time);
+			clusters.push_back(start);
+
+			uint32_t clusterStart = start;
+			uint32_t clusterMisses = 0;
+			for (uint32_t j = start; j < end; j++)
+			{
+				clusterMisses += Utils::UpdateCache(indices + j * 3, cacheTime, time);
+
+				if (j + 1 < end && clusterMisses <= targetMissRatio * (j + 1 - clusterStart))
+				{
+					clusters.push_back(j + 1);
+					clusterStart = j + 1;
+					clusterMisses = 0;
+
+					Utils::ResetCache(time);
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		uint32_t clusterCount = (uint32_t)clusters.size() - 1;
+
+		// Area weighted centroid and normal of every cluster, clusters facing away from the mesh center occlude the rest
+		std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+		std::vector<float> clusterAreas(clusterCount, 0.0f);
+
+		glm::vec3 meshCentroid = glm::vec3(0.0f);
+		float meshArea = 0.0f;
+
+		for (uint32_t i = 0; i < clusterCount; i++)
+		{
+			for (uint32_t j = clusters[i]; j < clusters[i + 1]; j++)
+			{
+				const glm::vec3& a = positions[indices[j * 3 + 0]];
+				const glm::vec3& b = positions[indices[j * 3 + 1]];
+				const glm::vec3& c = positions[indices[j * 3 + 2]];
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float area = glm::length(normal);
+
+				clusterCentroids[i] += (a + b + c) * (area / 3.0f);
+				clusterNormals[i] += normal;
+				clusterAreas[i] += area;
+			}
+
+			meshCentroid += clusterCentroids[i];
+			meshArea += clusterAreas[i];
+		}
+
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		std::vector<float> sortKeys(clusterCount);
+		for (uint32_t i = 0; i < clusterCount; i++)
+		{
+			glm::vec3 centroid = clusterAreas[i] > 0.0f ? clusterCentroids[i] / clusterAreas[i] : meshCentroid;
+			float normalLength = glm::length(clusterNormals[i]);
+
+			sortKeys[i] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, clusterNormals[i] / normalLength) : 0.0f;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (uint32_t i = 0; i < clusterCount; i++)
+			order[i] = i;
+
+		// Stable so clusters with equal keys keep their cache order, which keeps the output deterministic
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+
+		for (uint32_t cluster : order)
+			output.insert(output.end(), indices + clusters[cluster] * 3, indices + clusters[cluster + 1] * 3);
+
+		memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+	}
+
+	void MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* outVertexOrder)
+	{
+		std::vector<uint32_t> remap(vertexCount, s_InvalidVertex);
+		uint32_t nextVertex = 0;
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t vertex = indices[i];
+			ASSERT(vertex < vertexCount, "Index out of range");
+
+			if (remap[vertex] == s_InvalidVertex)
+			{
+				remap[vertex] = nextVertex;
+				outVertexOrder[nextVertex++] = vertex;
+			}
+
+			indices[i] = remap[vertex];
+		}
+
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			if (remap[i] == s_InvalidVertex)
+				outVertexOrder[nextVertex++] = i;
+		}
+	}
+
+	std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount)
+	{
+		ASSERT(indexCount % 3 == 0, "Index count has to be a multiple of 3");
+
+		std::vector<Meshlet> meshlets;
+
+		// Meshlet each vertex was last added to, offset by one so zero means none
+		std::vector<uint32_t> vertexMeshlet(vertexCount, 0);
+		std::vector<uint32_t> meshletVertices;
+		meshletVertices.reserve(MeshletMaxVertices);
+
+		auto finishMeshlet = [&](uint32_t endIndex)
+		{
+			Meshlet& meshlet = meshlets.back();
+			meshlet.IndexCount = endIndex - meshlet.FirstIndex;
+			meshlet.VertexCount = (uint32_t)meshletVertices.size();
+
+			// Sphere around the center of the bounding box, tight enough for clusters this small
+			glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+			for (uint32_t vertex : meshletVertices)
+			{
+				boundsMin = glm::min(boundsMin, positions[vertex]);
+				boundsMax = glm::max(boundsMax, positions[vertex]);
+			}
+
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t vertex : meshletVertices)
+				radius = std::max(radius, glm::distance(center, positions[vertex]));
+
+			meshlet.BoundingSphere = glm::vec4(center, radius);
+
+			glm::vec3 normalSum = glm::vec3(0.0f);
+			for (uint32_t i = meshlet.FirstIndex; i < endIndex; i += 3)
+			{
+				glm::vec3 normal = glm::cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]);
+				float length = glm::length(normal);
+				if (length > 0.0f)
+					normalSum += normal / length;
+			}
+
+			float normalLength = glm::length(normalSum);
+			if (normalLength == 0.0f)
+				return;
+
+			glm::vec3 axis = normalSum / normalLength;
+
+			float minDot = 1.0f;
+			for (uint32_t i = meshlet.FirstIndex; i < endIndex; i += 3)
+			{
+				glm::vec3 normal = glm::cross(positions[indices[i + 1]] - positions[indices[i]], positions[indices[i + 2]] - positions[indices[i]]);
+				float length = glm::length(normal);
+				if (length > 0.0f)
+					minDot = std::min(minDot, glm::dot(normal / length, axis));
+			}
+
+			// Every triangle faces away from a viewer whose direction to the sphere is within 90 degrees minus the cone angle of the axis
+			if (minDot > s_MinConeDot)
+				meshlet.NormalCone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+		};
+
+		for (uint32_t i = 0; i < indexCount; i += 3)
+		{
+			uint32_t newVertices = 0;
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				ASSERT(indices[i + j] < vertexCount, "Index out of range");
+
+				// A degenerate triangle can use the same new vertex twice, only count it once
+				uint32_t vertex = indices[i + j];
+				bool repeated = (j > 0 && indices[i] == vertex) || (j > 1 && indices[i + 1] == vertex);
+				if (vertexMeshlet[vertex] != meshlets.size() && !repeated)
+					newVertices++;
+			}
+
+			bool full = !meshlets.empty() && (meshletVertices.size() + newVertices > MeshletMaxVertices || i - meshlets.back().FirstIndex >= MeshletMaxTriangles * 3);
+			if (meshlets.empty() || full)
+			{
+				if (!meshlets.empty())
+					finishMeshlet(i);
+
+				meshlets.emplace_back().FirstIndex = i;
+				meshletVertices.clear();
+			}
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				uint32_t vertex = indices[i + j];
+				if (vertexMeshlet[vertex] != meshlets.size())
+				{
+					vertexMeshlet[vertex] = (uint32_t)meshlets.size();
+					meshletVertices.push_back(vertex);
+				}
+			}
+		}
+
+		if (!meshlets.empty())
+			finishMeshlet(indexCount);
+
+		return meshlets;
+	}
+
+	std::vector<uint32_t> MeshOptimizer::Simplify(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, uint32_t targetIndexCount, float* outError)
+	{
+		ASSERT(indexCount % 3 == 0, "Index count has to be a multiple of 3");
+
+		std::vector<uint32_t> result(indices, indices + indexCount);
+		*outError = 0.0f;
+
+		if (indexCount <= targetIndexCount)
+			return result;
+
+		// Vertices that only differ in attributes share a position, the first one in position order stands for all of them
+		std::vector<uint32_t> positionOrder(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++)
+			positionOrder[i] = i;
+
+		std::sort(positionOrder.begin(), positionOrder.end(), [positions](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& pa = positions[a];
+			const glm::vec3& pb = positions[b];
+			return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+		});
+
+		std::vector<uint32_t> positionRemap(vertexCount);
+		std::vector<Utils::VertexKind> kinds(vertexCount, Utils::VertexKind::Manifold);
+
+		for (uint32_t i = 0; i < vertexCount; )
+		{
+			uint32_t end = i + 1;
+			while (end < vertexCount && positions[positionOrder[end]] == positions[positionOrder[i]])
+				end++;
+
+			for (uint32_t j = i; j < end; j++)
+			{
+				positionRemap[positionOrder[j]] = positionOrder[i];
+
+				// Moving one side of a seam would tear it open, so seams stay where they are
+				if (end - i > 1)
+					kinds[positionOrder[j]] = Utils::VertexKind::Locked;
+			}
+
+			i = end;
+		}
+
+		// An edge is open if no triangle uses it in the opposite direction
+		std::unordered_set<uint64_t> edges;
+		edges.reserve(indexCount);
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t a = positionRemap[indices[i]];
+			uint32_t b = positionRemap[indices[i - i % 3 + (i + 1) % 3]];
+			edges.insert(Utils::GetEdgeKey(a, b));
+		}
+
+		auto isOpenEdge = [&](uint32_t a, uint32_t b)
+		{
+			return !edges.count(Utils::GetEdgeKey(positionRemap[a], positionRemap[b])) || !edges.count(Utils::GetEdgeKey(positionRemap[b], positionRemap[a]));
+		};
+
+		std::vector<Utils::Quadric> quadrics(vertexCount);
+		std::vector<uint8_t> openEdgeCounts(vertexCount, 0);
+
+		for (uint32_t i = 0; i < indexCount; i += 3)
+		{
+			const glm::vec3& p0 = positions[indices[i + 0]];
+			const glm::vec3& p1 = positions[indices[i + 1]];
+			const glm::vec3& p2 = positions[indices[i + 2]];
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length == 0.0f)
+				continue;
+
+			normal /= length;
+			float area = length * 0.5f;
+
+			for (uint32_t j = 0; j < 3; j++)
+				Utils::AddPlane(quadrics[indices[i + j]], normal, -glm::dot(normal, p0), area);
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				uint32_t a = indices[i + j];
+				uint32_t b = indices[i + (j + 1) % 3];
+				if (!isOpenEdge(a, b))
+					continue;
+
+				// Plane through the open edge at a right angle to the triangle, keeps the outline from shrinking
+				glm::vec3 edge = positions[b] - positions[a];
+				glm::vec3 borderNormal = glm::cross(edge, normal);
+				float borderLength = glm::length(borderNormal);
+				if (borderLength == 0.0f)
+					continue;
+
+				borderNormal /= borderLength;
+				float weight = glm::dot(edge, edge) * s_BorderWeight;
+
+				Utils::AddPlane(quadrics[a], borderNormal, -glm::dot(borderNormal, positions[a]), weight);
+				Utils::AddPlane(quadrics[b], borderNormal, -glm::dot(borderNormal, positions[a]), weight);
+
+				openEdgeCounts[a] = (uint8_t)std::min(openEdgeCounts[a] + 1, 255);
+				openEdgeCounts[b] = (uint8_t)std::min(openEdgeCounts[b] + 1, 255);
+			}
+		}
+
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			if (kinds[i] == Utils::VertexKind::Locked || openEdgeCounts[i] == 0)
+				continue;
+
+			kinds[i] = openEdgeCounts[i] == 2 ? Utils::VertexKind::Border : Utils::VertexKind::Locked;
+		}
+
+		auto canCollapse = [&](uint32_t source, uint32_t target)
+		{
+			if (kinds[source] == Utils::VertexKind::Manifold)
+				return true;
+
+			return kinds[source] == Utils::VertexKind::Border && kinds[target] != Utils::VertexKind::Manifold && isOpenEdge(source, target);
+		};
+
+		struct Collapse
+		{
+			uint32_t Source;
+			uint32_t Target;
+			double Error;
+		};
+
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> collapseTarget(vertexCount);
+		std::vector<uint8_t> collapsed(vertexCount);
+		double maxError = 0.0;
+
+		// Every pass moves each vertex at most once, so the adjacency and edge costs it starts with stay valid throughout
+		while (result.size() > targetIndexCount)
+		{
+			uint32_t resultCount = (uint32_t)result.size();
+			Utils::TriangleAdjacency adjacency = Utils::BuildAdjacency(result.data(), resultCount, vertexCount);
+
+			collapses.clear();
+			for (uint32_t i = 0; i < resultCount; i++)
+			{
+				uint32_t a = result[i];
+				uint32_t b = result[i - i % 3 + (i + 1) % 3];
+				if (a == b)
+					continue;
+
+				// Interior edges come up once from each side, which keeps only one of the two directions per visit
+				bool collapseA = canCollapse(a, b);
+				bool collapseB = canCollapse(b, a);
+				if (!collapseA && !collapseB)
+					continue;
+
+				double errorA = collapseA ? Utils::EvaluateCollapse(quadrics[a], quadrics[b], positions[b]) : std::numeric_limits<double>::max();
+				double errorB = collapseB ? Utils::EvaluateCollapse(quadrics[b], quadrics[a], positions[a]) : std::numeric_limits<double>::max();
+
+				if (errorA <= errorB)
+					collapses.push_back({ a, b, errorA });
+				else
+					collapses.push_back({ b, a, errorB });
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+			uint32_t triangleGoal = (resultCount - targetIndexCount + 2) / 3;
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+				collapseTarget[i] = i;
+			std::fill(collapsed.begin(), collapsed.end(), 0);
+
+			uint32_t removedTriangles = 0;
+			uint32_t collapseCount = 0;
+
+			// The error limit comes from the collapses that reach the goal, most remove two triangles. Every rejected candidate moves it
+			// one further, otherwise cheap collapses that always flip a triangle would shrink every pass down to a single collapse.
+			size_t limitIndex = triangleGoal / 2;
+
+			for (const Collapse& collapse : collapses)
+			{
+				double errorLimit = collapses[std::min(limitIndex, collapses.size() - 1)].Error * s_PassErrorScale;
+				if (removedTriangles >= triangleGoal || (collapse.Error > errorLimit && collapseCount > 0))
+					break;
+
+				if (collapsed[collapse.Source] || collapsed[collapse.Target])
+					continue;
+
+				if (Utils::FlipsTriangle(collapse.Source, collapse.Target, adjacency, result, collapseTarget, positions))
+				{
+					limitIndex++;
+					continue;
+				}
+
+				uint32_t begin = adjacency.Offsets[collapse.Source];
+				uint32_t end = begin + adjacency.Counts[collapse.Source];
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const uint32_t* triangle = &result[adjacency.Triangles[i] * 3];
+					if (collapseTarget[triangle[0]] == collapse.Target || collapseTarget[triangle[1]] == collapse.Target || collapseTarget[triangle[2]] == collapse.Target)
+						removedTriangles++;
+				}
+
+				// Collapses are ordered by the combined quadric, but the target's own planes pass through it and would halve the
+				// distance reported to the caller, so only the planes of the vertex that moves count
+				maxError = std::max(maxError, Utils::EvaluateQuadric(quadrics[collapse.Source], positions[collapse.Target]));
+
+				collapseTarget[collapse.Source] = collapse.Target;
+				collapsed[collapse.Source] = 1;
+				collapsed[collapse.Target] = 1;
+				Utils::AddQuadric(quadrics[collapse.Target], quadrics[collapse.Source]);
+				collapseCount++;
+			}
+
+			if (collapseCount == 0)
+				break;
+
+			uint32_t writeIndex = 0;
+			for (uint32_t i = 0; i < resultCount; i += 3)
+			{
+				uint32_t a = collapseTarget[result[i + 0]];
+				uint32_t b = collapseTarget[result[i + 1]];
+				uint32_t c = collapseTarget[result[i + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+
+			result.resize(writeIndex);
+		}
+
+		*outError = (float)std::sqrt(maxError);
+		return result;
+	}
+
+	VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+	{
+		VertexCacheStatistics statistics;
+		statistics.TriangleCount = indexCount / 3;
+
+		uint32_t cache[s_VertexCacheSize];
+		std::fill(cache, cache + s_VertexCacheSize, s_InvalidVertex);
+		uint32_t cacheHead = 0;
+
+		std::vector<uint8_t> referenced(vertexCount, 0);
+
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t vertex = indices[i];
+			ASSERT(vertex < vertexCount, "Index out of range");
+
+			if (!referenced[vertex])
+			{
+				referenced[vertex] = 1;
+				statistics.VertexCount++;
+			}
+
+			if (std::find(cache, cache + s_VertexCacheSize, vertex) == cache + s_VertexCacheSize)
+			{
+				cache[cacheHead] = vertex;
+				cacheHead = (cacheHead + 1) % s_VertexCacheSize;
+				statistics.TransformedVertexCount++;
+			}
+		}
+
+		return statistics;
+	}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace VKPlayground {
+
+	// Triangle cluster small enough to cull on its own, matches Meshlet in meshlet_cull.shader (std430)
+	struct Meshlet
+	{
+		// Local space bounding sphere, xyz is the center and w the radius
+		glm::vec4 BoundingSphere = glm::vec4(0.0f);
+
+		// Average triangle normal in xyz, w is the cutoff of the backface test or 1.0 if the normals spread too far to ever pass it
+		glm::vec4 NormalCone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+		// Contiguous range of the submesh's indices
+		uint32_t FirstIndex = 0;
+		uint32_t IndexCount = 0;
+		uint32_t VertexCount = 0;
+		uint32_t Padding = 0;
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet has to match the std430 layout in meshlet_cull.shader");
+	static_assert(offsetof(Meshlet, FirstIndex) == 32, "Meshlet has to match the std430 layout in meshlet_cull.shader");
+
+	static constexpr uint32_t MeshletMaxVertices = 64;
+	static constexpr uint32_t MeshletMaxTriangles = 124;
+
+	struct VertexCacheStatistics
+	{
+		uint32_t TransformedVertexCount = 0;
+		uint32_t TriangleCount = 0;
+
+		// Vertices referenced by at least one triangle
+		uint32_t VertexCount = 0;
+
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is the best a regular grid can reach, 3.0 the worst
+		inline float GetACMR() const { return TriangleCount > 0 ? (float)TransformedVertexCount / TriangleCount : 0.0f; }
+
+		// Average transform to vertex ratio, 1.0 means every vertex is transformed exactly once
+		inline float GetATVR() const { return VertexCount > 0 ? (float)TransformedVertexCount / VertexCount : 0.0f; }
+	};
+
+	// Reorders triangle lists for the post-transform vertex cache and early depth rejection, then renumbers vertices for fetch locality.
+	// All passes work in place on 32-bit triangle list indices and are meant to be run in the order they are declared.
+	class MeshOptimizer
+	{
+	public:
+		// Tipsify (Sander et al. 2007), emits the triangles around one vertex at a time and moves on to a vertex that is still in the cache
+		static void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+		// Splits the vertex cache order into clusters and draws the outward facing ones first, clusters are only split
+		// where their cache miss ratio stays within threshold times that of the unsplit order
+		static void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, float threshold = 1.05f);
+
+		// Renumbers vertices in the order the indices first use them. outVertexOrder[newIndex] is the old index of a vertex
+		// and has to hold vertexCount entries, unreferenced vertices are moved to the end
+		static void OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* outVertexOrder);
+
+		// Splits the triangles in their current order into meshlets of at most MeshletMaxVertices unique vertices and MeshletMaxTriangles
+		// triangles. The triangles aren't moved, so the index buffer can be drawn as a whole or one meshlet range at a time.
+		static std::vector<Meshlet> BuildMeshlets(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount);
+
+		// Quadric error edge collapse (Garland and Heckbert 1997) down to about targetIndexCount indices. Vertices only ever move onto a neighbour,
+		// so the result indexes the same vertex buffer. Vertices on attribute seams are kept in place and open borders only collapse along themselves.
+		// outError receives the distance in local space between the simplified and the input surface, stops early if nothing can collapse anymore.
+		static std::vector<uint32_t> Simplify(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, uint32_t targetIndexCount, float* outError);
+
+		// Simulates a FIFO post-transform cache of typical hardware size
+		static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+	};
+
+}
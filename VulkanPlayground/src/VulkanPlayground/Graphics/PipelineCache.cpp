@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "PipelineCache.h"
+#include "VulkanPlayground/Core/VulkanTools.h"
+#include "VulkanPlayground/Core/JobSystem.h"
+#include "VulkanPlayground/Core/Hash.h"
+#include <filesystem>
+#include <future>
+#include <mutex>
+
+namespace VKPlayground {
+
+	static const char* s_CacheDirectory = "assets/cache";
+	static const char* s_CachePath = "assets/cache/pipelines.bin";
+
+	struct PipelineCacheData
+	{
+		Ref<VulkanDevice> Device;
+		VkPipelineCache PipelineCache = nullptr;
+
+		std::unordered_map<uint64_t, Ref<VulkanPipeline>> Pipelines;
+		std::unordered_map<uint64_t, Ref<AsyncPipeline>> AsyncPipelines;
+
+		// Shader of every async request by path, requests for other states of the same shader wait for the first compile
+		std::unordered_map<std::string, std::shared_future<Ref<Shader>>> AsyncShaders;
+		JobCounter PendingJobs;
+		PipelineCacheStats Stats;
+
+		std::mutex Mutex;
+	};
+
+	static PipelineCacheData* s_Data = nullptr;
+
+	namespace Utils {
+
+		// Drivers are supposed to reject foreign data themselves, but not all of them do so check the header first
+		static bool IsCacheDataCompatible(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties)
+		{
+			VkPipelineCacheHeaderVersionOne header = {};
+			if (data.size() < sizeof(header))
+				return false;
+
+			memcpy(&header, data.data(), sizeof(header));
+
+			return header.headerSize >= sizeof(header) &&
+				header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+				header.vendorID == properties.vendorID &&
+				header.deviceID == properties.deviceID &&
+				memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		static std::vector<uint8_t> LoadCacheData(const VkPhysicalDeviceProperties& properties)
+		{
+			std::vector<uint8_t> data;
+
+			std::ifstream stream(s_CachePath, std::ios::binary | std::ios::ate);
+			if (!stream)
+				return data;
+
+			data.resize((size_t)stream.tellg());
+			stream.seekg(0);
+			stream.read(reinterpret_cast<char*>(data.data()), data.size());
+
+			if (!stream || !IsCacheDataCompatible(data, properties))
+			{
+				LOG_WARN("Ignoring pipeline cache from a different driver or device: {0}", s_CachePath);
+				data.clear();
+			}
+
+			return data;
+		}
+
+		static void StoreCacheData(VkDevice device, VkPipelineCache pipelineCache)
+		{
+			size_t size = 0;
+			VK_CHECK_RESULT(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr));
+
+			std::vector<uint8_t> data(size);
+			VK_CHECK_RESULT(vkGetPipelineCacheData(device, pipelineCache, &size, data.data()));
+
+			std::filesystem::create_directories(s_CacheDirectory);
+
+			std::ofstream stream(s_CachePath, std::ios::binary | std::ios::trunc);
+			if (!stream)
+			{
+				LOG_WARN("Failed to write pipeline cache: {0}", s_CachePath);
+				return;
+			}
+
+			stream.write(reinterpret_cast<const char*>(data.data()), size);
+			LOG_INFO("Saved pipeline cache ({0} bytes)", size);
+		}
+
+	}
+
+	Ref<VulkanPipeline> PipelineCache::GetPipeline(const PipelineSpecification& specification)
+	{
+		uint64_t hash = specification.GetHash();
+
+		{
+			std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+			auto it = s_Data->Pipelines.find(hash);
+			if (it != s_Data->Pipelines.end())
+			{
+				s_Data->Stats.Hits++;
+				return it->second;
+			}
+		}
+
+		// Create outside the lock, the VkPipelineCache is internally synchronized
+		Ref<VulkanPipeline> pipeline = CreateRef<VulkanPipeline>(specification);
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		// Another thread may have created the same pipeline in the meantime, keep the first one
+		auto [it, inserted] = s_Data->Pipelines.emplace(hash, pipeline);
+		if (inserted)
+		{
+			s_Data->Stats.Misses++;
+			s_Data->Stats.Pipelines = (uint32_t)s_Data->Pipelines.size();
+		}
+		else
+		{
+			s_Data->Stats.Hits++;
+		}
+
+		return it->second;
+	}
+
+	Ref<AsyncPipeline> PipelineCache::GetPipelineAsync(const std::string& shaderPath, const PipelineSpecification& specification)
+	{
+		// The shader isn't compiled yet so requests are keyed by its path instead of its hash
+		PipelineSpecification asyncSpecification = specification;
+		asyncSpecification.Shader = nullptr;
+		uint64_t hash = Hash::FNV1a(shaderPath, asyncSpecification.GetHash());
+
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		auto it = s_Data->AsyncPipelines.find(hash);
+		if (it != s_Data->AsyncPipelines.end())
+			return it->second;
+
+		Ref<AsyncPipeline> asyncPipeline = CreateRef<AsyncPipeline>();
+		asyncPipeline->m_ShaderPath = shaderPath;
+		s_Data->AsyncPipelines[hash] = asyncPipeline;
+		s_Data->Stats.Pending++;
+
+		// Background jobs start in order, so the compile of the first request is always running before others wait on it
+		std::shared_ptr<std::promise<Ref<Shader>>> shaderPromise;
+		auto shaderIt = s_Data->AsyncShaders.find(shaderPath);
+		if (shaderIt == s_Data->AsyncShaders.end())
+		{
+			shaderPromise = std::make_shared<std::promise<Ref<Shader>>>();
+			shaderIt = s_Data->AsyncShaders.emplace(shaderPath, shaderPromise->get_future().share()).first;
+		}
+
+		std::shared_future<Ref<Shader>> shader = shaderIt->second;
+
+		JobSystem::RunBackground([asyncPipeline, asyncSpecification, shaderPromise, shader]() mutable
+		{
+			if (shaderPromise)
+				shaderPromise->set_value(CreateRef<Shader>(asyncPipeline->m_ShaderPath));
+
+			asyncSpecification.Shader = shader.get();
+			asyncPipeline->m_Pipeline = GetPipeline(asyncSpecification);
+
+			{
+				std::lock_guard<std::mutex> lock(s_Data->Mutex);
+				s_Data->Stats.Pending--;
+			}
+
+			asyncPipeline->m_Ready.store(true, std::memory_order_release);
+		}, &s_Data->PendingJobs);
+
+		return asyncPipeline;
+	}
+
+	void PipelineCache::WaitIdle()
+	{
+		JobSystem::Wait(s_Data->PendingJobs);
+	}
+
+	VkPipelineCache PipelineCache::GetVulkanPipelineCache()
+	{
+		return s_Data->PipelineCache;
+	}
+
+	PipelineCacheStats PipelineCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+		return s_Data->Stats;
+	}
+
+	void PipelineCache::Init(Ref<VulkanDevice> device)
+	{
+		s_Data = new PipelineCacheData();
+		s_Data->Device = device;
+
+		std::vector<uint8_t> data = Utils::LoadCacheData(device->GetPhysicalDeviceProperties());
+
+		VkPipelineCacheCreateInfo pipelineCacheInfo = {};
+		pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		pipelineCacheInfo.initialDataSize = data.size();
+		pipelineCacheInfo.pInitialData = data.data();
+
+		VK_CHECK_RESULT(vkCreatePipelineCache(device->GetLogicalDevice(), &pipelineCacheInfo, nullptr, &s_Data->PipelineCache));
+
+		s_Data->Stats.LoadedSize = (uint32_t)data.size();
+		LOG_INFO("Initialized pipeline cache ({0} bytes loaded)", data.size());
+	}
+
+	void PipelineCache::Shutdown()
+	{
+		VkDevice device = s_Data->Device->GetLogicalDevice();
+
+		// Compile jobs still reference the cache, let them finish before tearing it down
+		WaitIdle();
+
+		s_Data->AsyncPipelines.clear();
+		s_Data->AsyncShaders.clear();
+		s_Data->Pipelines.clear();
+
+		Utils::StoreCacheData(device, s_Data->PipelineCache);
+		vkDestroyPipelineCache(device, s_Data->PipelineCache, nullptr);
+
+		delete s_Data;
+		s_Data = nullptr;
+	}
+
+}
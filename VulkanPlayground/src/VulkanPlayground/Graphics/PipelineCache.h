@@ -0,0 +1,67 @@
+#pragma once
+#include "VulkanPlayground/Core/Core.h"
+#include "VulkanDevice.h"
+#include "VulkanPipeline.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+
+namespace VKPlayground {
+
+	struct PipelineCacheStats
+	{
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;
+		uint32_t Pipelines = 0;
+
+		// Requests still compiling on a background job
+		uint32_t Pending = 0;
+
+		// Size of the driver cache loaded from disk at startup, zero on a cold start
+		uint32_t LoadedSize = 0;
+	};
+
+	// Pipeline whose shader and pipeline are compiled on a background job, poll IsReady() before drawing with it
+	class AsyncPipeline
+	{
+	public:
+		inline bool IsReady() const { return m_Ready.load(std::memory_order_acquire); }
+
+		// nullptr until the pipeline is ready
+		inline Ref<VulkanPipeline> GetPipeline() const { return IsReady() ? m_Pipeline : nullptr; }
+		inline const std::string& GetShaderPath() const { return m_ShaderPath; }
+
+	private:
+		std::string m_ShaderPath;
+		Ref<VulkanPipeline> m_Pipeline;
+		std::atomic<bool> m_Ready = false;
+
+		friend class PipelineCache;
+	};
+
+	// Graphics pipelines keyed by PipelineSpecification::GetHash(), so a state combination is only compiled once.
+	// Every pipeline is created through one VkPipelineCache that is saved to disk on shutdown and loaded on startup,
+	// which lets the driver skip shader compilation for pipelines it has seen in a previous run.
+	class PipelineCache
+	{
+	public:
+		static Ref<VulkanPipeline> GetPipeline(const PipelineSpecification& specification);
+
+		// Compiles the shader at shaderPath and creates the pipeline without blocking, specification.Shader is ignored.
+		// Repeated requests return the same object, so layers can call this up front to preload and poll IsReady().
+		static Ref<AsyncPipeline> GetPipelineAsync(const std::string& shaderPath, const PipelineSpecification& specification);
+
+		// Blocks until every async request has finished, call before destroying render passes they were created against
+		static void WaitIdle();
+
+		// Pass to vkCreate*Pipelines, also used for compute pipelines which aren't kept in the map
+		static VkPipelineCache GetVulkanPipelineCache();
+
+		// Copy taken under the lock, background compile jobs update the stats while the frame is recorded
+		static PipelineCacheStats GetStats();
+
+	public:
+		static void Init(Ref<VulkanDevice> device);
+		static void Shutdown();
+	};
+
+}
@@ -0,0 +1,804 @@
+#include "pch.h"
+#include "RenderGraph.h"
+#include "VulkanDescriptorCache.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/Hash.h"
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		static VkImageAspectFlags GetAspectMask(VkFormat format)
+		{
+			VkImageAspectFlags aspectMask = 0;
+			if (VulkanImage::IsDepthFormat(format))
+				aspectMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
+			if (VulkanImage::IsStencilFormat(format))
+				aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+			return aspectMask ? aspectMask : VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+
+		static bool IsDepthStencilFormat(VkFormat format)
+		{
+			return VulkanImage::IsDepthFormat(format) || VulkanImage::IsStencilFormat(format);
+		}
+
+	}
+
+	RenderGraphPassBuilder::RenderGraphPassBuilder(RenderGraph& graph, RenderGraphPass& pass)
+		: m_Graph(graph), m_Pass(pass)
+	{
+	}
+
+	void RenderGraphPassBuilder::WriteColor(RenderGraphResource image, VkAttachmentLoadOp loadOp, const VkClearColorValue& clearValue)
+	{
+		ASSERT(m_Pass.Type == RenderGraphPassType::GRAPHICS, "Attachments can only be written by graphics passes");
+
+		RenderGraphAttachment& attachment = m_Pass.ColorAttachments.emplace_back();
+		attachment.Resource = image;
+		attachment.LoadOp = loadOp;
+		attachment.ClearValue.color = clearValue;
+
+		VkAccessFlags access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		if (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+			access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+
+		m_Graph.m_Resources[image.Index].Usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		AddAccess(image, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, access, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, loadOp != VK_ATTACHMENT_LOAD_OP_LOAD);
+	}
+
+	void RenderGraphPassBuilder::WriteDepth(RenderGraphResource image, VkAttachmentLoadOp loadOp, const VkClearDepthStencilValue& clearValue)
+	{
+		ASSERT(m_Pass.Type == RenderGraphPassType::GRAPHICS, "Attachments can only be written by graphics passes");
+		ASSERT(!m_Pass.DepthAttachment.Resource.IsValid(), "Only one depth attachment is allowed");
+
+		m_Pass.DepthAttachment.Resource = image;
+		m_Pass.DepthAttachment.LoadOp = loadOp;
+		m_Pass.DepthAttachment.ClearValue.depthStencil = clearValue;
+
+		// Load and clear happen in the early tests, stores in the late tests
+		VkAccessFlags access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		m_Graph.m_Resources[image.Index].Usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		AddAccess(image, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, access, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true, loadOp != VK_ATTACHMENT_LOAD_OP_LOAD);
+	}
+
+	void RenderGraphPassBuilder::ReadTexture(RenderGraphResource image, VkPipelineStageFlags stages, VkImageLayout layout)
+	{
+		if (layout == VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			VkFormat format = m_Graph.GetImageDescription(image).Format;
+			layout = Utils::IsDepthStencilFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		m_Graph.m_Resources[image.Index].Usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		AddAccess(image, stages, VK_ACCESS_SHADER_READ_BIT, layout, false);
+	}
+
+	void RenderGraphPassBuilder::ReadStorage(RenderGraphResource resource, VkPipelineStageFlags stages)
+	{
+		m_Graph.m_Resources[resource.Index].Usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		AddAccess(resource, stages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false);
+	}
+
+	void RenderGraphPassBuilder::WriteStorage(RenderGraphResource resource, VkPipelineStageFlags stages)
+	{
+		m_Graph.m_Resources[resource.Index].Usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		AddAccess(resource, stages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true);
+	}
+
+	void RenderGraphPassBuilder::ReadBuffer(RenderGraphResource buffer, VkPipelineStageFlags stages, VkAccessFlags access)
+	{
+		ASSERT(m_Graph.m_Resources[buffer.Index].IsBuffer, "Resource is not a buffer");
+		AddAccess(buffer, stages, access, VK_IMAGE_LAYOUT_UNDEFINED, false);
+	}
+
+	void RenderGraphPassBuilder::SetSubpassContents(VkSubpassContents contents)
+	{
+		m_Pass.SubpassContents = contents;
+	}
+
+	void RenderGraphPassBuilder::SetSideEffect()
+	{
+		m_Pass.SideEffect = true;
+	}
+
+	void RenderGraphPassBuilder::AddAccess(RenderGraphResource resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout, bool write, bool discard)
+	{
+		ASSERT(resource.IsValid(), "Invalid render graph resource");
+
+		// Using a resource more than once in a pass merges the accesses, an image can only be in one layout at a time
+		for (RenderGraphAccess& existing : m_Pass.Accesses)
+		{
+			if (existing.Resource.Index == resource.Index)
+			{
+				ASSERT(m_Graph.m_Resources[resource.Index].IsBuffer || existing.Layout == layout, "Image used in two different layouts in the same pass");
+
+				existing.Stages |= stages;
+				existing.Access |= access;
+				existing.Write |= write;
+				existing.Discard = false;
+				return;
+			}
+		}
+
+		RenderGraphAccess& entry = m_Pass.Accesses.emplace_back();
+		entry.Resource = resource;
+		entry.Stages = stages;
+		entry.Access = access;
+		entry.Layout = m_Graph.m_Resources[resource.Index].IsBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : layout;
+		entry.Write = write;
+		entry.Discard = discard;
+	}
+
+	bool RenderGraph::RenderPassKey::operator<(const RenderPassKey& other) const
+	{
+		return std::tie(Formats, LoadOps, StoreOps, HasDepth) < std::tie(other.Formats, other.LoadOps, other.StoreOps, other.HasDepth);
+	}
+
+	RenderGraph::RenderGraph()
+	{
+		LOG_INFO("Initialized render graph");
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		DestroyTransientImages();
+
+		for (auto& [key, renderPass] : m_RenderPasses)
+		{
+			vkDestroyRenderPass(device, renderPass, nullptr);
+		}
+	}
+
+	RenderGraphResource RenderGraph::CreateImage(const std::string& name, const RenderGraphImageDescription& description)
+	{
+		Resource& resource = m_Resources.emplace_back();
+		resource.Name = name;
+		resource.Description = description;
+
+		return { (uint32_t)m_Resources.size() - 1 };
+	}
+
+	RenderGraphResource RenderGraph::ImportImage(const std::string& name, Ref<VulkanImage> image)
+	{
+		// Importing the same image twice in a frame returns the same resource, its state can only be tracked once
+		for (uint32_t i = 0; i < m_Resources.size(); i++)
+		{
+			if (m_Resources[i].ImportedImage == image)
+				return { i };
+		}
+
+		const ImageSpecification& specification = image->GetSpecification();
+
+		Resource& resource = m_Resources.emplace_back();
+		resource.Name = name;
+		resource.Imported = true;
+		resource.ImportedImage = image;
+		resource.Description = { specification.Width, specification.Height, specification.Format };
+
+		return { (uint32_t)m_Resources.size() - 1 };
+	}
+
+	RenderGraphResource RenderGraph::ImportBuffer(const std::string& name, VkBuffer buffer)
+	{
+		for (uint32_t i = 0; i < m_Resources.size(); i++)
+		{
+			if (m_Resources[i].IsBuffer && m_Resources[i].Buffer == buffer)
+				return { i };
+		}
+
+		Resource& resource = m_Resources.emplace_back();
+		resource.Name = name;
+		resource.Imported = true;
+		resource.IsBuffer = true;
+		resource.Buffer = buffer;
+
+		return { (uint32_t)m_Resources.size() - 1 };
+	}
+
+	void RenderGraph::AddPass(const std::string& name, RenderGraphPassType type, const std::function<void(RenderGraphPassBuilder&)>& setup, const RenderGraphExecuteFunction& execute)
+	{
+		ASSERT(!m_Compiled, "Passes can't be added after the graph was compiled");
+
+		RenderGraphPass& pass = m_Passes.emplace_back();
+		pass.Name = name;
+		pass.Type = type;
+		pass.Execute = execute;
+
+		RenderGraphPassBuilder builder(*this, pass);
+		setup(builder);
+	}
+
+	void RenderGraph::Compile()
+	{
+		m_Stats = {};
+		m_Stats.Passes = (uint32_t)m_Passes.size();
+
+		CullPasses();
+		ComputeLifetimes();
+		AllocateTransientImages();
+
+		// Imported resources continue from the state the previous frame left them in
+		for (Resource& resource : m_Resources)
+		{
+			if (resource.Imported)
+				resource.State = m_ImportedStates[GetHandle(resource)];
+		}
+
+		m_Compiled = true;
+	}
+
+	void RenderGraph::Execute(VkCommandBuffer commandBuffer)
+	{
+		ASSERT(m_Compiled, "Render graph has to be compiled before it is executed");
+
+		for (uint32_t i = 0; i < m_Passes.size(); i++)
+		{
+			if (m_Passes[i].Culled)
+				continue;
+
+			InsertBarriers(commandBuffer, i);
+			ExecutePass(commandBuffer, i);
+		}
+
+		for (const Resource& resource : m_Resources)
+		{
+			if (resource.Imported)
+				m_ImportedStates[GetHandle(resource)] = resource.State;
+		}
+	}
+
+	void RenderGraph::Reset()
+	{
+		m_Passes.clear();
+		m_Resources.clear();
+		m_Compiled = false;
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Walk backwards from passes with visible results, a pass survives if a surviving pass reads something it writes
+		std::vector<bool> needed(m_Resources.size(), false);
+
+		for (int32_t i = (int32_t)m_Passes.size() - 1; i >= 0; i--)
+		{
+			RenderGraphPass& pass = m_Passes[i];
+
+			bool alive = pass.SideEffect;
+			for (const RenderGraphAccess& access : pass.Accesses)
+			{
+				if (access.Write && (needed[access.Resource.Index] || m_Resources[access.Resource.Index].Imported))
+					alive = true;
+			}
+
+			pass.Culled = !alive;
+			if (pass.Culled)
+			{
+				m_Stats.CulledPasses++;
+				continue;
+			}
+
+			for (const RenderGraphAccess& access : pass.Accesses)
+			{
+				if (!access.Write)
+					needed[access.Resource.Index] = true;
+			}
+
+			// Attachments that are loaded depend on whatever wrote them before
+			for (const RenderGraphAttachment& attachment : pass.ColorAttachments)
+			{
+				if (attachment.LoadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+					needed[attachment.Resource.Index] = true;
+			}
+
+			if (pass.DepthAttachment.Resource.IsValid() && pass.DepthAttachment.LoadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+				needed[pass.DepthAttachment.Resource.Index] = true;
+		}
+	}
+
+	void RenderGraph::ComputeLifetimes()
+	{
+		for (uint32_t i = 0; i < m_Passes.size(); i++)
+		{
+			if (m_Passes[i].Culled)
+				continue;
+
+			for (const RenderGraphAccess& access : m_Passes[i].Accesses)
+			{
+				Resource& resource = m_Resources[access.Resource.Index];
+				resource.FirstPass = std::min(resource.FirstPass, i);
+				resource.LastPass = std::max(resource.LastPass, i);
+			}
+		}
+	}
+
+	void RenderGraph::AllocateTransientImages()
+	{
+		// Transient images that are used this frame, in order of creation so the mapping is stable between frames
+		std::vector<uint32_t> transients;
+		uint64_t layoutHash = Hash::FNVOffsetBasis;
+
+		for (uint32_t i = 0; i < m_Resources.size(); i++)
+		{
+			Resource& resource = m_Resources[i];
+			if (resource.Imported || resource.FirstPass == UINT32_MAX)
+				continue;
+
+			resource.PhysicalIndex = (uint32_t)transients.size();
+			transients.push_back(i);
+
+			layoutHash = Hash::Combine(layoutHash, resource.Description);
+			layoutHash = Hash::Combine(layoutHash, resource.Usage);
+			layoutHash = Hash::Combine(layoutHash, resource.FirstPass);
+			layoutHash = Hash::Combine(layoutHash, resource.LastPass);
+		}
+
+		// Same images with the same lifetimes as last frame, keep everything including memory states
+		if (layoutHash == m_PhysicalLayoutHash && !m_PhysicalImages.empty())
+		{
+			for (const MemorySlot& slot : m_MemorySlots)
+			{
+				m_Stats.TransientMemory += slot.Requirements.size;
+			}
+
+			m_Stats.TransientImages = (uint32_t)m_PhysicalImages.size();
+			m_Stats.AliasedMemory = m_AliasedMemory;
+			return;
+		}
+
+		// The old images may still be used by frames in flight, this only happens when the passes or their resources change
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		vkDeviceWaitIdle(device);
+
+		DestroyTransientImages();
+		m_PhysicalLayoutHash = layoutHash;
+
+		VulkanAllocator allocator("RenderGraph");
+		VkDeviceSize totalImageSize = 0;
+
+		// Place images in the order they start being used so a slot only ever holds images that follow each other
+		std::vector<uint32_t> placementOrder(transients.size());
+		for (uint32_t i = 0; i < transients.size(); i++)
+		{
+			placementOrder[i] = i;
+		}
+
+		std::stable_sort(placementOrder.begin(), placementOrder.end(), [&](uint32_t a, uint32_t b)
+		{
+			return m_Resources[transients[a]].FirstPass < m_Resources[transients[b]].FirstPass;
+		});
+
+		m_PhysicalImages.resize(transients.size());
+		for (uint32_t physicalIndex : placementOrder)
+		{
+			const Resource& resource = m_Resources[transients[physicalIndex]];
+			PhysicalImage& physicalImage = m_PhysicalImages[physicalIndex];
+			physicalImage.Description = resource.Description;
+			physicalImage.Usage = resource.Usage;
+
+			VkImageCreateInfo imageCreateInfo = {};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = resource.Description.Format;
+			imageCreateInfo.extent = { resource.Description.Width, resource.Description.Height, 1 };
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.usage = resource.Usage;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &physicalImage.Image));
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(device, physicalImage.Image, &requirements);
+			totalImageSize += requirements.size;
+
+			// Greedy first fit, a slot can be reused once the last image placed in it is no longer used
+			uint32_t slotIndex = UINT32_MAX;
+			for (uint32_t j = 0; j < m_MemorySlots.size(); j++)
+			{
+				MemorySlot& slot = m_MemorySlots[j];
+				if (slot.LastPass < resource.FirstPass && (slot.Requirements.memoryTypeBits & requirements.memoryTypeBits))
+				{
+					slotIndex = j;
+					break;
+				}
+			}
+
+			if (slotIndex == UINT32_MAX)
+			{
+				slotIndex = (uint32_t)m_MemorySlots.size();
+				m_MemorySlots.emplace_back().Requirements = requirements;
+			}
+
+			MemorySlot& slot = m_MemorySlots[slotIndex];
+			slot.Requirements.size = std::max(slot.Requirements.size, requirements.size);
+			slot.Requirements.alignment = std::max(slot.Requirements.alignment, requirements.alignment);
+			slot.Requirements.memoryTypeBits &= requirements.memoryTypeBits;
+			slot.LastPass = resource.LastPass;
+
+			physicalImage.MemorySlot = slotIndex;
+		}
+
+		for (MemorySlot& slot : m_MemorySlots)
+		{
+			slot.Allocation = allocator.AllocateMemory(slot.Requirements, VMA_MEMORY_USAGE_GPU_ONLY);
+			m_Stats.TransientMemory += slot.Requirements.size;
+		}
+
+		for (PhysicalImage& physicalImage : m_PhysicalImages)
+		{
+			allocator.BindImageMemory(m_MemorySlots[physicalImage.MemorySlot].Allocation, 0, physicalImage.Image);
+
+			VkImageViewCreateInfo imageViewCreateInfo = {};
+			imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			imageViewCreateInfo.format = physicalImage.Description.Format;
+			imageViewCreateInfo.image = physicalImage.Image;
+			imageViewCreateInfo.subresourceRange.aspectMask = Utils::GetAspectMask(physicalImage.Description.Format);
+			imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+			imageViewCreateInfo.subresourceRange.levelCount = 1;
+			imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+			imageViewCreateInfo.subresourceRange.layerCount = 1;
+			VK_CHECK_RESULT(vkCreateImageView(device, &imageViewCreateInfo, nullptr, &physicalImage.ImageView));
+
+			// Depth-stencil images can only be sampled through a view with a single aspect
+			if (VulkanImage::IsDepthFormat(physicalImage.Description.Format) && VulkanImage::IsStencilFormat(physicalImage.Description.Format))
+			{
+				imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				VK_CHECK_RESULT(vkCreateImageView(device, &imageViewCreateInfo, nullptr, &physicalImage.DepthImageView));
+			}
+		}
+
+		m_AliasedMemory = totalImageSize - m_Stats.TransientMemory;
+		m_Stats.TransientImages = (uint32_t)m_PhysicalImages.size();
+		m_Stats.AliasedMemory = m_AliasedMemory;
+
+		LOG_INFO("Render graph allocated {0} transient images in {1} memory blocks ({2} bytes aliased)", m_PhysicalImages.size(), m_MemorySlots.size(), m_AliasedMemory);
+	}
+
+	void RenderGraph::DestroyTransientImages()
+	{
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		VulkanAllocator allocator("RenderGraph");
+
+		// Framebuffers may reference the views that are destroyed below
+		for (auto& [key, framebuffer] : m_Framebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+
+		for (PhysicalImage& physicalImage : m_PhysicalImages)
+		{
+			VulkanDescriptorCache::Invalidate(physicalImage.ImageView);
+			VulkanDescriptorCache::Invalidate(physicalImage.DepthImageView);
+			vkDestroyImageView(device, physicalImage.ImageView, nullptr);
+			vkDestroyImageView(device, physicalImage.DepthImageView, nullptr);
+			vkDestroyImage(device, physicalImage.Image, nullptr);
+		}
+
+		for (MemorySlot& slot : m_MemorySlots)
+		{
+			allocator.FreeMemory(slot.Allocation);
+		}
+
+		m_Framebuffers.clear();
+		m_PhysicalImages.clear();
+		m_MemorySlots.clear();
+		m_PhysicalLayoutHash = 0;
+	}
+
+	void RenderGraph::InsertBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex)
+	{
+		const RenderGraphPass& pass = m_Passes[passIndex];
+
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+		for (const RenderGraphAccess& access : pass.Accesses)
+		{
+			Resource& resource = m_Resources[access.Resource.Index];
+
+			// A transient image takes over its memory from whatever used it last, its previous contents are never kept
+			if (!resource.Imported && passIndex == resource.FirstPass)
+			{
+				resource.State = m_MemorySlots[m_PhysicalImages[resource.PhysicalIndex].MemorySlot].State;
+				resource.State.Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+
+			ResourceState& state = resource.State;
+			VkImageLayout oldLayout = access.Discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.Layout;
+			bool layoutChange = !resource.IsBuffer && state.Layout != access.Layout;
+
+			VkPipelineStageFlags waitStages = 0;
+			VkAccessFlags waitAccess = 0;
+
+			if (access.Write || layoutChange)
+			{
+				// Writes and layout transitions have to wait for every earlier read and write
+				waitStages = state.WriteStages | state.ReadStages;
+				waitAccess = state.WriteAccess;
+
+				if (waitStages || layoutChange)
+				{
+					srcStages |= waitStages ? waitStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					dstStages |= access.Stages;
+				}
+
+				// A transition done for a read still orders later reads in other stages after it
+				state.Layout = access.Layout;
+				state.WriteStages = access.Stages;
+				state.WriteAccess = access.Write ? access.Access : 0;
+				state.ReadStages = access.Write ? 0 : access.Stages;
+				state.ReadAccess = access.Write ? 0 : access.Access;
+			}
+			else
+			{
+				// Reads only wait for the last write, and only once per stage
+				bool visible = (access.Stages & ~state.ReadStages) == 0 && (access.Access & ~state.ReadAccess) == 0;
+				if (state.WriteStages && !visible)
+				{
+					waitStages = state.WriteStages;
+					waitAccess = state.WriteAccess;
+
+					srcStages |= waitStages;
+					dstStages |= access.Stages;
+				}
+
+				state.ReadStages |= access.Stages;
+				state.ReadAccess |= access.Access;
+			}
+
+			if (waitAccess || layoutChange)
+			{
+				if (resource.IsBuffer)
+				{
+					VkBufferMemoryBarrier& barrier = bufferBarriers.emplace_back();
+					barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcAccessMask = waitAccess;
+					barrier.dstAccessMask = access.Access;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.buffer = resource.Buffer;
+					barrier.offset = 0;
+					barrier.size = VK_WHOLE_SIZE;
+				}
+				else
+				{
+					uint32_t mipLevels = resource.Imported ? resource.ImportedImage->GetSpecification().MipLevels : 1;
+					uint32_t layerCount = resource.Imported ? resource.ImportedImage->GetSpecification().LayerCount : 1;
+
+					VkImageMemoryBarrier& barrier = imageBarriers.emplace_back();
+					barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.srcAccessMask = waitAccess;
+					barrier.dstAccessMask = access.Access;
+					barrier.oldLayout = layoutChange ? oldLayout : access.Layout;
+					barrier.newLayout = access.Layout;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.image = GetImage(access.Resource);
+					barrier.subresourceRange = { Utils::GetAspectMask(resource.Description.Format), 0, mipLevels, 0, layerCount };
+				}
+			}
+
+			// Hand the memory state to the next image aliasing this one
+			if (!resource.Imported && passIndex == resource.LastPass)
+				m_MemorySlots[m_PhysicalImages[resource.PhysicalIndex].MemorySlot].State = state;
+		}
+
+		if (!srcStages)
+			return;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, (uint32_t)bufferBarriers.size(), bufferBarriers.data(), (uint32_t)imageBarriers.size(), imageBarriers.data());
+
+		m_Stats.Barriers++;
+		m_Stats.ImageBarriers += (uint32_t)imageBarriers.size();
+		m_Stats.BufferBarriers += (uint32_t)bufferBarriers.size();
+	}
+
+	void RenderGraph::ExecutePass(VkCommandBuffer commandBuffer, uint32_t passIndex)
+	{
+		RenderGraphPass& pass = m_Passes[passIndex];
+
+		RenderGraphPassContext context;
+		context.CommandBuffer = commandBuffer;
+
+		bool hasAttachments = !pass.ColorAttachments.empty() || pass.DepthAttachment.Resource.IsValid();
+		if (!hasAttachments)
+		{
+			pass.Execute(context);
+			return;
+		}
+
+		// Attachments nobody reads afterwards don't have to be written back to memory
+		RenderPassKey key;
+		std::vector<VkImageView> attachmentViews;
+		std::vector<VkClearValue> clearValues;
+
+		auto addAttachment = [&](const RenderGraphAttachment& attachment)
+		{
+			const Resource& resource = m_Resources[attachment.Resource.Index];
+			bool store = resource.Imported || resource.LastPass > passIndex;
+
+			key.Formats.push_back(resource.Description.Format);
+			key.LoadOps.push_back(attachment.LoadOp);
+			key.StoreOps.push_back(store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+			attachmentViews.push_back(GetImageView(attachment.Resource));
+			clearValues.push_back(attachment.ClearValue);
+
+			context.Extent = { resource.Description.Width, resource.Description.Height };
+		};
+
+		for (const RenderGraphAttachment& attachment : pass.ColorAttachments)
+		{
+			addAttachment(attachment);
+		}
+
+		if (pass.DepthAttachment.Resource.IsValid())
+		{
+			addAttachment(pass.DepthAttachment);
+			key.HasDepth = true;
+		}
+
+		context.RenderPass = GetRenderPass(key);
+		context.Framebuffer = GetFramebuffer(context.RenderPass, attachmentViews, context.Extent);
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = context.RenderPass;
+		renderPassInfo.framebuffer = context.Framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = context.Extent;
+		renderPassInfo.clearValueCount = (uint32_t)clearValues.size();
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, pass.SubpassContents);
+		pass.Execute(context);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	uint64_t RenderGraph::GetHandle(const Resource& resource) const
+	{
+		return resource.IsBuffer ? (uint64_t)resource.Buffer : (uint64_t)resource.ImportedImage->GetVulkanImage();
+	}
+
+	VkRenderPass RenderGraph::GetCompatibleRenderPass(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat)
+	{
+		// Load and store ops don't affect compatibility, so any pass with the same formats can use pipelines created with this
+		RenderPassKey key;
+		key.Formats = colorFormats;
+		if (depthFormat != VK_FORMAT_UNDEFINED)
+		{
+			key.Formats.push_back(depthFormat);
+			key.HasDepth = true;
+		}
+
+		key.LoadOps.assign(key.Formats.size(), VK_ATTACHMENT_LOAD_OP_CLEAR);
+		key.StoreOps.assign(key.Formats.size(), VK_ATTACHMENT_STORE_OP_STORE);
+
+		return GetRenderPass(key);
+	}
+
+	VkRenderPass RenderGraph::GetRenderPass(const RenderPassKey& key)
+	{
+		auto it = m_RenderPasses.find(key);
+		if (it != m_RenderPasses.end())
+			return it->second;
+
+		std::vector<VkAttachmentDescription> attachmentDescriptions;
+		std::vector<VkAttachmentReference> colorAttachmentReferences;
+		VkAttachmentReference depthAttachmentReference = {};
+
+		for (uint32_t i = 0; i < key.Formats.size(); i++)
+		{
+			bool depth = key.HasDepth && i == key.Formats.size() - 1;
+			VkImageLayout layout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			// The graph transitions attachments with barriers before the pass, the render pass itself never changes layouts
+			VkAttachmentDescription& description = attachmentDescriptions.emplace_back();
+			description = {};
+			description.format = key.Formats[i];
+			description.samples = VK_SAMPLE_COUNT_1_BIT;
+			description.loadOp = key.LoadOps[i];
+			description.storeOp = key.StoreOps[i];
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			description.initialLayout = layout;
+			description.finalLayout = layout;
+
+			if (depth)
+				depthAttachmentReference = { i, layout };
+			else
+				colorAttachmentReferences.push_back({ i, layout });
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = (uint32_t)colorAttachmentReferences.size();
+		subpass.pColorAttachments = colorAttachmentReferences.data();
+		subpass.pDepthStencilAttachment = key.HasDepth ? &depthAttachmentReference : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = (uint32_t)attachmentDescriptions.size();
+		renderPassInfo.pAttachments = attachmentDescriptions.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass;
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
+
+		m_RenderPasses[key] = renderPass;
+		return renderPass;
+	}
+
+	VkFramebuffer RenderGraph::GetFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& attachments, VkExtent2D extent)
+	{
+		uint64_t key = Hash::Combine(Hash::FNVOffsetBasis, renderPass);
+		key = Hash::FNV1a(attachments.data(), attachments.size() * sizeof(VkImageView), key);
+		key = Hash::Combine(key, extent);
+
+		auto it = m_Framebuffers.find(key);
+		if (it != m_Framebuffers.end())
+			return it->second;
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = (uint32_t)attachments.size();
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer));
+
+		m_Framebuffers[key] = framebuffer;
+		return framebuffer;
+	}
+
+	VkImage RenderGraph::GetImage(RenderGraphResource resource) const
+	{
+		const Resource& entry = m_Resources[resource.Index];
+		return entry.Imported ? entry.ImportedImage->GetVulkanImage() : m_PhysicalImages[entry.PhysicalIndex].Image;
+	}
+
+	VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+	{
+		const Resource& entry = m_Resources[resource.Index];
+		return entry.Imported ? entry.ImportedImage->GetDescriptorImageInfo().imageView : m_PhysicalImages[entry.PhysicalIndex].ImageView;
+	}
+
+	VkImageView RenderGraph::GetDepthImageView(RenderGraphResource resource) const
+	{
+		const Resource& entry = m_Resources[resource.Index];
+		if (entry.Imported)
+			return entry.ImportedImage->GetDepthImageView();
+
+		const PhysicalImage& physicalImage = m_PhysicalImages[entry.PhysicalIndex];
+		return physicalImage.DepthImageView ? physicalImage.DepthImageView : physicalImage.ImageView;
+	}
+
+	VkBuffer RenderGraph::GetBuffer(RenderGraphResource resource) const
+	{
+		return m_Resources[resource.Index].Buffer;
+	}
+
+	const RenderGraphImageDescription& RenderGraph::GetImageDescription(RenderGraphResource resource) const
+	{
+		return m_Resources[resource.Index].Description;
+	}
+
+}
@@ -0,0 +1,250 @@
+#pragma once
+#include "VulkanPlayground/Graphics/VulkanImage.h"
+#include "VulkanPlayground/Graphics/VulkanAllocator.h"
+#include <vulkan/vulkan.h>
+
+namespace VKPlayground {
+
+	enum class RenderGraphPassType
+	{
+		NONE = -1, GRAPHICS, COMPUTE
+	};
+
+	struct RenderGraphResource
+	{
+		uint32_t Index = UINT32_MAX;
+
+		inline bool IsValid() const { return Index != UINT32_MAX; }
+	};
+
+	// Transient images only live for the frame, the graph creates them and may alias their memory
+	struct RenderGraphImageDescription
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+	};
+
+	struct RenderGraphPassContext
+	{
+		VkCommandBuffer CommandBuffer = nullptr;
+
+		// Only set for graphics passes with attachments, the render pass has already been begun
+		VkRenderPass RenderPass = nullptr;
+		VkFramebuffer Framebuffer = nullptr;
+		VkExtent2D Extent = { 0, 0 };
+	};
+
+	struct RenderGraphStats
+	{
+		uint32_t Passes = 0;
+		uint32_t CulledPasses = 0;
+		uint32_t Barriers = 0;
+		uint32_t ImageBarriers = 0;
+		uint32_t BufferBarriers = 0;
+		uint32_t TransientImages = 0;
+		VkDeviceSize TransientMemory = 0;
+		VkDeviceSize AliasedMemory = 0;
+	};
+
+	struct RenderGraphAccess
+	{
+		RenderGraphResource Resource;
+		VkPipelineStageFlags Stages = 0;
+		VkAccessFlags Access = 0;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool Write = false;
+
+		// Previous contents are overwritten entirely, a layout transition can start from undefined
+		bool Discard = false;
+	};
+
+	struct RenderGraphAttachment
+	{
+		RenderGraphResource Resource;
+		VkAttachmentLoadOp LoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		VkClearValue ClearValue = {};
+	};
+
+	using RenderGraphExecuteFunction = std::function<void(const RenderGraphPassContext&)>;
+
+	struct RenderGraphPass
+	{
+		std::string Name;
+		RenderGraphPassType Type = RenderGraphPassType::NONE;
+		RenderGraphExecuteFunction Execute;
+
+		std::vector<RenderGraphAccess> Accesses;
+		std::vector<RenderGraphAttachment> ColorAttachments;
+		RenderGraphAttachment DepthAttachment;
+		VkSubpassContents SubpassContents = VK_SUBPASS_CONTENTS_INLINE;
+		bool SideEffect = false;
+		bool Culled = false;
+	};
+
+	class RenderGraph;
+
+	// Handed to a pass while it is set up so it can declare what it reads and writes
+	class RenderGraphPassBuilder
+	{
+	public:
+		RenderGraphPassBuilder(RenderGraph& graph, RenderGraphPass& pass);
+
+	public:
+		void WriteColor(RenderGraphResource image, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, const VkClearColorValue& clearValue = {});
+		void WriteDepth(RenderGraphResource image, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, const VkClearDepthStencilValue& clearValue = { 1.0f, 0 });
+
+		// Sampled image, defaults to the read only layout that matches the format
+		void ReadTexture(RenderGraphResource image, VkPipelineStageFlags stages, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+		// Storage images stay in the general layout, works for storage buffers as well
+		void ReadStorage(RenderGraphResource resource, VkPipelineStageFlags stages);
+		void WriteStorage(RenderGraphResource resource, VkPipelineStageFlags stages);
+
+		// Fixed function buffer reads such as indirect commands or vertex attributes
+		void ReadBuffer(RenderGraphResource buffer, VkPipelineStageFlags stages, VkAccessFlags access);
+
+		// Draws are recorded into secondary command buffers and executed inside the pass
+		void SetSubpassContents(VkSubpassContents contents);
+
+		// Keeps the pass even if nothing in the graph reads its output, e.g. it presents or writes to the CPU
+		void SetSideEffect();
+
+	private:
+		void AddAccess(RenderGraphResource resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout, bool write, bool discard = false);
+
+	private:
+		RenderGraph& m_Graph;
+		RenderGraphPass& m_Pass;
+	};
+
+	// Passes declare the resources they use each frame, the graph culls passes whose results are never used,
+	// inserts batched barriers between passes and aliases the memory of transient images that are never alive at the same time
+	class RenderGraph
+	{
+	public:
+		RenderGraph();
+		~RenderGraph();
+
+	public:
+		RenderGraphResource CreateImage(const std::string& name, const RenderGraphImageDescription& description);
+		RenderGraphResource ImportImage(const std::string& name, Ref<VulkanImage> image);
+		RenderGraphResource ImportBuffer(const std::string& name, VkBuffer buffer);
+
+		void AddPass(const std::string& name, RenderGraphPassType type, const std::function<void(RenderGraphPassBuilder&)>& setup, const RenderGraphExecuteFunction& execute);
+
+		void Compile();
+		void Execute(VkCommandBuffer commandBuffer);
+
+		// Drops this frame's passes and resources, physical images and their memory are kept for the next frame
+		void Reset();
+
+		VkImage GetImage(RenderGraphResource resource) const;
+		VkImageView GetImageView(RenderGraphResource resource) const;
+		VkImageView GetDepthImageView(RenderGraphResource resource) const;
+		VkBuffer GetBuffer(RenderGraphResource resource) const;
+		const RenderGraphImageDescription& GetImageDescription(RenderGraphResource resource) const;
+
+		// Render pass compatible with graphics passes that write these formats, used to create pipelines
+		VkRenderPass GetCompatibleRenderPass(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat);
+
+		inline const RenderGraphStats& GetStats() const { return m_Stats; }
+
+	private:
+		struct ResourceState
+		{
+			VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags WriteStages = 0;
+			VkAccessFlags WriteAccess = 0;
+
+			// Stages that read since the last write and the reads that already waited for it
+			VkPipelineStageFlags ReadStages = 0;
+			VkAccessFlags ReadAccess = 0;
+		};
+
+		struct Resource
+		{
+			std::string Name;
+			bool Imported = false;
+			bool IsBuffer = false;
+
+			RenderGraphImageDescription Description;
+			VkImageUsageFlags Usage = 0;
+
+			Ref<VulkanImage> ImportedImage;
+			VkBuffer Buffer = nullptr;
+
+			// Transient images, index into m_PhysicalImages
+			uint32_t PhysicalIndex = UINT32_MAX;
+
+			uint32_t FirstPass = UINT32_MAX;
+			uint32_t LastPass = 0;
+
+			ResourceState State;
+		};
+
+		struct PhysicalImage
+		{
+			RenderGraphImageDescription Description;
+			VkImageUsageFlags Usage = 0;
+			uint32_t MemorySlot = 0;
+
+			VkImage Image = nullptr;
+			VkImageView ImageView = nullptr;
+			VkImageView DepthImageView = nullptr;
+		};
+
+		// Block of memory shared by transient images that don't overlap in time
+		struct MemorySlot
+		{
+			VmaAllocation Allocation = nullptr;
+			VkMemoryRequirements Requirements = {};
+			uint32_t LastPass = 0;
+			ResourceState State;
+		};
+
+		struct RenderPassKey
+		{
+			std::vector<VkFormat> Formats;
+			std::vector<VkAttachmentLoadOp> LoadOps;
+			std::vector<VkAttachmentStoreOp> StoreOps;
+			bool HasDepth = false;
+
+			bool operator<(const RenderPassKey& other) const;
+		};
+
+	private:
+		void CullPasses();
+		void ComputeLifetimes();
+		void AllocateTransientImages();
+		void DestroyTransientImages();
+
+		void InsertBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex);
+		void ExecutePass(VkCommandBuffer commandBuffer, uint32_t passIndex);
+
+		uint64_t GetHandle(const Resource& resource) const;
+		VkRenderPass GetRenderPass(const RenderPassKey& key);
+		VkFramebuffer GetFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& attachments, VkExtent2D extent);
+
+	private:
+		std::vector<Resource> m_Resources;
+		std::vector<RenderGraphPass> m_Passes;
+
+		std::vector<PhysicalImage> m_PhysicalImages;
+		std::vector<MemorySlot> m_MemorySlots;
+		uint64_t m_PhysicalLayoutHash = 0;
+		VkDeviceSize m_AliasedMemory = 0;
+		bool m_Compiled = false;
+
+		// States of imported resources carry over between frames, keyed by their Vulkan handle
+		std::unordered_map<uint64_t, ResourceState> m_ImportedStates;
+
+		std::map<RenderPassKey, VkRenderPass> m_RenderPasses;
+		std::unordered_map<uint64_t, VkFramebuffer> m_Framebuffers;
+
+		RenderGraphStats m_Stats;
+
+		friend class RenderGraphPassBuilder;
+	};
+
+}
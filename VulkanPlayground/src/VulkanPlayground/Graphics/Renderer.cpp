@@ -1,12 +1,105 @@
 #include "pch.h"
 #include "Renderer.h"
 #include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/RadixSort.h"
+#include "VulkanPlayground/Core/JobSystem.h"
+#include "VulkanPlayground/Core/Hash.h"
+#include "VulkanPlayground/Graphics/BindlessDescriptors.h"
+#include "VulkanPlayground/Graphics/GeometryArena.h"
 #include "VulkanPlayground/Graphics/ImGUI/imgui_impl_vulkan_with_textures.h"
 
 namespace VKPlayground {
 
 	static Renderer* s_Instance = nullptr;
 
+	static const uint32_t s_UniformRingBufferSize = 1024 * 1024;
+	static const uint32_t s_InstanceRingBufferSize = 16 * 1024 * 1024;
+	static const uint32_t s_IndirectRingBufferSize = 4 * 1024 * 1024;
+	static const uint32_t s_CullRingBufferSize = 16 * 1024 * 1024;
+	static const uint32_t s_MaterialRingBufferSize = 1024 * 1024;
+
+	static const uint32_t s_CullGroupSize = 64;
+	static const uint32_t s_MeshletCullGroupSize = 64;
+	static const uint32_t s_HiZGroupSize = 8;
+
+	// The meshlet pass dispatches one row of workgroups per instance and the Y dimension is only guaranteed to reach 65535.
+	// Batches past either limit are drawn whole with instance culling only.
+	static const uint32_t s_MaxMeshletInstances = 65535;
+	static const uint32_t s_MaxMeshletDraws = 1024 * 1024;
+
+	static const uint32_t s_MinBatchesPerChunk = 64;
+
+	// Widths of the ID fields in DrawCommand::SortKey, indexed by SortKeyField
+	static const uint32_t s_SortKeyFieldBits[(uint32_t)SortKeyField::Count] = { 8, 12, 12 };
+	static const uint32_t s_MaxSubMeshSortID = 0xFFF;
+
+	// Geometry moved per frame when defragmenting the arena, the copies share the frame's upload submission
+	static const uint64_t s_GeometryDefragmentBytes = 4 * 1024 * 1024;
+
+	static const VkFormat s_ColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	static const VkFormat s_DepthFormat = VK_FORMAT_D24_UNORM_S8_UINT;
+
+	namespace Utils {
+
+		static uint64_t EncodeSortKey(uint32_t pipeline, uint32_t material, uint32_t geometry, uint32_t subMesh, float depth)
+		{
+			// The bit pattern of a positive float increases with its value, so the top bits can be sorted as an integer
+			uint32_t depthBits;
+			depth = std::max(depth, 0.0f);
+			memcpy(&depthBits, &depth, sizeof(float));
+
+			uint64_t key = 0;
+			key |= (uint64_t)(pipeline & 0xFF) << 56;
+			key |= (uint64_t)(material & 0xFFF) << 44;
+			key |= (uint64_t)(geometry & 0xFFF) << 32;
+			key |= (uint64_t)(subMesh & 0xFFF) << 20;
+			key |= (uint64_t)(depthBits >> 11) & 0xFFFFF;
+			return key;
+		}
+
+		// Pipeline and material bits, descriptor sets have to be rebound when these change
+		static uint64_t GetSortKeyState(uint64_t key)
+		{
+			return key >> 44;
+		}
+
+		static uint64_t GetSortKeyPipeline(uint64_t key)
+		{
+			return key >> 56;
+		}
+
+		static bool CanInstance(const DrawCommand& a, const DrawCommand& b)
+		{
+			// Everything above the depth bits has to match, the rest guards against resources sharing an overflowed sort ID
+			return (a.SortKey >> 20) == (b.SortKey >> 20)
+				&& a.Pipeline == b.Pipeline
+				&& a.MaterialIndex == b.MaterialIndex
+				&& a.VertexBuffer == b.VertexBuffer
+				&& a.IndexBuffer == b.IndexBuffer
+				&& a.SubMesh.IndexType == b.SubMesh.IndexType
+				&& a.SubMesh.VertexOffset == b.SubMesh.VertexOffset
+				&& a.SubMesh.IndexOffset == b.SubMesh.IndexOffset
+				&& a.SubMesh.IndexCount == b.SubMesh.IndexCount;
+		}
+
+		// Grows one of the per-frame GPU buffers, the GPU is done with it since the frame's fence was waited on before the frame began
+		static void EnsureBufferCapacity(Ref<VulkanBuffer>& buffer, uint32_t& capacity, uint32_t count, uint32_t elementSize, VkBufferUsageFlags usage)
+		{
+			if (buffer && count <= capacity)
+				return;
+
+			capacity = std::max({ count, capacity * 2, 1u });
+			buffer = CreateRef<VulkanBuffer>(nullptr, capacity * elementSize, usage, VMA_MEMORY_USAGE_GPU_ONLY);
+		}
+
+		// Per-instance vertex buffer layout, matches InstanceData
+		static VertexFormat GetInstanceFormat()
+		{
+			return VertexFormat({ { VertexSemantic::TRANSFORM, VK_FORMAT_R32G32B32A32_SFLOAT, 4 } }, VK_VERTEX_INPUT_RATE_INSTANCE);
+		}
+
+	}
+
 	Renderer::Renderer()
 	{
 		s_Instance = this;
@@ -17,26 +110,112 @@ namespace VKPlayground {
 	{
 		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
 
-		for (int i = 0; i < m_DescriptorPools.size(); i++)
+		for (auto& framePools : m_SecondaryCommandPools)
 		{
-			vkDestroyDescriptorPool(device, m_DescriptorPools[i], nullptr);
+			for (SecondaryCommandPool& pool : framePools)
+			{
+				vkDestroyCommandPool(device, pool.CommandPool, nullptr);
+			}
 		}
+
+		BindlessDescriptors::ReleaseBuffer(m_MaterialBufferIndex);
+
+		// Pending pipelines are created against the render graph's render passes
+		PipelineCache::WaitIdle();
 	}
 
 	void Renderer::Init()
 	{
-		FramebufferSpecification spec;
-		spec.AttachmentFormats = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_D24_UNORM_S8_UINT };
-		spec.Width = 1280;
-		spec.Height = 720;
-		m_Framebuffer = CreateRef<VulkanFramebuffer>(spec);
+		m_RenderGraph = CreateRef<RenderGraph>();
+
+		// The scene is rendered into an image that outlives the frame so the viewport can display it, depth is transient
+		ImageSpecification colorSpecification = {};
+		colorSpecification.Data = nullptr;
+		colorSpecification.Width = m_ViewportWidth;
+		colorSpecification.Height = m_ViewportHeight;
+		colorSpecification.Format = s_ColorFormat;
+		colorSpecification.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		colorSpecification.UseStagingBuffer = false;
+		m_ColorImage = CreateRef<VulkanImage>(colorSpecification);
+
+		uint32_t uniformAlignment = (uint32_t)Application::GetApp().GetVulkanDevice()->GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+		m_UniformRingBuffer = CreateRef<VulkanRingBuffer>(s_UniformRingBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, uniformAlignment);
+		m_InstanceRingBuffer = CreateRef<VulkanRingBuffer>(s_InstanceRingBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(glm::vec4));
+
+		// The cull shader writes instance counts straight into the indirect commands so they are also bound as storage buffers
+		uint32_t storageAlignment = (uint32_t)Application::GetApp().GetVulkanDevice()->GetPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment;
+		m_IndirectRingBuffer = CreateRef<VulkanRingBuffer>(s_IndirectRingBufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, std::max(storageAlignment, (uint32_t)sizeof(uint32_t)));
+		m_CullRingBuffer = CreateRef<VulkanRingBuffer>(s_CullRingBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, storageAlignment);
+
+		// Batches use firstInstance to select their instance data so the indirect path needs drawIndirectFirstInstance
+		Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+		m_IndirectDrawSupported = device->GetEnabledFeatures().drawIndirectFirstInstance;
+		m_MultiDrawIndirectSupported = m_IndirectDrawSupported && device->GetEnabledFeatures().multiDrawIndirect;
+		m_IndirectCountSupported = m_MultiDrawIndirectSupported && device->GetEnabledVulkan12Features().drawIndirectCount;
 
-		m_CameraUniformBuffer = CreateRef<VulkanUniformBuffer>(nullptr, sizeof(CameraBuffer));
+		// Binding 0 is swapped for the format of each mesh, see GetPipelineVariant
+		m_PipelineSpecification.VertexBuffers = { VertexFormat::Compact(), Utils::GetInstanceFormat() };
+		m_PipelineSpecification.ColorFormats = { s_ColorFormat };
+		m_PipelineSpecification.DepthFormat = s_DepthFormat;
+		m_PipelineSpecification.RenderPass = m_RenderGraph->GetCompatibleRenderPass(m_PipelineSpecification.ColorFormats, m_PipelineSpecification.DepthFormat);
+
+		PipelineSpecification pipelineSpecification = m_PipelineSpecification;
 
 		m_Shader = CreateRef<Shader>("assets/shaders/test.shader");
-		m_Pipeline = CreateRef<VulkanPipeline>(m_Shader, m_Framebuffer->GetRenderPass());
+		pipelineSpecification.Shader = m_Shader;
+		m_Pipeline = PipelineCache::GetPipeline(pipelineSpecification);
+
+		m_BindlessSupported = BindlessDescriptors::IsSupported();
+		if (m_BindlessSupported)
+		{
+			m_BindlessShader = CreateRef<Shader>("assets/shaders/bindless.shader");
+			pipelineSpecification.Shader = m_BindlessShader;
+			m_BindlessPipeline = PipelineCache::GetPipeline(pipelineSpecification);
+
+			// The whole buffer is registered once, the frame's slice is selected with the offset in the push constants
+			m_MaterialRingBuffer = CreateRef<VulkanRingBuffer>(s_MaterialRingBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, storageAlignment);
+			m_MaterialBufferIndex = BindlessDescriptors::RegisterBuffer({ m_MaterialRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE });
+
+			// Draws without a texture sample this
+			uint8_t white[4] = { 255, 255, 255, 255 };
+
+			ImageSpecification whiteSpecification = {};
+			whiteSpecification.Data = white;
+			whiteSpecification.Width = 1;
+			whiteSpecification.Height = 1;
+			whiteSpecification.Format = VK_FORMAT_R8G8B8A8_UNORM;
+			whiteSpecification.Usage = 0;
+			whiteSpecification.UseStagingBuffer = true;
+			m_WhiteImage = CreateRef<VulkanImage>(whiteSpecification);
+		}
+
+		m_ActiveShader = m_Shader;
+		m_ActivePipeline = m_Pipeline;
+
+		m_CullShader = CreateRef<Shader>("assets/shaders/cull.shader");
+		m_CullPipeline = CreateRef<VulkanComputePipeline>(m_CullShader);
 
-		CreateDescriptorPools();
+		m_HiZShader = CreateRef<Shader>("assets/shaders/hiz.shader");
+		m_HiZPipeline = CreateRef<VulkanComputePipeline>(m_HiZShader);
+
+		// Meshlets are read through the bindless buffer array and every batch draws a GPU written number of meshlets
+		if (m_BindlessSupported && m_IndirectCountSupported)
+		{
+			m_MeshletCullShader = CreateRef<Shader>("assets/shaders/meshlet_cull.shader");
+			m_MeshletCullPipeline = CreateRef<VulkanComputePipeline>(m_MeshletCullShader);
+		}
+
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+		m_VisibleInstanceBuffers.resize(framesInFlight);
+		m_VisibleInstanceCapacities.resize(framesInFlight, 0);
+		m_MeshletInstanceBuffers.resize(framesInFlight);
+		m_MeshletInstanceCapacities.resize(framesInFlight, 0);
+		m_MeshletDrawBuffers.resize(framesInFlight);
+		m_MeshletDrawCapacities.resize(framesInFlight, 0);
+
+		CreateHiZ();
+		m_DescriptorCache = CreateRef<VulkanDescriptorCache>();
+		CreateSecondaryCommandPools();
 	}
 
 	void Renderer::BeginFrame()
@@ -46,11 +225,28 @@ namespace VKPlayground {
 		uint32_t frameIndex = swapChain->GetCurrentBufferIndex();
 
 		m_ActiveCommandBuffer = swapChain->GetCurrentCommandBuffer();
+		m_UniformRingBuffer->BeginFrame(frameIndex);
+		m_InstanceRingBuffer->BeginFrame(frameIndex);
+		m_IndirectRingBuffer->BeginFrame(frameIndex);
+		m_CullRingBuffer->BeginFrame(frameIndex);
+
+		if (m_MaterialRingBuffer)
+			m_MaterialRingBuffer->BeginFrame(frameIndex);
 		
-		VK_CHECK_RESULT(vkResetDescriptorPool(device, m_DescriptorPools[frameIndex], 0));
+		m_DescriptorCache->BeginFrame();
+		BindlessDescriptors::BeginFrame();
 
-		const std::vector<VkDescriptorSetLayout>& layouts = m_Shader->GetDescriptorSetLayouts();
-		m_DescriptorSets = AllocateDescriptorSets(m_Shader->GetDescriptorSetLayouts());
+		// Before any mesh is submitted, draws of this frame have to see the ranges after the move
+		GeometryArena::BeginFrame();
+		if (m_Settings.DefragmentGeometry)
+			GeometryArena::Defragment(s_GeometryDefragmentBytes);
+
+		// Secondary command buffers of this frame finished executing when its fence was waited on
+		for (SecondaryCommandPool& pool : m_SecondaryCommandPools[frameIndex])
+		{
+			VK_CHECK_RESULT(vkResetCommandPool(device, pool.CommandPool, 0));
+			pool.UsedCount = 0;
+		}
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -62,192 +258,1280 @@ namespace VKPlayground {
 
 	void Renderer::EndFrame()
 	{
+		AddUIPass();
+
+		m_RenderGraph->Compile();
+		m_RenderGraph->Execute(m_ActiveCommandBuffer);
+		m_RenderGraph->Reset();
+
+		// Pass callbacks read the draw list while the graph executes, so it is only cleared now
+		m_DrawList.clear();
+		for (auto& ids : m_SortIDs)
+			ids.clear();
+
 		VK_CHECK_RESULT(vkEndCommandBuffer(m_ActiveCommandBuffer));
 	}
 
 	void Renderer::BeginScene(Ref<Camera> camera)
 	{
-		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
-
 		m_ActiveCamera = camera;
 
 		m_CameraBuffer.ViewProjection = m_ActiveCamera->GetViewProjection();
 		m_CameraBuffer.InverseViewProjection = m_ActiveCamera->GetInverseVP();
-		m_CameraUniformBuffer->UpdateBuffer(&m_CameraBuffer);
+		m_CameraPosition = m_ActiveCamera->GetPosition();
 
-		UniformBufferDescription cameraBufferDescription = m_Shader->GetUniformBufferDescriptions()[0];
+		// Projection scale along y times half the viewport height turns a size over a distance into pixels
+		m_LODScale = std::abs(m_ActiveCamera->GetProjectionMatrix()[1][1]) * m_ViewportHeight * 0.5f;
+		m_LODHistory.swap(m_NextLODHistory);
+		m_NextLODHistory.clear();
+		m_MeshSubmitCounts.clear();
+
+		m_BindlessActive = m_Settings.Bindless && m_BindlessSupported;
+		m_ActiveShader = m_BindlessActive ? m_BindlessShader : m_Shader;
+		m_ActivePipeline = m_BindlessActive ? m_BindlessPipeline : m_Pipeline;
+		m_PendingPipelineDraws = 0;
+		m_TransformUpdates = 0;
+
+		// Write camera data into this frame's slice of the ring buffer, the slice is selected with a dynamic offset when binding
+		const std::vector<UniformBufferDescription>& uniformBufferDescriptions = m_ActiveShader->GetUniformBufferDescriptions();
+		m_DynamicOffsets.assign(uniformBufferDescriptions.size(), 0);
+		m_DynamicOffsets[0] = m_UniformRingBuffer->Push(m_CameraBuffer);
+
+		const UniformBufferDescription& cameraBufferDescription = uniformBufferDescriptions[0];
+		VkDescriptorBufferInfo cameraBufferInfo = m_UniformRingBuffer->GetDescriptorBufferInfo(sizeof(CameraBuffer));
 
 		VkWriteDescriptorSet cameraBufferWriteDescriptor = {};
 		cameraBufferWriteDescriptor.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		cameraBufferWriteDescriptor.descriptorCount = 1;
-		cameraBufferWriteDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		cameraBufferWriteDescriptor.dstSet = m_DescriptorSets[cameraBufferDescription.Index];
+		cameraBufferWriteDescriptor.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		cameraBufferWriteDescriptor.dstBinding = cameraBufferDescription.BindingPoint;
-		cameraBufferWriteDescriptor.pBufferInfo = &m_CameraUniformBuffer->getDescriptorBufferInfo();
+		cameraBufferWriteDescriptor.pBufferInfo = &cameraBufferInfo;
 		cameraBufferWriteDescriptor.pImageInfo = nullptr;
 
-		VkWriteDescriptorSet writeDescriptors[1] = { cameraBufferWriteDescriptor };
-
-		vkUpdateDescriptorSets(device, 1, writeDescriptors, 0, nullptr);
+		// The ring buffer slice is picked by the dynamic offset, so the sets stay the same from frame to frame and come from the cache
+		const std::vector<VkDescriptorSetLayout>& layouts = m_ActiveShader->GetDescriptorSetLayouts();
+		m_DescriptorSets.resize(layouts.size());
+		for (uint32_t i = 0; i < layouts.size(); i++)
+		{
+			if ((int)i == m_ActiveShader->GetBindlessLayoutIndex())
+				m_DescriptorSets[i] = BindlessDescriptors::GetDescriptorSet();
+			else if (i == cameraBufferDescription.Index)
+				m_DescriptorSets[i] = m_DescriptorCache->GetDescriptorSet(layouts[i], &cameraBufferWriteDescriptor, 1);
+			else
+				m_DescriptorSets[i] = m_DescriptorCache->GetDescriptorSet(layouts[i], nullptr, 0);
+		}
 	}
 
 	void Renderer::EndScene()
 	{
+		PrepareDraws();
+		AddScenePasses();
+
 		m_ActiveCamera = nullptr;
-		m_DrawList.clear();
 	}
 
-	void Renderer::BeginRenderPass(Ref<VulkanFramebuffer> framebuffer)
+	Ref<AsyncPipeline> Renderer::LoadPipeline(const std::string& shaderPath)
+	{
+		return PipelineCache::GetPipelineAsync(shaderPath, m_PipelineSpecification);
+	}
+
+	VulkanPipeline* Renderer::GetPipelineVariant(VulkanPipeline* pipeline, const VertexFormat& vertexFormat)
 	{
-		VkRenderPass renderPass;
-		VkFramebuffer vulkanFramebuffer;
-		VkExtent2D extent;
+		// Pipelines live in the cache until shutdown so their address is a stable key
+		uint64_t key = Hash::Combine(Hash::Combine(Hash::FNVOffsetBasis, pipeline), vertexFormat.GetHash());
+
+		auto it = m_PipelineVariants.find(key);
+		if (it != m_PipelineVariants.end())
+			return it->second;
 
-		if (framebuffer)
+		PipelineSpecification specification = pipeline->GetSpecification();
+		specification.VertexBuffers[0] = vertexFormat;
+
+		VulkanPipeline* variant = PipelineCache::GetPipeline(specification).get();
+		m_PipelineVariants[key] = variant;
+		return variant;
+	}
+
+	void Renderer::SubmitMesh(Ref<Mesh> mesh, glm::mat4& transform, Ref<Texture2D> texture, Ref<AsyncPipeline> pipeline)
+	{
+		// Never wait on a compile here, the mesh is drawn with the fallback or left out until the pipeline is ready
+		VulkanPipeline* drawPipeline = m_ActivePipeline.get();
+		if (pipeline)
 		{
-			vulkanFramebuffer = framebuffer->GetFramebuffer();
-			renderPass = framebuffer->GetRenderPass();
-			extent = { framebuffer->GetWidth(), framebuffer->GetHeight() };
+			if (pipeline->IsReady())
+			{
+				drawPipeline = pipeline->GetPipeline().get();
+			}
+			else
+			{
+				m_PendingPipelineDraws++;
+				if (!m_Settings.FallbackPipeline)
+					return;
+			}
 		}
-		else
+
+		if (drawPipeline->GetSpecification().VertexBuffers[0] != mesh->GetVertexFormat())
+			drawPipeline = GetPipelineVariant(drawPipeline, mesh->GetVertexFormat());
+
+		uint32_t pipelineID = GetSortID(SortKeyField::Pipeline, drawPipeline);
+		uint32_t geometryID = GetSortID(SortKeyField::Geometry, mesh.get());
+
+		// Textures are only read through the bindless arrays, the other path has no per-material descriptors yet.
+		// Materials still get their own sort bits so instanced batches never mix textures, GPU culling compacts instances within a batch.
+		uint32_t materialID = 0;
+		uint32_t materialIndex = 0;
+		if (m_BindlessActive)
 		{
-			Ref<VulkanSwapChain> swapChain = Application::GetApp().GetVulkanSwapChain();
+			materialID = GetSortID(SortKeyField::Material, texture.get());
+			materialIndex = texture && texture->GetBindlessIndex() != BindlessInvalidIndex ? texture->GetBindlessIndex() : m_WhiteImage->GetBindlessIndex();
+		}
+
+		uint32_t submitIndex = m_MeshSubmitCounts[mesh.get()]++;
+		uint64_t submitKey = Hash::Combine(Hash::Combine(Hash::FNVOffsetBasis, mesh.get()), submitIndex);
+
+		// Only nodes changed since the last submit are recomputed, a static mesh costs one check here
+		TransformHierarchy& hierarchy = mesh->GetTransformHierarchy();
+		m_TransformUpdates += hierarchy.Update();
+
+		// Ranges are looked up on every submit since defragmentation can move them between frames
+		GeometryRange vertexRange = mesh->GetVertexRange();
+		GeometryRange indexRanges[2] = { mesh->GetIndexRange(VK_INDEX_TYPE_UINT16), mesh->GetIndexRange(VK_INDEX_TYPE_UINT32) };
+		uint32_t vertexBase = (uint32_t)(vertexRange.Offset / mesh->GetVertexFormat().GetStride());
 
-			vulkanFramebuffer = swapChain->GetCurrentFramebuffer();
-			renderPass = swapChain->GetRenderPass();
-			extent = swapChain->GetExtent();
+		const std::vector<SubMesh>& subMeshes = mesh->GetSubMeshes();
+		const std::vector<SubMeshInstance>& subMeshInstances = mesh->GetSubMeshInstances();
+		for (uint32_t i = 0; i < subMeshInstances.size(); i++)
+		{
+			const SubMeshInstance& instance = subMeshInstances[i];
+			const SubMesh& subMesh = subMeshes[instance.SubMesh];
+
+			glm::mat4 subMeshTransform = instance.Node != InvalidMeshNode ? transform * hierarchy.GetWorldTransform(instance.Node) : transform;
+			uint32_t lod = SelectLOD(*mesh, subMesh, subMeshTransform, Hash::Combine(submitKey, i));
+
+			// Front to back within a state group, measured from the camera to the node origin
+			float depth = glm::distance(glm::vec3(subMeshTransform[3]), m_ActiveCamera->GetPosition());
+
+			DrawCommand& command = m_DrawList.emplace_back();
+			command.SubMesh = subMesh;
+			command.VertexBuffer = vertexRange.Buffer;
+			command.Transform = subMeshTransform;
+			command.Pipeline = drawPipeline;
+			command.MaterialIndex = materialIndex;
+			command.MeshletBuffer = mesh->GetMeshletBufferIndex();
+			command.LOD = lod;
+
+			// Meshlets only cover the full detail triangles, coarser levels are drawn as a whole
+			if (lod > 0)
+			{
+				const SubMeshLOD& subMeshLOD = mesh->GetLODs()[subMesh.LODOffset + lod];
+				command.SubMesh.IndexOffset = subMeshLOD.IndexOffset;
+				command.SubMesh.IndexCount = subMeshLOD.IndexCount;
+				command.SubMesh.MeshletCount = 0;
+			}
+
+			// Draws of every mesh in the same arena buffers only differ by these offsets, so they share binds and indirect runs
+			bool indices32 = subMesh.IndexType == VK_INDEX_TYPE_UINT32;
+			const GeometryRange& indexRange = indexRanges[indices32];
+			command.IndexBuffer = indexRange.Buffer;
+			command.SubMesh.IndexOffset += (uint32_t)(indexRange.Offset / (indices32 ? sizeof(uint32_t) : sizeof(uint16_t)));
+			command.SubMesh.VertexOffset += vertexBase;
+
+			// Every level of a submesh sorts on its own so instances of the same level batch together. Submeshes past the
+			// width of the field share its last value, CanInstance still compares their index ranges.
+			uint32_t subMeshSortID = std::min(instance.SubMesh * MeshMaxLODs + lod, s_MaxSubMeshSortID);
+			command.SortKey = Utils::EncodeSortKey(pipelineID, materialID, geometryID, subMeshSortID, depth);
 		}
+	}
 
-		VkClearValue clearColor[2];
-		clearColor[0].color = { 0.1f, 0.1f, 0.1f, 1.0f };
-		clearColor[1].depthStencil = { 1.0f, 0 };
+	uint32_t Renderer::SelectLOD(const Mesh& mesh, const SubMesh& subMesh, const glm::mat4& transform, uint64_t historyKey)
+	{
+		if (!m_Settings.LOD || subMesh.LODCount <= 1)
+			return 0;
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = vulkanFramebuffer;
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = extent;
-		renderPassInfo.clearValueCount = framebuffer ? 2 : 1;
-		renderPassInfo.pClearValues = clearColor;
+		// Bounding sphere around the box, scaled by the longest axis so the error is never underestimated
+		glm::vec3 scale = glm::vec3(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])));
+		float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+		glm::vec3 center = glm::vec3(transform * glm::vec4((subMesh.BoundsMin + subMesh.BoundsMax) * 0.5f, 1.0f));
+		float radius = glm::distance(subMesh.BoundsMin, subMesh.BoundsMax) * 0.5f * maxScale;
+
+		// Full detail once the camera is inside the sphere
+		float distance = glm::distance(center, m_CameraPosition) - radius;
+		if (distance <= 0.0f)
+		{
+			m_NextLODHistory[historyKey] = 0;
+			return 0;
+		}
+
+		float pixelsPerUnit = m_LODScale * maxScale / distance;
+
+		auto it = m_LODHistory.find(historyKey);
+		bool hasPrevious = it != m_LODHistory.end();
+		uint32_t previous = hasPrevious ? it->second : 0;
+
+		// Errors grow with every level, pick the last one that still fits. Levels up to the current one get a looser threshold and
+		// coarser ones a tighter one, so a draw sitting right at the threshold keeps its level.
+		const SubMeshLOD* lods = mesh.GetLODs().data() + subMesh.LODOffset;
+		uint32_t lod = 0;
+		for (uint32_t i = 1; i < subMesh.LODCount; i++)
+		{
+			float threshold = m_Settings.LODErrorThreshold;
+			if (hasPrevious)
+				threshold *= i <= previous ? 1.0f + m_Settings.LODHysteresis : 1.0f - m_Settings.LODHysteresis;
+
+			if (lods[i].Error * pixelsPerUnit > threshold)
+				break;
+
+			lod = i;
+		}
+
+		m_NextLODHistory[historyKey] = lod;
+		return lod;
+	}
+
+	void Renderer::PrepareDraws()
+	{
+		m_Stats = {};
+		m_Stats.PendingPipelineDraws = m_PendingPipelineDraws;
+		m_Stats.TransformUpdates = m_TransformUpdates;
+
+		if (m_Settings.CPUCulling)
+			CullDrawList();
+
+		for (const DrawCommand& command : m_DrawList)
+		{
+			m_Stats.Triangles += command.SubMesh.IndexCount / 3;
+			m_Stats.LODDraws[command.LOD]++;
+		}
+
+		BuildDrawBatches();
+		m_CullingActive = false;
+		m_MeshletCullingActive = false;
+
+		if (!m_DrawBatches.empty())
+		{
+			// GPU culling writes instance counts into the indirect commands, so it is only possible on the indirect path
+			m_CullingActive = m_Settings.GPUCulling && m_IndirectDrawSupported;
+			m_MeshletCullingActive = m_CullingActive && m_Settings.MeshletCulling && m_MeshletCullPipeline;
+
+			if (m_CullingActive || (m_Settings.IndirectDraw && m_IndirectDrawSupported))
+				WriteIndirectCommands();
 
+			// Buffers are imported into the render graph before the passes run, so they are sized up front
+			if (m_CullingActive)
+			{
+				WriteMeshletBatches();
+				ResizeCullBuffers();
+			}
+		}
+	}
+
+	void Renderer::AddScenePasses()
+	{
+		uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+
+		RenderGraphResource color = m_RenderGraph->ImportImage("Color", m_ColorImage);
+		RenderGraphResource depth = m_RenderGraph->CreateImage("Depth", { m_ViewportWidth, m_ViewportHeight, s_DepthFormat });
+		RenderGraphResource hiz = m_RenderGraph->ImportImage("HiZ", m_HiZImage);
+
+		RenderGraphResource indirectCommands;
+		RenderGraphResource visibleInstances;
+		RenderGraphResource meshletInstances;
+		RenderGraphResource meshletDraws;
+
+		if (m_CullingActive)
+		{
+			indirectCommands = m_RenderGraph->ImportBuffer("IndirectCommands", m_IndirectRingBuffer->GetVulkanBuffer());
+			visibleInstances = m_RenderGraph->ImportBuffer("VisibleInstances", m_VisibleInstanceBuffers[frameIndex]->GetVulkanBuffer());
+			meshletInstances = m_RenderGraph->ImportBuffer("MeshletInstances", m_MeshletInstanceBuffers[frameIndex]->GetVulkanBuffer());
+
+			m_RenderGraph->AddPass("Cull", RenderGraphPassType::COMPUTE,
+				[&](RenderGraphPassBuilder& builder)
+				{
+					builder.ReadTexture(hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_LAYOUT_GENERAL);
+					builder.WriteStorage(indirectCommands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.WriteStorage(visibleInstances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.WriteStorage(meshletInstances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+				},
+				[this](const RenderGraphPassContext& context)
+				{
+					DispatchCulling(context.CommandBuffer);
+				});
+		}
+
+		// The dispatch size and the draw counts live in the indirect ring next to the batch commands
+		if (m_MeshletCullingActive)
+		{
+			meshletDraws = m_RenderGraph->ImportBuffer("MeshletDraws", m_MeshletDrawBuffers[frameIndex]->GetVulkanBuffer());
+
+			m_RenderGraph->AddPass("MeshletCull", RenderGraphPassType::COMPUTE,
+				[&](RenderGraphPassBuilder& builder)
+				{
+					builder.ReadBuffer(indirectCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+					builder.WriteStorage(indirectCommands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.ReadStorage(visibleInstances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.ReadStorage(meshletInstances, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.ReadTexture(hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_IMAGE_LAYOUT_GENERAL);
+					builder.WriteStorage(meshletDraws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+				},
+				[this](const RenderGraphPassContext& context)
+				{
+					DispatchMeshletCulling(context.CommandBuffer);
+				});
+		}
+
+		bool parallel = m_Settings.ParallelRecording;
+		m_RenderGraph->AddPass("Geometry", RenderGraphPassType::GRAPHICS,
+			[&](RenderGraphPassBuilder& builder)
+			{
+				builder.WriteColor(color, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.1f, 0.1f, 0.1f, 1.0f });
+				builder.WriteDepth(depth);
+
+				if (m_CullingActive)
+				{
+					builder.ReadBuffer(indirectCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+					builder.ReadBuffer(visibleInstances, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+				}
+
+				if (m_MeshletCullingActive)
+					builder.ReadBuffer(meshletDraws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+				// The main pass is recorded into secondary command buffers on the job system
+				if (parallel)
+					builder.SetSubpassContents(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			},
+			[this, parallel](const RenderGraphPassContext& context)
+			{
+				RenderGeometry(context, parallel);
+			});
+
+		// Next frame's occlusion test reads the depth written by this frame
+		if (m_CullingActive && m_Settings.OcclusionCulling)
+		{
+			m_RenderGraph->AddPass("HiZ", RenderGraphPassType::COMPUTE,
+				[&](RenderGraphPassBuilder& builder)
+				{
+					builder.ReadTexture(depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+					builder.WriteStorage(hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+				},
+				[this, depth](const RenderGraphPassContext& context)
+				{
+					BuildHiZ(context.CommandBuffer, m_RenderGraph->GetDepthImageView(depth));
+				});
+		}
+		else
+		{
+			m_HiZValid = false;
+		}
+	}
+
+	void Renderer::AddUIPass()
+	{
+		RenderGraphResource color = m_RenderGraph->ImportImage("Color", m_ColorImage);
+
+		// Draws into the swap chain's own render pass, which also handles the transition for presenting
+		m_RenderGraph->AddPass("UI", RenderGraphPassType::GRAPHICS,
+			[&](RenderGraphPassBuilder& builder)
+			{
+				builder.ReadTexture(color, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+				builder.SetSideEffect();
+			},
+			[this](const RenderGraphPassContext& context)
+			{
+				RenderUI(context.CommandBuffer);
+			});
+	}
+
+	void Renderer::RenderGeometry(const RenderGraphPassContext& context, bool parallel)
+	{
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
-		viewport.width = (float)extent.width;
-		viewport.height = (float)extent.height;
+		viewport.width = (float)context.Extent.width;
+		viewport.height = (float)context.Extent.height;
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
-		if (!framebuffer)
+		m_ActiveViewport = viewport;
+
+		if (m_DrawBatches.empty())
+			return;
+
+		if (parallel)
+		{
+			RecordParallel(context);
+		}
+		else
 		{
-			viewport.y = (float)extent.height;
-			viewport.height = -(float)extent.height;
+			vkCmdSetViewport(context.CommandBuffer, 0, 1, &viewport);
+			RecordBatches(context.CommandBuffer, 0, (uint32_t)m_DrawBatches.size(), m_Stats);
 		}
+	}
+
+	void Renderer::RecordParallel(const RenderGraphPassContext& context)
+	{
+		uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+		const uint32_t batchCount = (uint32_t)m_DrawBatches.size();
+
+		// Contiguous ranges of sorted batches, small lists are not worth waking up more threads for
+		uint32_t chunkCount = std::min((batchCount + s_MinBatchesPerChunk - 1) / s_MinBatchesPerChunk, JobSystem::GetThreadCount());
+		uint32_t batchesPerChunk = (batchCount + chunkCount - 1) / chunkCount;
+
+		// Rounding batchesPerChunk up can leave trailing chunks without any batches, those are dropped
+		chunkCount = (batchCount + batchesPerChunk - 1) / batchesPerChunk;
+
+		std::vector<VkCommandBuffer> commandBuffers(chunkCount);
+		std::vector<RendererStats> chunkStats(chunkCount);
+
+		JobSystem::ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			// Command pools can't be shared between threads, every thread records into its own
+			uint32_t threadIndex = JobSystem::GetThreadIndex();
+			ASSERT(threadIndex < m_SecondaryCommandPools[frameIndex].size(), "Command recording on a thread outside of the job system");
+
+			VkCommandBuffer commandBuffer = AcquireSecondaryCommandBuffer(m_SecondaryCommandPools[frameIndex][threadIndex]);
+
+			VkCommandBufferInheritanceInfo inheritanceInfo{};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.renderPass = context.RenderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = context.Framebuffer;
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
-		vkCmdSetViewport(m_ActiveCommandBuffer, 0, 1, &viewport);
-		vkCmdBeginRenderPass(m_ActiveCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			// Dynamic state is not inherited from the primary command buffer
+			vkCmdSetViewport(commandBuffer, 0, 1, &m_ActiveViewport);
+
+			uint32_t firstBatch = chunk * batchesPerChunk;
+			uint32_t chunkBatchCount = std::min(batchesPerChunk, batchCount - firstBatch);
+			RecordBatches(commandBuffer, firstBatch, chunkBatchCount, chunkStats[chunk]);
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+			commandBuffers[chunk] = commandBuffer;
+		});
+
+		vkCmdExecuteCommands(context.CommandBuffer, chunkCount, commandBuffers.data());
+
+		for (const RendererStats& stats : chunkStats)
+		{
+			m_Stats.DrawCalls += stats.DrawCalls;
+			m_Stats.IndirectCommands += stats.IndirectCommands;
+			m_Stats.PipelineBinds += stats.PipelineBinds;
+			m_Stats.DescriptorSetBinds += stats.DescriptorSetBinds;
+			m_Stats.VertexBufferBinds += stats.VertexBufferBinds;
+			m_Stats.IndexBufferBinds += stats.IndexBufferBinds;
+		}
+
+		m_Stats.RecordingChunks = chunkCount;
 	}
 
-	void Renderer::EndRenderPass()
+	void Renderer::RecordBatches(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats)
 	{
-		vkCmdEndRenderPass(m_ActiveCommandBuffer);
+		// Per-instance data for every batch lives in one allocation, batches select their range with firstInstance
+		VkBuffer instanceBuffer = m_InstanceRingBuffer->GetVulkanBuffer();
+		VkDeviceSize instanceOffset = m_InstanceBufferOffset;
+
+		if (m_CullingActive)
+		{
+			uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+			instanceBuffer = m_VisibleInstanceBuffers[frameIndex]->GetVulkanBuffer();
+			instanceOffset = 0;
+		}
+
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &instanceOffset);
+
+		// Every draw reads its texture by index, so the sets are bound once for the whole command buffer
+		if (m_BindlessActive)
+		{
+			VkPipelineLayout pipelineLayout = m_ActivePipeline->GetPipelineLayout();
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, m_DescriptorSets.size(), m_DescriptorSets.data(), m_DynamicOffsets.size(), m_DynamicOffsets.data());
+
+			BindlessPushConstants pushConstants = { m_MaterialBufferIndex, m_MaterialOffset };
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(BindlessPushConstants), &pushConstants);
+
+			stats.DescriptorSetBinds++;
+		}
+
+		if (m_CullingActive || (m_Settings.IndirectDraw && m_IndirectDrawSupported))
+			RecordIndirect(commandBuffer, firstBatch, batchCount, stats);
+		else
+			RecordDirect(commandBuffer, firstBatch, batchCount, stats);
 	}
 
-	void Renderer::SubmitMesh(Ref<Mesh> mesh, glm::mat4& transform)
+	void Renderer::RecordDirect(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats)
 	{
-		for (const SubMesh& subMesh : mesh->GetSubMeshes())
+		// Only emit binds when the state actually changes between consecutive batches
+		uint64_t boundState = UINT64_MAX;
+		VulkanPipeline* boundPipeline = nullptr;
+		VkBuffer boundVertexBuffer = nullptr;
+		VkBuffer boundIndexBuffer = nullptr;
+		VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+		for (uint32_t i = firstBatch; i < firstBatch + batchCount; i++)
 		{
-			m_DrawList.push_back({ subMesh, mesh->GetVertexBuffer(), mesh->GetIndexBuffer(), transform });
+			const DrawBatch& batch = m_DrawBatches[i];
+			const DrawCommand& command = m_DrawList[batch.CommandIndex];
+
+			// Material changes need no binds when textures are indexed. Pipelines are compared as well, different pipelines
+			// can share the key bits while one is replaced by its compiled version or once the sort IDs overflow.
+			uint64_t state = m_BindlessActive ? Utils::GetSortKeyPipeline(command.SortKey) : Utils::GetSortKeyState(command.SortKey);
+			if (state != boundState || command.Pipeline != boundPipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command.Pipeline->GetPipeline());
+				stats.PipelineBinds++;
+
+				if (!m_BindlessActive)
+				{
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command.Pipeline->GetPipelineLayout(), 0, m_DescriptorSets.size(), m_DescriptorSets.data(), m_DynamicOffsets.size(), m_DynamicOffsets.data());
+					stats.DescriptorSetBinds++;
+				}
+
+				boundState = state;
+				boundPipeline = command.Pipeline;
+			}
+
+			if (command.VertexBuffer != boundVertexBuffer)
+			{
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &command.VertexBuffer, &offset);
+
+				boundVertexBuffer = command.VertexBuffer;
+				stats.VertexBufferBinds++;
+			}
+
+			// 16- and 32-bit indices live in the same arena buffers, switching the type needs a bind as well
+			if (command.IndexBuffer != boundIndexBuffer || command.SubMesh.IndexType != boundIndexType)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, command.IndexBuffer, 0, command.SubMesh.IndexType);
+
+				boundIndexBuffer = command.IndexBuffer;
+				boundIndexType = command.SubMesh.IndexType;
+				stats.IndexBufferBinds++;
+			}
+
+			vkCmdDrawIndexed(commandBuffer, command.SubMesh.IndexCount, batch.InstanceCount, command.SubMesh.IndexOffset, command.SubMesh.VertexOffset, batch.FirstInstance);
+			stats.DrawCalls++;
 		}
 	}
 
-	void Renderer::Render()
+	void Renderer::RecordIndirect(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats)
 	{
-		Ref<VulkanSwapChain> swapChain = Application::GetApp().GetVulkanSwapChain();
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		const uint32_t lastBatch = firstBatch + batchCount;
+
+		VkBuffer indirectBuffer = m_IndirectRingBuffer->GetVulkanBuffer();
+
+		// Batches that share state and geometry buffers are issued with a single multi-draw, with bindless descriptors that includes batches with different materials
+		auto getState = m_BindlessActive ? Utils::GetSortKeyPipeline : Utils::GetSortKeyState;
+
+		// Runs split on geometry and meshlet batches as well, so consecutive runs often keep the same pipeline and state.
+		// Geometry of all meshes lives in a few arena buffers, consecutive runs usually keep them bound.
+		uint64_t boundState = UINT64_MAX;
+		VkPipeline boundPipeline = nullptr;
+		VkBuffer boundVertexBuffer = nullptr;
+		VkBuffer boundIndexBuffer = nullptr;
+		VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+		uint32_t runStart = firstBatch;
+		while (runStart < lastBatch)
+		{
+			const DrawBatch& runBatch = m_DrawBatches[runStart];
+			const DrawCommand& first = m_DrawList[runBatch.CommandIndex];
+
+			// Meshlet batches draw from their own command range, so they always end a run
+			uint32_t runEnd = runStart + 1;
+			while (runEnd < lastBatch && runBatch.MeshletBatch == UINT32_MAX)
+			{
+				const DrawBatch& nextBatch = m_DrawBatches[runEnd];
+				const DrawCommand& next = m_DrawList[nextBatch.CommandIndex];
+				if (nextBatch.MeshletBatch != UINT32_MAX || getState(next.SortKey) != getState(first.SortKey) || next.Pipeline != first.Pipeline || next.VertexBuffer != first.VertexBuffer || next.IndexBuffer != first.IndexBuffer || next.SubMesh.IndexType != first.SubMesh.IndexType)
+					break;
+
+				runEnd++;
+			}
+
+			uint64_t state = getState(first.SortKey);
+			VkPipeline pipeline = first.Pipeline->GetPipeline();
+			if (pipeline != boundPipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				stats.PipelineBinds++;
+			}
+
+			if (!m_BindlessActive && (state != boundState || pipeline != boundPipeline))
+			{
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, first.Pipeline->GetPipelineLayout(), 0, m_DescriptorSets.size(), m_DescriptorSets.data(), m_DynamicOffsets.size(), m_DynamicOffsets.data());
+				stats.DescriptorSetBinds++;
+			}
+
+			boundState = state;
+			boundPipeline = pipeline;
+
+			if (first.VertexBuffer != boundVertexBuffer)
+			{
+				VkDeviceSize vertexOffset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &first.VertexBuffer, &vertexOffset);
+
+				boundVertexBuffer = first.VertexBuffer;
+				stats.VertexBufferBinds++;
+			}
+
+			if (first.IndexBuffer != boundIndexBuffer || first.SubMesh.IndexType != boundIndexType)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, first.IndexBuffer, 0, first.SubMesh.IndexType);
+
+				boundIndexBuffer = first.IndexBuffer;
+				boundIndexType = first.SubMesh.IndexType;
+				stats.IndexBufferBinds++;
+			}
+
+			if (runBatch.MeshletBatch != UINT32_MAX)
+			{
+				// Surviving meshlets of every visible instance, counted by the meshlet pass
+				const MeshletBatch& meshletBatch = m_MeshletBatches[runBatch.MeshletBatch];
+				uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+
+				VkDeviceSize drawOffset = (VkDeviceSize)meshletBatch.FirstDraw * stride;
+				VkDeviceSize countOffset = m_MeshletCountOffset + (VkDeviceSize)runBatch.MeshletBatch * sizeof(uint32_t);
+				uint32_t maxDrawCount = runBatch.InstanceCount * meshletBatch.MeshletCount;
+				vkCmdDrawIndexedIndirectCount(commandBuffer, m_MeshletDrawBuffers[frameIndex]->GetVulkanBuffer(), drawOffset, indirectBuffer, countOffset, maxDrawCount, stride);
+
+				stats.DrawCalls++;
+				runStart = runEnd;
+				continue;
+			}
+
+			uint32_t drawCount = runEnd - runStart;
+			VkDeviceSize commandOffset = m_IndirectCommandOffset + (VkDeviceSize)runStart * stride;
+
+			if (m_IndirectCountSupported)
+			{
+				// The count is known on the CPU here, but reading it from a buffer lets GPU culling write it later.
+				// Every run owns the count slot of its first batch so chunks recorded in parallel never share one.
+				m_IndirectCounts[runStart] = drawCount;
+				VkDeviceSize countOffset = m_IndirectCountOffset + (VkDeviceSize)runStart * sizeof(uint32_t);
+				vkCmdDrawIndexedIndirectCount(commandBuffer, indirectBuffer, commandOffset, indirectBuffer, countOffset, drawCount, stride);
+			}
+			else if (m_MultiDrawIndirectSupported)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, commandOffset, drawCount, stride);
+			}
+			else
+			{
+				// Without multiDrawIndirect every indirect draw is limited to a single command
+				for (uint32_t i = 0; i < drawCount; i++)
+				{
+					vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, commandOffset + (VkDeviceSize)i * stride, 1, stride);
+				}
+			}
 
-		vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline->GetPipeline());
+			stats.DrawCalls += m_MultiDrawIndirectSupported ? 1 : drawCount;
+			stats.IndirectCommands += drawCount;
+			runStart = runEnd;
+		}
+	}
+
+	void Renderer::CullDrawList()
+	{
+		Frustum frustum = Frustum::FromViewProjection(m_CameraBuffer.ViewProjection);
+
+		m_CullingBounds.Clear();
+		m_CullingBounds.Reserve((uint32_t)m_DrawList.size());
 		for (const DrawCommand& command : m_DrawList)
 		{
-			VkDeviceSize offset = 0;
-			VkBuffer vertexBuffer = command.VertexBuffer->GetVulkanBuffer();
-			vkCmdBindVertexBuffers(m_ActiveCommandBuffer, 0, 1, &vertexBuffer, &offset);
-			vkCmdBindIndexBuffer(m_ActiveCommandBuffer, command.IndexBuffer->GetVulkanBuffer(), 0, VK_INDEX_TYPE_UINT16);
+			m_CullingBounds.Add(command.SubMesh.BoundsMin, command.SubMesh.BoundsMax, command.Transform);
+		}
 
-			vkCmdPushConstants(m_ActiveCommandBuffer, m_Pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &command.Transform);
-			vkCmdBindDescriptorSets(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline->GetPipelineLayout(), 0, m_DescriptorSets.size(), m_DescriptorSets.data(), 0, nullptr);
+		Culling::CullFrustum(frustum, m_CullingBounds, m_VisibleDraws);
 
-			vkCmdDrawIndexed(m_ActiveCommandBuffer, command.SubMesh.IndexCount, 1, command.SubMesh.IndexOffset, command.SubMesh.VertexOffset, 0);
+		// Visible indices are in ascending order so the draw list can be compacted in place
+		for (uint32_t i = 0; i < m_VisibleDraws.size(); i++)
+		{
+			if (m_VisibleDraws[i] != i)
+				m_DrawList[i] = std::move(m_DrawList[m_VisibleDraws[i]]);
 		}
+
+		m_Stats.CPUCulledDraws = (uint32_t)(m_DrawList.size() - m_VisibleDraws.size());
+		m_DrawList.resize(m_VisibleDraws.size());
 	}
 
-	void Renderer::RenderUI()
+	void Renderer::WriteIndirectCommands()
 	{
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_ActiveCommandBuffer);
+		const uint32_t batchCount = (uint32_t)m_DrawBatches.size();
+
+		// One indirect command per batch, written in sorted order
+		RingAllocation commandAllocation = m_IndirectRingBuffer->Allocate(batchCount * sizeof(VkDrawIndexedIndirectCommand));
+		VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(commandAllocation.Data);
+		m_IndirectCommandOffset = commandAllocation.Offset;
+
+		for (uint32_t i = 0; i < batchCount; i++)
+		{
+			const DrawBatch& batch = m_DrawBatches[i];
+			const DrawCommand& command = m_DrawList[batch.CommandIndex];
+
+			// With culling the instance count starts at zero and the cull shader increments it for every visible instance
+			commands[i].indexCount = command.SubMesh.IndexCount;
+			commands[i].instanceCount = m_CullingActive ? 0 : batch.InstanceCount;
+			commands[i].firstIndex = command.SubMesh.IndexOffset;
+			commands[i].vertexOffset = command.SubMesh.VertexOffset;
+			commands[i].firstInstance = batch.FirstInstance;
+		}
+
+		// One count slot per batch, filled in while recording
+		if (m_IndirectCountSupported)
+		{
+			RingAllocation countAllocation = m_IndirectRingBuffer->Allocate(batchCount * sizeof(uint32_t));
+			m_IndirectCounts = static_cast<uint32_t*>(countAllocation.Data);
+			m_IndirectCountOffset = countAllocation.Offset;
+		}
 	}
 
-	void Renderer::OnImGuiRender()
+	void Renderer::WriteMeshletBatches()
 	{
+		m_MeshletBatches.clear();
+		m_MeshletDrawCount = 0;
+		m_MeshletInstanceCount = 0;
+		uint32_t maxMeshletCount = 0;
+
+		if (m_MeshletCullingActive)
+		{
+			for (uint32_t i = 0; i < m_DrawBatches.size(); i++)
+			{
+				DrawBatch& batch = m_DrawBatches[i];
+				const DrawCommand& command = m_DrawList[batch.CommandIndex];
+				const SubMesh& subMesh = command.SubMesh;
+
+				// A single meshlet is already covered by the instance test
+				uint32_t drawCount = batch.InstanceCount * subMesh.MeshletCount;
+				if (command.MeshletBuffer == BindlessInvalidIndex || subMesh.MeshletCount < 2
+					|| m_MeshletInstanceCount + batch.InstanceCount > s_MaxMeshletInstances || m_MeshletDrawCount + drawCount > s_MaxMeshletDraws)
+					continue;
+
+				batch.MeshletBatch = (uint32_t)m_MeshletBatches.size();
+
+				MeshletBatch& meshletBatch = m_MeshletBatches.emplace_back();
+				meshletBatch.MeshletBuffer = command.MeshletBuffer;
+				meshletBatch.MeshletOffset = subMesh.MeshletOffset;
+				meshletBatch.MeshletCount = subMesh.MeshletCount;
+				meshletBatch.FirstIndex = subMesh.IndexOffset;
+				meshletBatch.VertexOffset = (int32_t)subMesh.VertexOffset;
+				meshletBatch.FirstDraw = m_MeshletDrawCount;
+				meshletBatch.ConeCulling = (command.Pipeline->GetSpecification().CullMode & VK_CULL_MODE_BACK_BIT) != 0;
+				meshletBatch.Padding = 0;
+
+				m_MeshletDrawCount += drawCount;
+				m_MeshletInstanceCount += batch.InstanceCount;
+				maxMeshletCount = std::max(maxMeshletCount, subMesh.MeshletCount);
+			}
+
+			m_MeshletCullingActive = !m_MeshletBatches.empty();
+		}
+
+		// The cull shader counts visible instances of meshlet batches into the Y dimension, it is bound even without meshlet batches
+		RingAllocation dispatchAllocation = m_IndirectRingBuffer->Allocate(sizeof(VkDispatchIndirectCommand));
+		VkDispatchIndirectCommand* dispatch = static_cast<VkDispatchIndirectCommand*>(dispatchAllocation.Data);
+		dispatch->x = (maxMeshletCount + s_MeshletCullGroupSize - 1) / s_MeshletCullGroupSize;
+		dispatch->y = 0;
+		dispatch->z = 1;
+		m_MeshletDispatchOffset = dispatchAllocation.Offset;
+
+		if (m_MeshletCullingActive)
+		{
+			RingAllocation countAllocation = m_IndirectRingBuffer->Allocate((uint32_t)(m_MeshletBatches.size() * sizeof(uint32_t)));
+			memset(countAllocation.Data, 0, m_MeshletBatches.size() * sizeof(uint32_t));
+			m_MeshletCountOffset = countAllocation.Offset;
+		}
+
+		m_Stats.MeshletBatches = (uint32_t)m_MeshletBatches.size();
+		m_Stats.MeshletInstances = m_MeshletInstanceCount;
+		m_Stats.Meshlets = m_MeshletDrawCount;
 	}
 
-	void Renderer::CreateDescriptorPools()
+	void Renderer::ResizeCullBuffers()
 	{
-		Ref<VulkanSwapChain> swapChain = Application::GetApp().GetVulkanSwapChain();
-		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+
+		Utils::EnsureBufferCapacity(m_VisibleInstanceBuffers[frameIndex], m_VisibleInstanceCapacities[frameIndex], (uint32_t)m_SortedIndices.size(),
+			sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		Utils::EnsureBufferCapacity(m_MeshletInstanceBuffers[frameIndex], m_MeshletInstanceCapacities[frameIndex], m_MeshletInstanceCount,
+			sizeof(glm::uvec2), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+		if (m_MeshletCullingActive)
+		{
+			Utils::EnsureBufferCapacity(m_MeshletDrawBuffers[frameIndex], m_MeshletDrawCapacities[frameIndex], m_MeshletDrawCount,
+				sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		}
+	}
+
+	void Renderer::DispatchCulling(VkCommandBuffer commandBuffer)
+	{
+		uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+		const uint32_t instanceCount = (uint32_t)m_SortedIndices.size();
 
-		// Create descriptor pool for each frame in flight
-		m_DescriptorPools.resize(swapChain->GetFramesInFlight());
+		// Cull input in sorted order, each instance knows which batch and indirect command it belongs to
+		RingAllocation instanceAllocation = m_CullRingBuffer->Allocate(instanceCount * sizeof(CullInstance));
+		CullInstance* cullInstances = static_cast<CullInstance*>(instanceAllocation.Data);
 
-		// Define max number of each descriptor for each descriptor set
-		VkDescriptorPoolSize poolSizes[] =
+		for (uint32_t batchIndex = 0; batchIndex < m_DrawBatches.size(); batchIndex++)
 		{
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10 }
-		};
+			const DrawBatch& batch = m_DrawBatches[batchIndex];
+			const SubMesh& subMesh = m_DrawList[batch.CommandIndex].SubMesh;
+
+			for (uint32_t i = batch.FirstInstance; i < batch.FirstInstance + batch.InstanceCount; i++)
+			{
+				cullInstances[i].Transform = m_DrawList[m_SortedIndices[i]].Transform;
+				cullInstances[i].BoundsMin = glm::vec4(subMesh.BoundsMin, 1.0f);
+				cullInstances[i].BoundsMax = glm::vec4(subMesh.BoundsMax, 1.0f);
+				cullInstances[i].BatchIndex = batchIndex;
+				cullInstances[i].MeshletBatch = batch.MeshletBatch;
+			}
+		}
+
+		// Last frame's view is needed to project into the Hi-Z pyramid that was built from last frame's depth
+		const ImageSpecification& hizSpecification = m_HiZImage->GetSpecification();
 
-		// Create descriptor pool
-		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
-		descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolCreateInfo.flags = 0;
-		descriptorPoolCreateInfo.maxSets = 1000;
-		descriptorPoolCreateInfo.poolSizeCount = 2;
-		descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+		Frustum frustum = Frustum::FromViewProjection(m_CameraBuffer.ViewProjection);
 
-		for (auto& descriptorPool : m_DescriptorPools)
+		CullBuffer cullBuffer;
+		cullBuffer.ViewProjection = m_CameraBuffer.ViewProjection;
+		cullBuffer.PreviousViewProjection = m_PreviousViewProjection;
+		memcpy(cullBuffer.FrustumPlanes, frustum.Planes, sizeof(frustum.Planes));
+		cullBuffer.CameraPosition = glm::vec4(m_CameraPosition, 1.0f);
+		cullBuffer.DepthSize = glm::vec4((float)m_ViewportWidth, (float)m_ViewportHeight, (float)hizSpecification.MipLevels, 0.0f);
+		cullBuffer.InstanceCount = instanceCount;
+		cullBuffer.OcclusionEnabled = m_Settings.OcclusionCulling && m_HiZValid;
+
+		// Pushed once and read by the meshlet pass as well
+		m_CullBufferOffset = m_UniformRingBuffer->Push(cullBuffer);
+
+		// Binding points match cull.shader. Ring buffer slices are bound at offset 0 and moved with dynamic offsets,
+		// together with whole size ranges this keeps the writes identical every frame so the cached set is reused.
+		VkDescriptorBufferInfo cullBufferInfo = m_UniformRingBuffer->GetDescriptorBufferInfo(sizeof(CullBuffer));
+		VkDescriptorBufferInfo instanceBufferInfo = { m_CullRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo commandBufferInfo = { m_IndirectRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo visibleBufferInfo = { m_VisibleInstanceBuffers[frameIndex]->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo dispatchBufferInfo = { m_IndirectRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo meshletInstanceBufferInfo = { m_MeshletInstanceBuffers[frameIndex]->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+
+		VkDescriptorImageInfo hizImageInfo = m_HiZImage->GetDescriptorImageInfo();
+		hizImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writeDescriptors[7] = {};
+		for (uint32_t i = 0; i < 7; i++)
 		{
-			VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &descriptorPool));
+			writeDescriptors[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptors[i].dstBinding = i;
+			writeDescriptors[i].descriptorCount = 1;
+			writeDescriptors[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		}
+
+		writeDescriptors[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		writeDescriptors[0].pBufferInfo = &cullBufferInfo;
+		writeDescriptors[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeDescriptors[1].pBufferInfo = &instanceBufferInfo;
+		writeDescriptors[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeDescriptors[2].pBufferInfo = &commandBufferInfo;
+		writeDescriptors[3].pBufferInfo = &visibleBufferInfo;
+		writeDescriptors[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writeDescriptors[4].pImageInfo = &hizImageInfo;
+		writeDescriptors[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeDescriptors[5].pBufferInfo = &dispatchBufferInfo;
+		writeDescriptors[6].pBufferInfo = &meshletInstanceBufferInfo;
+
+		VkDescriptorSet descriptorSet = m_DescriptorCache->GetDescriptorSet(m_CullShader->GetDescriptorSetLayouts()[0], writeDescriptors, 7);
+
+		// Dynamic offsets are consumed in binding order
+		uint32_t dynamicOffsets[] = { m_CullBufferOffset, instanceAllocation.Offset, m_IndirectCommandOffset, m_MeshletDispatchOffset };
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline->GetPipeline());
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 4, dynamicOffsets);
+		vkCmdDispatch(commandBuffer, (instanceCount + s_CullGroupSize - 1) / s_CullGroupSize, 1, 1);
 	}
 
-	std::vector<VkDescriptorSet> Renderer::AllocateDescriptorSets(const std::vector<VkDescriptorSetLayout>& layouts)
+	void Renderer::DispatchMeshletCulling(VkCommandBuffer commandBuffer)
+	{
+		uint32_t frameIndex = Application::GetApp().GetVulkanSwapChain()->GetCurrentBufferIndex();
+
+		RingAllocation batchAllocation = m_CullRingBuffer->Allocate((uint32_t)(m_MeshletBatches.size() * sizeof(MeshletBatch)));
+		memcpy(batchAllocation.Data, m_MeshletBatches.data(), m_MeshletBatches.size() * sizeof(MeshletBatch));
+
+		// Binding points match meshlet_cull.shader, the meshlets themselves are read through the bindless set.
+		// Bound the same way as in DispatchCulling so the cached set is reused across frames.
+		VkDescriptorBufferInfo cullBufferInfo = m_UniformRingBuffer->GetDescriptorBufferInfo(sizeof(CullBuffer));
+		VkDescriptorBufferInfo batchBufferInfo = { m_CullRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo meshletInstanceBufferInfo = { m_MeshletInstanceBuffers[frameIndex]->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo visibleBufferInfo = { m_VisibleInstanceBuffers[frameIndex]->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo drawBufferInfo = { m_MeshletDrawBuffers[frameIndex]->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo countBufferInfo = { m_IndirectRingBuffer->GetVulkanBuffer(), 0, VK_WHOLE_SIZE };
+
+		VkDescriptorImageInfo hizImageInfo = m_HiZImage->GetDescriptorImageInfo();
+		hizImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writeDescriptors[7] = {};
+		for (uint32_t i = 0; i < 7; i++)
+		{
+			writeDescriptors[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptors[i].dstBinding = i;
+			writeDescriptors[i].descriptorCount = 1;
+			writeDescriptors[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+
+		writeDescriptors[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		writeDescriptors[0].pBufferInfo = &cullBufferInfo;
+		writeDescriptors[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeDescriptors[1].pBufferInfo = &batchBufferInfo;
+		writeDescriptors[2].pBufferInfo = &meshletInstanceBufferInfo;
+		writeDescriptors[3].pBufferInfo = &visibleBufferInfo;
+		writeDescriptors[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writeDescriptors[4].pImageInfo = &hizImageInfo;
+		writeDescriptors[5].pBufferInfo = &drawBufferInfo;
+		writeDescriptors[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+		writeDescriptors[6].pBufferInfo = &countBufferInfo;
+
+		VkDescriptorSet descriptorSets[2];
+		descriptorSets[0] = m_DescriptorCache->GetDescriptorSet(m_MeshletCullShader->GetDescriptorSetLayouts()[0], writeDescriptors, 7);
+		descriptorSets[BindlessDescriptors::SetIndex] = BindlessDescriptors::GetDescriptorSet();
+
+		uint32_t dynamicOffsets[] = { m_CullBufferOffset, batchAllocation.Offset, m_MeshletCountOffset };
+
+		// The cull pass wrote the number of visible instances into the Y dimension
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_MeshletCullPipeline->GetPipeline());
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_MeshletCullPipeline->GetPipelineLayout(), 0, 2, descriptorSets, 3, dynamicOffsets);
+		vkCmdDispatchIndirect(commandBuffer, m_IndirectRingBuffer->GetVulkanBuffer(), m_MeshletDispatchOffset);
+	}
+
+	void Renderer::CreateHiZ()
+	{
+		// Mip 0 is half the depth resolution, every texel holds the farthest depth of the pixels it covers
+		uint32_t width = (m_ViewportWidth + 1) / 2;
+		uint32_t height = (m_ViewportHeight + 1) / 2;
+
+		ImageSpecification imageSpecification = {};
+		imageSpecification.Data = nullptr;
+		imageSpecification.Width = width;
+		imageSpecification.Height = height;
+		imageSpecification.Format = VK_FORMAT_R32_SFLOAT;
+		imageSpecification.MipLevels = (uint32_t)std::floor(std::log2((float)std::max(width, height))) + 1;
+		imageSpecification.Usage = VK_IMAGE_USAGE_STORAGE_BIT;
+		imageSpecification.UseStagingBuffer = false;
+		// The pyramid stays in the general layout, the render graph moves it there the first time it is used
+		m_HiZImage = CreateRef<VulkanImage>(imageSpecification);
+	}
+
+	void Renderer::BuildHiZ(VkCommandBuffer commandBuffer, VkImageView depthImageView)
+	{
+		const ImageSpecification& hizSpecification = m_HiZImage->GetSpecification();
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_HiZPipeline->GetPipeline());
+
+		// Only texelFetch is used, so any sampler works for the depth attachment
+		VkSampler sampler = m_HiZImage->GetDescriptorImageInfo().sampler;
+
+		for (uint32_t mip = 0; mip < hizSpecification.MipLevels; mip++)
+		{
+			// Mip 0 reduces the depth attachment, every other mip reduces the one above it
+			VkDescriptorImageInfo sourceInfo = {};
+			sourceInfo.sampler = sampler;
+			if (mip == 0)
+			{
+				sourceInfo.imageView = depthImageView;
+				sourceInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			}
+			else
+			{
+				sourceInfo.imageView = m_HiZImage->GetMipImageView(mip - 1);
+				sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			}
+
+			VkDescriptorImageInfo destinationInfo = {};
+			destinationInfo.imageView = m_HiZImage->GetMipImageView(mip);
+			destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkWriteDescriptorSet writeDescriptors[2] = {};
+			writeDescriptors[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptors[0].dstBinding = 0;
+			writeDescriptors[0].descriptorCount = 1;
+			writeDescriptors[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writeDescriptors[0].pImageInfo = &sourceInfo;
+
+			writeDescriptors[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptors[1].dstBinding = 1;
+			writeDescriptors[1].descriptorCount = 1;
+			writeDescriptors[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writeDescriptors[1].pImageInfo = &destinationInfo;
+
+			// The views only change when the graph recreates the depth image, so after the first frame every mip is a cache hit
+			VkDescriptorSet descriptorSet = m_DescriptorCache->GetDescriptorSet(m_HiZShader->GetDescriptorSetLayouts()[0], writeDescriptors, 2);
+
+			uint32_t mipWidth = std::max(hizSpecification.Width >> mip, 1u);
+			uint32_t mipHeight = std::max(hizSpecification.Height >> mip, 1u);
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_HiZPipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+			vkCmdDispatch(commandBuffer, (mipWidth + s_HiZGroupSize - 1) / s_HiZGroupSize, (mipHeight + s_HiZGroupSize - 1) / s_HiZGroupSize, 1);
+
+			// The next mip reads this one, the graph covers next frame's cull dispatch after the last mip
+			if (mip + 1 < hizSpecification.MipLevels)
+			{
+				VkMemoryBarrier memoryBarrier{};
+				memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			}
+		}
+
+		m_PreviousViewProjection = m_CameraBuffer.ViewProjection;
+		m_HiZValid = true;
+	}
+
+	void Renderer::BuildDrawBatches()
+	{
+		m_DrawBatches.clear();
+		if (m_DrawList.empty())
+			return;
+
+		// Sort draws by key so draws sharing state end up next to each other
+		m_SortKeys.resize(m_DrawList.size());
+		for (size_t i = 0; i < m_DrawList.size(); i++)
+		{
+			m_SortKeys[i] = m_DrawList[i].SortKey;
+		}
+
+		RadixSort(m_SortKeys.data(), (uint32_t)m_SortKeys.size(), m_SortedIndices, m_SortScratch);
+
+		// Write instance data in sorted order so every batch is a contiguous range
+		RingAllocation allocation = m_InstanceRingBuffer->Allocate((uint32_t)(m_DrawList.size() * sizeof(InstanceData)));
+		InstanceData* instanceData = static_cast<InstanceData*>(allocation.Data);
+		m_InstanceBufferOffset = allocation.Offset;
+
+		// Material indices share the slot layout of the instance data, the shader addresses them with gl_InstanceIndex
+		uint32_t* materialIndices = nullptr;
+		if (m_BindlessActive)
+		{
+			RingAllocation materialAllocation = m_MaterialRingBuffer->Allocate((uint32_t)(m_DrawList.size() * sizeof(uint32_t)));
+			materialIndices = static_cast<uint32_t*>(materialAllocation.Data);
+			m_MaterialOffset = materialAllocation.Offset / sizeof(uint32_t);
+		}
+
+		for (uint32_t i = 0; i < m_SortedIndices.size(); i++)
+		{
+			const DrawCommand& command = m_DrawList[m_SortedIndices[i]];
+			instanceData[i].Transform = command.Transform;
+
+			if (materialIndices)
+				materialIndices[i] = command.MaterialIndex;
+
+			// Draws of the same submesh with the same state differ only by depth and get merged into one instanced draw
+			if (!m_DrawBatches.empty())
+			{
+				DrawBatch& batch = m_DrawBatches.back();
+				const DrawCommand& batchCommand = m_DrawList[batch.CommandIndex];
+
+				if (Utils::CanInstance(batchCommand, command))
+				{
+					batch.InstanceCount++;
+					continue;
+				}
+			}
+
+			DrawBatch& batch = m_DrawBatches.emplace_back();
+			batch.CommandIndex = m_SortedIndices[i];
+			batch.FirstInstance = i;
+			batch.InstanceCount = 1;
+		}
+
+		m_Stats.Instances = (uint32_t)m_DrawList.size();
+	}
+
+	void Renderer::RenderUI(VkCommandBuffer commandBuffer)
 	{
 		Ref<VulkanSwapChain> swapChain = Application::GetApp().GetVulkanSwapChain();
-		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
-		uint32_t frameIndex = swapChain->GetCurrentBufferIndex();
 
-		// Allocate descriptor sets from descriptor pool for current frame given the layout info
-		VkDescriptorSetAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorSetCount = layouts.size();
-		allocInfo.pSetLayouts = layouts.data();
-		allocInfo.descriptorPool = m_DescriptorPools[frameIndex];
+		VkClearValue clearColor;
+		clearColor.color = { 0.1f, 0.1f, 0.1f, 1.0f };
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = swapChain->GetRenderPass();
+		renderPassInfo.framebuffer = swapChain->GetCurrentFramebuffer();
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = swapChain->GetExtent();
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	void Renderer::OnImGuiRender()
+	{
+		ImGui::Begin("Renderer");
+
+		ImGui::Checkbox("CPU culling", &m_Settings.CPUCulling);
+
+		if (m_IndirectDrawSupported)
+		{
+			ImGui::Checkbox("Indirect draw", &m_Settings.IndirectDraw);
+			ImGui::Checkbox("GPU culling", &m_Settings.GPUCulling);
+			ImGui::Checkbox("Occlusion culling", &m_Settings.OcclusionCulling);
+
+			if (m_MeshletCullPipeline)
+				ImGui::Checkbox("Meshlet culling", &m_Settings.MeshletCulling);
+			else
+				ImGui::TextDisabled("Meshlet culling requires descriptor indexing and drawIndirectCount");
+		}
+		else
+		{
+			ImGui::TextDisabled("Indirect draw not supported");
+		}
+
+		ImGui::Checkbox("Levels of detail", &m_Settings.LOD);
+		if (m_Settings.LOD)
+		{
+			ImGui::SliderFloat("LOD error (pixels)", &m_Settings.LODErrorThreshold, 0.1f, 16.0f, "%.1f");
+			ImGui::SliderFloat("LOD hysteresis", &m_Settings.LODHysteresis, 0.0f, 0.9f, "%.2f");
+		}
+
+		ImGui::Checkbox("Parallel recording", &m_Settings.ParallelRecording);
+
+		if (m_BindlessSupported)
+			ImGui::Checkbox("Bindless descriptors", &m_Settings.Bindless);
+		else
+			ImGui::TextDisabled("Descriptor indexing not supported");
+
+		ImGui::Checkbox("Fallback for pending pipelines", &m_Settings.FallbackPipeline);
+		ImGui::Checkbox("Defragment geometry", &m_Settings.DefragmentGeometry);
+
+		ImGui::Separator();
+
+		ImGui::Text("Draw calls: %u", m_Stats.DrawCalls);
+		ImGui::Text("Indirect commands: %u", m_Stats.IndirectCommands);
+		ImGui::Text("Instances: %u", m_Stats.Instances);
+		ImGui::Text("CPU culled draws: %u", m_Stats.CPUCulledDraws);
+		ImGui::Text("Triangles: %u", m_Stats.Triangles);
+		ImGui::Text("Transform updates: %u (%s)", m_Stats.TransformUpdates, TransformHierarchy::GetInstructionSet());
+
+		ImGui::Text("Draws per LOD:");
+		for (uint32_t i = 0; i < MeshMaxLODs; i++)
+		{
+			ImGui::SameLine();
+			ImGui::Text("%u", m_Stats.LODDraws[i]);
+		}
+
+		ImGui::Text("Meshlet batches: %u (%u instances, up to %u meshlets)", m_Stats.MeshletBatches, m_Stats.MeshletInstances, m_Stats.Meshlets);
+		ImGui::Text("Pipeline binds: %u", m_Stats.PipelineBinds);
+		ImGui::Text("Descriptor set binds: %u", m_Stats.DescriptorSetBinds);
+		ImGui::Text("Vertex buffer binds: %u", m_Stats.VertexBufferBinds);
+		ImGui::Text("Index buffer binds: %u", m_Stats.IndexBufferBinds);
+		ImGui::Text("Recording chunks: %u / %u threads", m_Stats.RecordingChunks, JobSystem::GetThreadCount());
+
+		const DescriptorCacheStats& descriptorStats = m_DescriptorCache->GetStats();
+		ImGui::Text("Descriptor sets: %u hits, %u misses, %u recycled", descriptorStats.Hits, descriptorStats.Misses, descriptorStats.Recycled);
+		ImGui::Text("Cached descriptor sets: %u in %u pools", descriptorStats.CachedSets, descriptorStats.Pools);
+
+		PipelineCacheStats pipelineStats = PipelineCache::GetStats();
+		ImGui::Text("Pipelines: %u (%u hits, %u misses)", pipelineStats.Pipelines, pipelineStats.Hits, pipelineStats.Misses);
+		ImGui::Text("Pending pipelines: %u (%u draws waiting)", pipelineStats.Pending, m_Stats.PendingPipelineDraws);
+		ImGui::Text("Pipeline cache loaded: %.1f KB", pipelineStats.LoadedSize / 1024.0f);
+
+		const GeometryArenaStats geometryStats = GeometryArena::GetStats();
+		const char* poolNames[] = { "Vertex", "Index" };
+		for (uint32_t i = 0; i < (uint32_t)GeometryPool::Count; i++)
+		{
+			const GeometryPoolStats& poolStats = geometryStats.Pools[i];
+			ImGui::Text("%s arena: %.2f / %.2f MB in %u buffers, %u ranges, %.2f MB in holes", poolNames[i], poolStats.UsedSize / (1024.0f * 1024.0f), poolStats.Capacity / (1024.0f * 1024.0f),
+				poolStats.BlockCount, poolStats.AllocationCount, poolStats.HoleSize / (1024.0f * 1024.0f));
+		}
+		ImGui::Text("Geometry moved: %u ranges, %.1f KB", geometryStats.MovedAllocations, geometryStats.MovedBytes / 1024.0f);
+
+		ImGui::Separator();
+
+		const RenderGraphStats& graphStats = m_RenderGraph->GetStats();
+		ImGui::Text("Render graph passes: %u (%u culled)", graphStats.Passes, graphStats.CulledPasses);
+		ImGui::Text("Barriers: %u (%u image, %u buffer)", graphStats.Barriers, graphStats.ImageBarriers, graphStats.BufferBarriers);
+		ImGui::Text("Transient images: %u, %.2f MB (%.2f MB aliased)", graphStats.TransientImages, graphStats.TransientMemory / (1024.0f * 1024.0f), graphStats.AliasedMemory / (1024.0f * 1024.0f));
+
+		ImGui::Separator();
 
-		std::vector<VkDescriptorSet> result;
-		result.resize(layouts.size());
+		if (ImGui::Button("Run culling benchmark"))
+			m_CullingBenchmarkResults = Culling::RunBenchmark();
 
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, result.data()));
-		return result;
+		for (const CullingBenchmarkResult& result : m_CullingBenchmarkResults)
+		{
+			ImGui::Text("%u boxes: scalar %.1fM/s, %s %.1fM/s", result.BoxCount, result.ScalarBoxesPerSecond / 1e6, Culling::GetInstructionSet(), result.SIMDBoxesPerSecond / 1e6);
+		}
+
+		ImGui::End();
 	}
 
-	VkDescriptorSet Renderer::AllocateDescriptorSet(VkDescriptorSetAllocateInfo allocInfo)
+	void Renderer::CreateSecondaryCommandPools()
 	{
+		Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
 		Ref<VulkanSwapChain> swapChain = Application::GetApp().GetVulkanSwapChain();
-		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
-		uint32_t frameIndex = swapChain->GetCurrentBufferIndex();
 
-		allocInfo.descriptorPool = s_Instance->m_DescriptorPools[frameIndex];
+		// One pool per recording thread per frame in flight, command pools can't be used from two threads at once
+		m_SecondaryCommandPools.resize(swapChain->GetFramesInFlight());
+		for (auto& framePools : m_SecondaryCommandPools)
+		{
+			framePools.resize(JobSystem::GetThreadCount());
+			for (SecondaryCommandPool& pool : framePools)
+			{
+				VkCommandPoolCreateInfo poolInfo = {};
+				poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				poolInfo.queueFamilyIndex = device->GetQueueIndices().GraphicsQueue.value();
+				poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+				VK_CHECK_RESULT(vkCreateCommandPool(device->GetLogicalDevice(), &poolInfo, nullptr, &pool.CommandPool));
+			}
+		}
+	}
+
+	VkCommandBuffer Renderer::AcquireSecondaryCommandBuffer(SecondaryCommandPool& pool)
+	{
+		// Command buffers are kept after the pool is reset and handed out again the next time this frame comes around
+		if (pool.UsedCount == pool.CommandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = pool.CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
 
-		VkDescriptorSet result;
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &result));
-		return result;
+			VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &allocInfo, &pool.CommandBuffers.emplace_back()));
+		}
+
+		return pool.CommandBuffers[pool.UsedCount++];
+	}
+
+	uint32_t Renderer::GetSortID(SortKeyField field, const void* resource)
+	{
+		// Small dense IDs that fit in the sort key field, reassigned every frame
+		auto& ids = m_SortIDs[(uint32_t)field];
+		auto it = ids.find(resource);
+		if (it != ids.end())
+			return it->second;
+
+		// Once a field runs out of IDs the remaining resources share the last one and are no longer sorted apart,
+		// batching still compares the pipeline, material and geometry of the commands themselves
+		uint32_t overflowID = (1u << s_SortKeyFieldBits[(uint32_t)field]) - 1;
+		uint32_t id = std::min((uint32_t)ids.size(), overflowID);
+		if (id == overflowID && !m_SortIDOverflowReported)
+		{
+			const char* fieldNames[] = { "pipeline", "material", "geometry" };
+			LOG_WARN("More than {0} {1} IDs in one frame, the rest share a sort key", overflowID, fieldNames[(uint32_t)field]);
+			m_SortIDOverflowReported = true;
+		}
+
+		ids.emplace(resource, id);
+		return id;
+	}
+
+	VkDescriptorSet Renderer::GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<VkWriteDescriptorSet>& writes)
+	{
+		return s_Instance->m_DescriptorCache->GetDescriptorSet(layout, writes);
 	}
 }
\ No newline at end of file
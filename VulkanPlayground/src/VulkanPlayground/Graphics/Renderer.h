@@ -1,10 +1,15 @@
 #pragma once
 #include "VulkanPlayground/Graphics/Camera.h"
-#include "VulkanPlayground/Graphics/VulkanFramebuffer.h"
+#include "VulkanPlayground/Graphics/RenderGraph.h"
+#include "VulkanPlayground/Graphics/VulkanDescriptorCache.h"
 #include "VulkanPlayground/Graphics/VulkanPipeline.h"
+#include "VulkanPlayground/Graphics/PipelineCache.h"
+#include "VulkanPlayground/Graphics/VulkanComputePipeline.h"
 #include "VulkanPlayground/Graphics/VulkanBuffers.h"
 #include "VulkanPlayground/Graphics/Shader.h"
 #include "VulkanPlayground/Graphics/Mesh.h"
+#include "VulkanPlayground/Graphics/Texture.h"
+#include "VulkanPlayground/Graphics/Culling.h"
 
 namespace VKPlayground {
 	
@@ -16,11 +21,170 @@ namespace VKPlayground {
 
 	struct DrawCommand
 	{
+		// Offsets are absolute within the geometry arena buffers, the index type is SubMesh.IndexType
 		SubMesh SubMesh;
-		Ref<VulkanVertexBuffer> VertexBuffer;
-		Ref<VulkanIndexBuffer> IndexBuffer;
+		VkBuffer VertexBuffer = nullptr;
+		VkBuffer IndexBuffer = nullptr;
 
 		glm::mat4 Transform;
+
+		// Owned by the pipeline cache, which keeps every pipeline alive until shutdown
+		VulkanPipeline* Pipeline = nullptr;
+
+		// Bindless index of the texture, only used when drawing with bindless descriptors
+		uint32_t MaterialIndex = 0;
+
+		// Bindless index of the mesh's meshlet buffer, BindlessInvalidIndex if it has none
+		uint32_t MeshletBuffer = BindlessInvalidIndex;
+
+		// Level of detail whose index range SubMesh was set to, 0 is full detail
+		uint32_t LOD = 0;
+
+		// | 63-56 pipeline | 55-44 material | 43-32 geometry | 31-20 submesh and LOD | 19-0 depth |
+		uint64_t SortKey = 0;
+	};
+
+	// Fields of DrawCommand::SortKey filled with IDs the renderer hands out per frame, each has its own range
+	enum class SortKeyField
+	{
+		Pipeline = 0,
+		Material,
+		Geometry,
+		Count
+	};
+
+	// Per-instance vertex attributes, read by a_Transform in the shader
+	struct InstanceData
+	{
+		glm::mat4 Transform;
+	};
+
+	// Matches PushConstants in bindless.shader, pushed once per command buffer
+	struct BindlessPushConstants
+	{
+		uint32_t MaterialBuffer;
+		uint32_t MaterialOffset;
+	};
+
+	// Per-instance input of the cull shader, matches CullInstance in cull.shader (std430)
+	struct CullInstance
+	{
+		glm::mat4 Transform;
+		glm::vec4 BoundsMin;
+		glm::vec4 BoundsMax;
+		uint32_t BatchIndex;
+
+		// Index into the frame's meshlet batches, UINT32_MAX if the batch is drawn as a whole
+		uint32_t MeshletBatch;
+		uint32_t Padding[2];
+	};
+
+	// Shared by cull.shader and meshlet_cull.shader
+	struct CullBuffer
+	{
+		glm::mat4 ViewProjection;
+		glm::mat4 PreviousViewProjection;
+		glm::vec4 FrustumPlanes[6];
+		glm::vec4 CameraPosition;
+		glm::vec4 DepthSize;
+		uint32_t InstanceCount;
+		uint32_t OcclusionEnabled;
+	};
+
+	// Batch whose visible instances are split into meshlets and culled again per meshlet, matches MeshletBatch in meshlet_cull.shader (std430)
+	struct MeshletBatch
+	{
+		uint32_t MeshletBuffer;
+		uint32_t MeshletOffset;
+		uint32_t MeshletCount;
+
+		// Submesh index range the meshlets' FirstIndex is relative to
+		uint32_t FirstIndex;
+		int32_t VertexOffset;
+
+		// First of the InstanceCount * MeshletCount draws the batch can emit in the meshlet draw buffer
+		uint32_t FirstDraw;
+
+		// Normal cones are only tested for pipelines that cull back faces
+		uint32_t ConeCulling;
+		uint32_t Padding;
+	};
+
+	static_assert(sizeof(MeshletBatch) == 32, "MeshletBatch has to match the std430 layout in meshlet_cull.shader");
+
+	// Consecutive draws in sorted order that were merged into one instanced draw
+	struct DrawBatch
+	{
+		uint32_t CommandIndex = 0;
+		uint32_t FirstInstance = 0;
+		uint32_t InstanceCount = 0;
+
+		// Index into the frame's meshlet batches, UINT32_MAX if the batch is drawn as a whole
+		uint32_t MeshletBatch = UINT32_MAX;
+	};
+
+	struct RendererSettings
+	{
+		// Issue batches from an indirect command buffer instead of one vkCmdDrawIndexed each
+		bool IndirectDraw = true;
+
+		// Drop draws outside the camera frustum on the CPU before sorting
+		bool CPUCulling = true;
+
+		// Reject instances outside the frustum or behind last frame's depth in a compute pass, requires indirect draw support
+		bool GPUCulling = true;
+		bool OcclusionCulling = true;
+
+		// Cull the meshlets of visible instances against the frustum, their normal cone and the Hi-Z pyramid before drawing them,
+		// requires GPU culling, bindless descriptors and drawIndirectCount
+		bool MeshletCulling = true;
+
+		// Draw the coarsest level of detail whose simplification error covers at most LODErrorThreshold pixels on screen.
+		// A draw only switches level once the error is LODHysteresis times the threshold past it, so it doesn't flicker at the boundary.
+		bool LOD = true;
+		float LODErrorThreshold = 1.0f;
+		float LODHysteresis = 0.25f;
+
+		// Record the main pass into secondary command buffers across job system workers
+		bool ParallelRecording = true;
+
+		// Bind one global descriptor array per command buffer and index textures by material, requires descriptor indexing
+		bool Bindless = true;
+
+		// Draw meshes whose pipeline is still compiling with the default pipeline, otherwise they are skipped until it is ready
+		bool FallbackPipeline = true;
+
+		// Move geometry arena ranges down into freed space a few megabytes per frame, so unloading meshes doesn't leave the buffers fragmented
+		bool DefragmentGeometry = true;
+	};
+
+	struct RendererStats
+	{
+		uint32_t DrawCalls = 0;
+		uint32_t IndirectCommands = 0;
+		uint32_t Instances = 0;
+		uint32_t CPUCulledDraws = 0;
+		uint32_t Triangles = 0;
+		uint32_t LODDraws[MeshMaxLODs] = {};
+		uint32_t MeshletBatches = 0;
+		uint32_t MeshletInstances = 0;
+		uint32_t Meshlets = 0;
+		uint32_t PipelineBinds = 0;
+		uint32_t DescriptorSetBinds = 0;
+		uint32_t VertexBufferBinds = 0;
+		uint32_t IndexBufferBinds = 0;
+		uint32_t RecordingChunks = 0;
+		uint32_t PendingPipelineDraws = 0;
+
+		// Mesh nodes whose world matrix was recomputed because they or a parent changed
+		uint32_t TransformUpdates = 0;
+	};
+
+	struct SecondaryCommandPool
+	{
+		VkCommandPool CommandPool = nullptr;
+		std::vector<VkCommandBuffer> CommandBuffers;
+		uint32_t UsedCount = 0;
 	};
 
 	class Renderer
@@ -36,37 +200,165 @@ namespace VKPlayground {
 		void BeginScene(Ref<Camera> camera);
 		void EndScene();
 
-		void BeginRenderPass(Ref<VulkanFramebuffer> framebuffer = nullptr);
-		void EndRenderPass();
+		void SubmitMesh(Ref<Mesh> mesh, glm::mat4& transform, Ref<Texture2D> texture = nullptr, Ref<AsyncPipeline> pipeline = nullptr);
 
-		void SubmitMesh(Ref<Mesh> mesh, glm::mat4& transform);
-		void Render();
-		void RenderUI();
+		// Starts compiling a main pass pipeline for the shader in the background, the shader has to declare the same
+		// descriptor sets and push constants as the default one. Until IsReady() meshes submitted with it use the fallback.
+		Ref<AsyncPipeline> LoadPipeline(const std::string& shaderPath);
 
 		void OnImGuiRender();
 
-		Ref<VulkanFramebuffer> GetFramebuffer() { return m_Framebuffer; }
+		// Layers can add their own passes between BeginFrame and EndFrame, the graph is executed in EndFrame
+		Ref<RenderGraph> GetRenderGraph() { return m_RenderGraph; }
+		Ref<VulkanImage> GetOutputImage() { return m_ColorImage; }
+		RendererSettings& GetSettings() { return m_Settings; }
 
-		static VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetAllocateInfo allocInfo);
+		// Cached set holding the written resources, allocated and written only the first time the combination is seen
+		static VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<VkWriteDescriptorSet>& writes);
 
 	private:
 		void Init();
-		void CreateDescriptorPools();
-		std::vector<VkDescriptorSet> AllocateDescriptorSets(const std::vector<VkDescriptorSetLayout>& layouts);
+		uint32_t GetSortID(SortKeyField field, const void* resource);
+		uint32_t SelectLOD(const Mesh& mesh, const SubMesh& subMesh, const glm::mat4& transform, uint64_t historyKey);
+		VulkanPipeline* GetPipelineVariant(VulkanPipeline* pipeline, const VertexFormat& vertexFormat);
+		void CreateHiZ();
+		void PrepareDraws();
+		void CullDrawList();
+		void BuildDrawBatches();
+		void WriteIndirectCommands();
+		void WriteMeshletBatches();
+		void ResizeCullBuffers();
+		void AddScenePasses();
+		void AddUIPass();
+		void DispatchCulling(VkCommandBuffer commandBuffer);
+		void DispatchMeshletCulling(VkCommandBuffer commandBuffer);
+		void BuildHiZ(VkCommandBuffer commandBuffer, VkImageView depthImageView);
+		void RenderGeometry(const RenderGraphPassContext& context, bool parallel);
+		void RenderUI(VkCommandBuffer commandBuffer);
+		void RecordParallel(const RenderGraphPassContext& context);
+		void RecordBatches(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats);
+		void RecordDirect(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats);
+		void RecordIndirect(VkCommandBuffer commandBuffer, uint32_t firstBatch, uint32_t batchCount, RendererStats& stats);
+		void CreateSecondaryCommandPools();
+		VkCommandBuffer AcquireSecondaryCommandBuffer(SecondaryCommandPool& pool);
 
 	private:
 		Ref<Camera> m_ActiveCamera;
 
 		CameraBuffer m_CameraBuffer;
+		glm::vec3 m_CameraPosition = glm::vec3(0.0f);
 		std::vector<DrawCommand> m_DrawList;
-		Ref<VulkanUniformBuffer> m_CameraUniformBuffer;
-		Ref<VulkanFramebuffer> m_Framebuffer;
+
+		// Pixels covered by one unit at distance one from the camera, set in BeginScene
+		float m_LODScale = 0.0f;
+
+		// Level picked for every submitted submesh last frame and this one, keyed by mesh, how often the mesh was already
+		// submitted in the frame and submesh. The scene has no persistent object IDs, so submission order stands in for them.
+		std::unordered_map<uint64_t, uint32_t> m_LODHistory;
+		std::unordered_map<uint64_t, uint32_t> m_NextLODHistory;
+		std::unordered_map<const Mesh*, uint32_t> m_MeshSubmitCounts;
+
+		std::vector<uint64_t> m_SortKeys;
+		std::vector<uint32_t> m_SortedIndices;
+		std::vector<uint32_t> m_SortScratch;
+		std::unordered_map<const void*, uint32_t> m_SortIDs[(uint32_t)SortKeyField::Count];
+		bool m_SortIDOverflowReported = false;
+		std::vector<DrawBatch> m_DrawBatches;
+
+		BoundingBoxSoA m_CullingBounds;
+		std::vector<uint32_t> m_VisibleDraws;
+		std::vector<CullingBenchmarkResult> m_CullingBenchmarkResults;
+
+		RendererStats m_Stats;
+
+		Ref<VulkanRingBuffer> m_UniformRingBuffer;
+		std::vector<uint32_t> m_DynamicOffsets;
+
+		Ref<VulkanRingBuffer> m_InstanceRingBuffer;
+		uint32_t m_InstanceBufferOffset = 0;
+
+		Ref<VulkanRingBuffer> m_IndirectRingBuffer;
+		uint32_t m_IndirectCommandOffset = 0;
+		uint32_t m_IndirectCountOffset = 0;
+		uint32_t* m_IndirectCounts = nullptr;
+		bool m_IndirectDrawSupported = false;
+		bool m_MultiDrawIndirectSupported = false;
+		bool m_IndirectCountSupported = false;
+
+		bool m_CullingActive = false;
+		bool m_MeshletCullingActive = false;
+
+		Ref<Shader> m_CullShader;
+		Ref<VulkanComputePipeline> m_CullPipeline;
+		Ref<VulkanRingBuffer> m_CullRingBuffer;
+		uint32_t m_CullBufferOffset = 0;
+
+		// Culled instance data written by the cull shader, one buffer per frame in flight
+		std::vector<Ref<VulkanBuffer>> m_VisibleInstanceBuffers;
+		std::vector<uint32_t> m_VisibleInstanceCapacities;
+
+		// Only created when the device supports meshlet culling
+		Ref<Shader> m_MeshletCullShader;
+		Ref<VulkanComputePipeline> m_MeshletCullPipeline;
+
+		// Written by WriteMeshletBatches, the indirect ring holds a draw count per batch and the meshlet pass's dispatch size
+		std::vector<MeshletBatch> m_MeshletBatches;
+		uint32_t m_MeshletDrawCount = 0;
+		uint32_t m_MeshletInstanceCount = 0;
+		uint32_t m_MeshletCountOffset = 0;
+		uint32_t m_MeshletDispatchOffset = 0;
+
+		// Visible instances of meshlet batches appended by the cull shader and the meshlet draws that survive, one buffer per frame in flight
+		std::vector<Ref<VulkanBuffer>> m_MeshletInstanceBuffers;
+		std::vector<uint32_t> m_MeshletInstanceCapacities;
+		std::vector<Ref<VulkanBuffer>> m_MeshletDrawBuffers;
+		std::vector<uint32_t> m_MeshletDrawCapacities;
+
+		Ref<Shader> m_HiZShader;
+		Ref<VulkanComputePipeline> m_HiZPipeline;
+		Ref<VulkanImage> m_HiZImage;
+		glm::mat4 m_PreviousViewProjection = glm::mat4(1.0f);
+		bool m_HiZValid = false;
+
+		VkViewport m_ActiveViewport = {};
+
+		std::vector<std::vector<SecondaryCommandPool>> m_SecondaryCommandPools;
+
+		RendererSettings m_Settings;
+
+		Ref<RenderGraph> m_RenderGraph;
+		Ref<VulkanImage> m_ColorImage;
+		uint32_t m_ViewportWidth = 1280;
+		uint32_t m_ViewportHeight = 720;
+
 		Ref<Shader> m_Shader;
 
 		Ref<VulkanPipeline> m_Pipeline;
+
+		// State shared by every main pass pipeline, LoadPipeline only swaps the shader
+		PipelineSpecification m_PipelineSpecification;
+
+		// Copies of a pipeline for meshes in other vertex formats, keyed by pipeline and format
+		std::unordered_map<uint64_t, VulkanPipeline*> m_PipelineVariants;
+		uint32_t m_PendingPipelineDraws = 0;
+		uint32_t m_TransformUpdates = 0;
+
+		// Bindless variant of the main pipeline, the active pair is picked in BeginScene
+		Ref<Shader> m_BindlessShader;
+		Ref<VulkanPipeline> m_BindlessPipeline;
+		Ref<Shader> m_ActiveShader;
+		Ref<VulkanPipeline> m_ActivePipeline;
+		bool m_BindlessSupported = false;
+		bool m_BindlessActive = false;
+
+		// Material index of every instance slot, read by the vertex shader through the bindless buffer array
+		Ref<VulkanRingBuffer> m_MaterialRingBuffer;
+		uint32_t m_MaterialBufferIndex = UINT32_MAX;
+		uint32_t m_MaterialOffset = 0;
+		Ref<VulkanImage> m_WhiteImage;
 		VkCommandBuffer m_ActiveCommandBuffer = nullptr;
 		std::vector<VkDescriptorSet> m_DescriptorSets;
-		std::vector<VkDescriptorPool> m_DescriptorPools;
+		Ref<VulkanDescriptorCache> m_DescriptorCache;
 	};
 
 }
@@ -2,7 +2,11 @@
 #include "Shader.h"
 #include "VulkanPlayground/Core/Application.h"
 #include "VulkanPlayground/Core/VulkanTools.h"
+#include "VulkanPlayground/Core/Hash.h"
+#include "VulkanPlayground/Graphics/ShaderCache.h"
+#include "VulkanPlayground/Graphics/BindlessDescriptors.h"
 #include <shaderc/shaderc.hpp>
+#include <chrono>
 
 #include <spirv_cross.hpp>
 #include <spirv_common.hpp>
@@ -11,6 +15,22 @@ namespace VKPlayground {
 
 	namespace Utils {
 
+		static const shaderc_target_env s_TargetEnvironment = shaderc_target_env_vulkan;
+		static const shaderc_env_version s_TargetEnvironmentVersion = shaderc_env_version_vulkan_1_2;
+
+		// Everything that changes the generated SPIR-V besides the source itself
+		static uint64_t GetCompileOptionsHash()
+		{
+			unsigned int spirvVersion = 0, spirvRevision = 0;
+			shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+
+			uint64_t hash = Hash::Combine(Hash::FNVOffsetBasis, s_TargetEnvironment);
+			hash = Hash::Combine(hash, s_TargetEnvironmentVersion);
+			hash = Hash::Combine(hash, spirvVersion);
+			hash = Hash::Combine(hash, spirvRevision);
+			return hash;
+		}
+
 		static shaderc_shader_kind ShaderStageToShaderc(ShaderStage stage)
 		{
 			switch (stage)
@@ -50,7 +70,7 @@ namespace VKPlayground {
 				else if (size == 4 * 4) return ShaderUniformType::FLOAT4;
 				else if (size == 64)	return ShaderUniformType::MAT4;
 			}
-			else if (type == spirv_cross::SPIRType::Int)	 return ShaderUniformType::INT;
+			else if (type == spirv_cross::SPIRType::Int || type == spirv_cross::SPIRType::UInt) return ShaderUniformType::INT;
 			else if (type == spirv_cross::SPIRType::Boolean) return ShaderUniformType::BOOL;
 
 			ASSERT(false, "Unknown Type");
@@ -76,6 +96,31 @@ namespace VKPlayground {
 			return (ShaderUniformType)0;
 		}
 
+		static ShaderUniformType GetStorageImageType(uint32_t dimension)
+		{
+			if (dimension == 1)		 return ShaderUniformType::IMAGE_2D;
+			else if (dimension == 3) return ShaderUniformType::IMAGE_CUBE;
+
+			ASSERT(false, "Unknown Type");
+			return (ShaderUniformType)0;
+		}
+
+		static VkDescriptorType GetDescriptorType(ShaderUniformType type)
+		{
+			switch (type)
+			{
+				case ShaderUniformType::TEXTURE_2D:
+				case ShaderUniformType::TEXTURE_CUBE:	return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				case ShaderUniformType::IMAGE_2D:
+				case ShaderUniformType::IMAGE_CUBE:		return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				case ShaderUniformType::STORAGE_BUFFER: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				case ShaderUniformType::STORAGE_BUFFER_DYNAMIC: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+			}
+
+			ASSERT(false, "Unknown Type");
+			return (VkDescriptorType)0;
+		}
+
 	}
 
 	Shader::Shader(const std::string& path)
@@ -96,6 +141,10 @@ namespace VKPlayground {
 
 		for (int i = 0; i < m_DescriptorSetLayouts.size(); i++)
 		{
+			// The bindless layout is shared by every shader and owned by BindlessDescriptors
+			if (i == m_BindlessLayoutIndex)
+				continue;
+
 			vkDestroyDescriptorSetLayout(logicalDevice, m_DescriptorSetLayouts[i], nullptr);
 		}
 	}
@@ -105,22 +154,54 @@ namespace VKPlayground {
 		m_ShaderSrc = SplitShaders(m_Path);
 		ASSERT(m_ShaderSrc.size() >= 1, "Shader is empty or path is invalid");
 
-		bool result = CompileShaders(m_ShaderSrc);
-		ASSERT(result, "Failed to initialize shader")
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		// Look for SPIR-V and reflection data from a previous run before invoking shaderc
+		uint64_t cacheKey = ShaderCache::ComputeKey(m_ShaderSrc, Utils::GetCompileOptionsHash());
+		ShaderCacheEntry cacheEntry;
+		bool cacheHit = ShaderCache::Load(m_Path, cacheKey, cacheEntry);
+		m_Hash = cacheKey;
 
+		if (cacheHit)
+		{
+			m_UniformBufferDescriptions = cacheEntry.UniformBufferDescriptions;
+			m_ShaderResourceDescriptions = cacheEntry.ShaderResourceDescriptions;
+			m_VertexInputs = cacheEntry.VertexInputs;
+		}
+		else
+		{
+			bool result = CompileShaders(m_ShaderSrc, cacheEntry.Binaries);
+			ASSERT(result, "Failed to initialize shader");
+
+			for (const auto& [stage, spirv] : cacheEntry.Binaries)
+			{
+				ReflectShader(spirv);
+			}
+		}
+
+		CreateShaderModules(cacheEntry.Binaries);
 		CreateDescriptorSetLayouts();
+
+		if (!cacheHit)
+		{
+			cacheEntry.UniformBufferDescriptions = m_UniformBufferDescriptions;
+			cacheEntry.ShaderResourceDescriptions = m_ShaderResourceDescriptions;
+			cacheEntry.VertexInputs = m_VertexInputs;
+			ShaderCache::Store(m_Path, cacheKey, cacheEntry);
+		}
+
+		float elapsedTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		LOG_INFO("Shader cache {0} for {1} ({2:.2f}ms) - hits: {3}, misses: {4}", cacheHit ? "hit" : "miss", m_Path, elapsedTime, ShaderCache::GetHitCount(), ShaderCache::GetMissCount());
 	}
 
-	bool Shader::CompileShaders(const std::unordered_map<ShaderStage, std::string>& shaderSrc)
+	bool Shader::CompileShaders(const std::unordered_map<ShaderStage, std::string>& shaderSrc, std::vector<std::pair<ShaderStage, std::vector<uint32_t>>>& outBinaries)
 	{
 		// Setup compiler
 		shaderc::Compiler compiler;
 		shaderc::CompileOptions options;
-		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
-
-		VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+		options.SetTargetEnvironment(Utils::s_TargetEnvironment, Utils::s_TargetEnvironmentVersion);
 
-		for (auto&& [stage, src] : m_ShaderSrc)
+		for (auto&& [stage, src] : shaderSrc)
 		{
 			// Compile shader source and check for errors
 			auto compilationResult = compiler.CompileGlslToSpv(src, Utils::ShaderStageToShaderc(stage), m_Path.c_str(), options);
@@ -130,17 +211,23 @@ namespace VKPlayground {
 				return false;
 			}
 
-			const uint8_t* data = reinterpret_cast<const uint8_t*>(compilationResult.cbegin());
-			const uint8_t* dataEnd = reinterpret_cast<const uint8_t*>(compilationResult.cend());
-			uint32_t size = dataEnd - data;
+			outBinaries.emplace_back(stage, std::vector<uint32_t>(compilationResult.cbegin(), compilationResult.cend()));
+		}
+
+		return true;
+	}
 
-			std::vector<uint32_t> spirv(compilationResult.cbegin(), compilationResult.cend());
+	void Shader::CreateShaderModules(const std::vector<std::pair<ShaderStage, std::vector<uint32_t>>>& binaries)
+	{
+		VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
 
+		for (const auto& [stage, spirv] : binaries)
+		{
 			// Create shader module
 			VkShaderModuleCreateInfo createInfo{};
 			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			createInfo.codeSize = size;
-			createInfo.pCode = reinterpret_cast<const uint32_t*>(data);
+			createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+			createInfo.pCode = spirv.data();
 
 			VkShaderModule shaderModule;
 			VK_CHECK_RESULT(vkCreateShaderModule(logicalDevice, &createInfo, nullptr, &shaderModule));
@@ -148,17 +235,16 @@ namespace VKPlayground {
 			// Create shader stage
 			VkPipelineShaderStageCreateInfo shaderStageInfo{};
 			shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-			shaderStageInfo.stage = Utils::ShaderStageToVulkan(stage);;
+			shaderStageInfo.stage = Utils::ShaderStageToVulkan(stage);
 			shaderStageInfo.module = shaderModule;
 			shaderStageInfo.pName = "main";
 
 			// Save shader stage info
 			m_ShaderCreateInfo.push_back(shaderStageInfo);
-			ReflectShader(spirv);
 		}
 	}
 
-	// TODO: Get info about push constants, other types of buffers and shader stages
+	// TODO: Get info about push constants and shader stages
 	void Shader::ReflectShader(const std::vector<uint32_t>& data)
 	{
 		spirv_cross::Compiler compiler(data);
@@ -204,6 +290,52 @@ namespace VKPlayground {
 			uniform.Type = Utils::GetResourceType(type, uniform.Dimension);
 		}
 
+		// Get all storage images in the shader
+		for (auto& resource : resources.storage_images)
+		{
+			auto& type = compiler.get_type(resource.base_type_id);
+
+			ShaderResource& uniform = m_ShaderResourceDescriptions.emplace_back();
+
+			uniform.Name = resource.name;
+			uniform.BindingPoint = compiler.get_decoration(resource.id, spv::DecorationBinding);
+			uniform.DescriptorSetIndex = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+			uniform.Dimension = type.image.dim;
+			uniform.Type = Utils::GetStorageImageType(uniform.Dimension);
+		}
+
+		// Get all storage buffers in the shader
+		for (auto& resource : resources.storage_buffers)
+		{
+			ShaderResource& uniform = m_ShaderResourceDescriptions.emplace_back();
+
+			uniform.Name = resource.name;
+			uniform.BindingPoint = compiler.get_decoration(resource.id, spv::DecorationBinding);
+			uniform.DescriptorSetIndex = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+			uniform.Dimension = 0;
+
+			// Blocks named r_ are ring buffer slices, their offset is passed when the set is bound
+			const std::string& instanceName = compiler.get_name(resource.id);
+			uniform.Type = instanceName.compare(0, 2, "r_") == 0 ? ShaderUniformType::STORAGE_BUFFER_DYNAMIC : ShaderUniformType::STORAGE_BUFFER;
+		}
+
+		// Get the vertex inputs, inputs of later stages are varyings and not part of the vertex input state
+		if (compiler.get_execution_model() == spv::ExecutionModelVertex)
+		{
+			for (auto& resource : resources.stage_inputs)
+			{
+				auto& type = compiler.get_type(resource.base_type_id);
+
+				ShaderVertexInput& input = m_VertexInputs.emplace_back();
+
+				input.Name = resource.name;
+				input.Location = compiler.get_decoration(resource.id, spv::DecorationLocation);
+				input.Columns = type.columns;
+			}
+
+			std::sort(m_VertexInputs.begin(), m_VertexInputs.end(), [](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a.Location < b.Location; });
+		}
+
 	}
 
 	// TODO: Get info a shader stages so we don't have to use VK_SHADER_STAGE_ALL
@@ -211,15 +343,16 @@ namespace VKPlayground {
 	{
 		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
 
-		std::unordered_map<int, std::vector<VkDescriptorSetLayoutBinding>> descriptorSetLayoutBindings;
+		// Ordered by set number so the layouts line up with the sets in the pipeline layout
+		std::map<int, std::vector<VkDescriptorSetLayoutBinding>> descriptorSetLayoutBindings;
 
-		// Create uniform buffer layout bindings
+		// Create uniform buffer layout bindings, these are dynamic so the renderer can point them at ring buffer slices
 		for (int i = 0; i < m_UniformBufferDescriptions.size(); i++)
 		{
 			VkDescriptorSetLayoutBinding layout{};
 
 			layout.binding = m_UniformBufferDescriptions[i].BindingPoint;
-			layout.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			layout.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			layout.descriptorCount = 1;
 			layout.stageFlags = VK_SHADER_STAGE_ALL;
 			layout.pImmutableSamplers = nullptr;
@@ -230,10 +363,17 @@ namespace VKPlayground {
 		// Create resource layout bindings
 		for (int i = 0; i < m_ShaderResourceDescriptions.size(); i++)
 		{
+			// Runtime arrays in the bindless set are described by the global layout instead
+			if (m_ShaderResourceDescriptions[i].DescriptorSetIndex == BindlessDescriptors::SetIndex)
+			{
+				descriptorSetLayoutBindings[BindlessDescriptors::SetIndex];
+				continue;
+			}
+
 			VkDescriptorSetLayoutBinding layout{};
 
 			layout.binding = m_ShaderResourceDescriptions[i].BindingPoint;
-			layout.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			layout.descriptorType = Utils::GetDescriptorType(m_ShaderResourceDescriptions[i].Type);
 			layout.descriptorCount = 1;
 			layout.stageFlags = VK_SHADER_STAGE_ALL;
 			layout.pImmutableSamplers = nullptr;
@@ -266,6 +406,15 @@ namespace VKPlayground {
 				}
 			}
 
+			if (descriptorSetIndex == BindlessDescriptors::SetIndex)
+			{
+				ASSERT(BindlessDescriptors::IsSupported(), "Shader uses the bindless descriptor set but descriptor indexing is not supported");
+
+				m_BindlessLayoutIndex = ID++;
+				m_DescriptorSetLayouts.push_back(BindlessDescriptors::GetDescriptorSetLayout());
+				continue;
+			}
+
 			ID++;
 
 			VkDescriptorSetLayout& descriptorSetLayout = m_DescriptorSetLayouts.emplace_back();
@@ -10,7 +10,7 @@ namespace VKPlayground {
 
 	enum class ShaderUniformType
 	{
-		NONE = -1, BOOL, INT, FLOAT, FLOAT2, FLOAT3, FLOAT4, MAT4, TEXTURE_2D, TEXTURE_CUBE, IMAGE_2D, IMAGE_CUBE
+		NONE = -1, BOOL, INT, FLOAT, FLOAT2, FLOAT3, FLOAT4, MAT4, TEXTURE_2D, TEXTURE_CUBE, IMAGE_2D, IMAGE_CUBE, STORAGE_BUFFER, STORAGE_BUFFER_DYNAMIC
 	};
 
 	struct ShaderResource
@@ -31,6 +31,16 @@ namespace VKPlayground {
 		uint32_t Offset;
 	};
 
+	// Vertex stage input, matched to a vertex format element by name
+	struct ShaderVertexInput
+	{
+		std::string Name;
+		uint32_t Location;
+
+		// Locations taken up by the input, 4 for a mat4
+		uint32_t Columns;
+	};
+
 	struct UniformBufferDescription
 	{
 		std::string Name;
@@ -51,25 +61,36 @@ namespace VKPlayground {
 	public:
 		inline const std::vector<UniformBufferDescription>& GetUniformBufferDescriptions() { return m_UniformBufferDescriptions; }
 		inline const std::vector<ShaderResource>& GetShaderResourceDescriptions() { return m_ShaderResourceDescriptions; }
+		inline const std::vector<ShaderVertexInput>& GetVertexInputs() const { return m_VertexInputs; }
 
 		inline const std::vector<VkDescriptorSetLayout>& GetDescriptorSetLayouts() { return m_DescriptorSetLayouts; }
+
+		// Index of the shared bindless layout in GetDescriptorSetLayouts(), -1 if the shader doesn't use it
+		inline int GetBindlessLayoutIndex() const { return m_BindlessLayoutIndex; }
 		inline const std::vector<VkPipelineShaderStageCreateInfo>& GetShaderCreateInfo() { return m_ShaderCreateInfo; };
 
+		// Hash of the shader source and compile options, stable across runs
+		inline uint64_t GetHash() const { return m_Hash; }
+
 	private:
 		void Init();
-		bool CompileShaders(const std::unordered_map<ShaderStage, std::string>& shaderSrc);
+		bool CompileShaders(const std::unordered_map<ShaderStage, std::string>& shaderSrc, std::vector<std::pair<ShaderStage, std::vector<uint32_t>>>& outBinaries);
+		void CreateShaderModules(const std::vector<std::pair<ShaderStage, std::vector<uint32_t>>>& binaries);
 		void ReflectShader(const std::vector<uint32_t>& data);
 		void CreateDescriptorSetLayouts();
 		std::unordered_map<ShaderStage, std::string> SplitShaders(const std::string& path);
 
 	private:
 		const std::string m_Path;
+		uint64_t m_Hash = 0;
 		std::unordered_map<ShaderStage, std::string> m_ShaderSrc;
 
 		std::vector<UniformBufferDescription> m_UniformBufferDescriptions;
 		std::vector<ShaderResource> m_ShaderResourceDescriptions;
+		std::vector<ShaderVertexInput> m_VertexInputs;
 
 		std::vector<VkDescriptorSetLayout> m_DescriptorSetLayouts;
+		int m_BindlessLayoutIndex = -1;
 		std::vector<VkPipelineShaderStageCreateInfo> m_ShaderCreateInfo;
 	};
 
@@ -0,0 +1,221 @@
+#include "pch.h"
+#include "ShaderCache.h"
+#include "VulkanPlayground/Core/Hash.h"
+#include <filesystem>
+
+namespace VKPlayground {
+
+	static const char* s_CacheDirectory = "assets/cache/shaders";
+
+	static const uint32_t s_CacheMagic = 0x43535056; // "VPSC"
+	static const uint32_t s_CacheVersion = 4;
+
+	std::atomic<uint32_t> ShaderCache::s_HitCount = 0;
+	std::atomic<uint32_t> ShaderCache::s_MissCount = 0;
+
+	namespace Utils {
+
+		template<typename T>
+		static void Write(std::ofstream& stream, const T& value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		static void WriteString(std::ofstream& stream, const std::string& string)
+		{
+			Write<uint32_t>(stream, (uint32_t)string.size());
+			stream.write(string.data(), string.size());
+		}
+
+		template<typename T>
+		static T Read(std::ifstream& stream)
+		{
+			T value = {};
+			stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+			return value;
+		}
+
+		static std::string ReadString(std::ifstream& stream)
+		{
+			std::string string(Read<uint32_t>(stream), '\0');
+			stream.read(string.data(), string.size());
+			return string;
+		}
+
+	}
+
+	uint64_t ShaderCache::ComputeKey(const std::unordered_map<ShaderStage, std::string>& shaderSrc, uint64_t compileOptionsHash)
+	{
+		uint64_t key = Hash::Combine(Hash::FNVOffsetBasis, s_CacheVersion);
+		key = Hash::Combine(key, compileOptionsHash);
+
+		// Hash stages in a fixed order so the key does not depend on map iteration order
+		for (ShaderStage stage : { ShaderStage::VERTEX, ShaderStage::FRAGMENT, ShaderStage::COMPUTE })
+		{
+			auto it = shaderSrc.find(stage);
+			if (it == shaderSrc.end())
+				continue;
+
+			key = Hash::Combine(key, stage);
+			key = Hash::FNV1a(it->second, key);
+		}
+
+		return key;
+	}
+
+	bool ShaderCache::Load(const std::string& shaderPath, uint64_t key, ShaderCacheEntry& outEntry)
+	{
+		std::ifstream stream(GetCachePath(shaderPath), std::ios::binary);
+		if (!stream || Utils::Read<uint32_t>(stream) != s_CacheMagic || Utils::Read<uint32_t>(stream) != s_CacheVersion || Utils::Read<uint64_t>(stream) != key)
+		{
+			s_MissCount++;
+			return false;
+		}
+
+		ShaderCacheEntry entry;
+
+		// SPIR-V binaries
+		uint32_t stageCount = Utils::Read<uint32_t>(stream);
+		for (uint32_t i = 0; i < stageCount && stream; i++)
+		{
+			auto& [stage, spirv] = entry.Binaries.emplace_back();
+			stage = (ShaderStage)Utils::Read<int32_t>(stream);
+			spirv.resize(Utils::Read<uint32_t>(stream));
+			stream.read(reinterpret_cast<char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+		}
+
+		// Uniform buffers
+		uint32_t bufferCount = Utils::Read<uint32_t>(stream);
+		for (uint32_t i = 0; i < bufferCount && stream; i++)
+		{
+			UniformBufferDescription& buffer = entry.UniformBufferDescriptions.emplace_back();
+			buffer.Name = Utils::ReadString(stream);
+			buffer.Size = Utils::Read<uint32_t>(stream);
+			buffer.BindingPoint = Utils::Read<uint32_t>(stream);
+			buffer.DescriptorSetIndex = Utils::Read<uint32_t>(stream);
+			buffer.Index = Utils::Read<uint32_t>(stream);
+
+			uint32_t uniformCount = Utils::Read<uint32_t>(stream);
+			for (uint32_t j = 0; j < uniformCount && stream; j++)
+			{
+				ShaderUniform& uniform = buffer.Uniforms.emplace_back();
+				uniform.Name = Utils::ReadString(stream);
+				uniform.Type = (ShaderUniformType)Utils::Read<int32_t>(stream);
+				uniform.Size = Utils::Read<uint32_t>(stream);
+				uniform.Offset = Utils::Read<uint32_t>(stream);
+			}
+		}
+
+		// Resources
+		uint32_t resourceCount = Utils::Read<uint32_t>(stream);
+		for (uint32_t i = 0; i < resourceCount && stream; i++)
+		{
+			ShaderResource& resource = entry.ShaderResourceDescriptions.emplace_back();
+			resource.Name = Utils::ReadString(stream);
+			resource.Type = (ShaderUniformType)Utils::Read<int32_t>(stream);
+			resource.BindingPoint = Utils::Read<uint32_t>(stream);
+			resource.DescriptorSetIndex = Utils::Read<uint32_t>(stream);
+			resource.Index = Utils::Read<uint32_t>(stream);
+			resource.Dimension = Utils::Read<uint32_t>(stream);
+		}
+
+		// Vertex inputs
+		uint32_t inputCount = Utils::Read<uint32_t>(stream);
+		for (uint32_t i = 0; i < inputCount && stream; i++)
+		{
+			ShaderVertexInput& input = entry.VertexInputs.emplace_back();
+			input.Name = Utils::ReadString(stream);
+			input.Location = Utils::Read<uint32_t>(stream);
+			input.Columns = Utils::Read<uint32_t>(stream);
+		}
+
+		// Treat truncated or corrupt files as a miss so the shader gets recompiled
+		if (!stream || entry.Binaries.empty())
+		{
+			LOG_WARN("Shader cache for {0} is corrupt, recompiling", shaderPath);
+			s_MissCount++;
+			return false;
+		}
+
+		outEntry = std::move(entry);
+		s_HitCount++;
+		return true;
+	}
+
+	void ShaderCache::Store(const std::string& shaderPath, uint64_t key, const ShaderCacheEntry& entry)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(s_CacheDirectory, error);
+
+		std::string cachePath = GetCachePath(shaderPath);
+		std::ofstream stream(cachePath, std::ios::binary | std::ios::trunc);
+		if (!stream)
+		{
+			LOG_WARN("Failed to write shader cache: {0}", cachePath);
+			return;
+		}
+
+		Utils::Write(stream, s_CacheMagic);
+		Utils::Write(stream, s_CacheVersion);
+		Utils::Write(stream, key);
+
+		// SPIR-V binaries
+		Utils::Write<uint32_t>(stream, (uint32_t)entry.Binaries.size());
+		for (const auto& [stage, spirv] : entry.Binaries)
+		{
+			Utils::Write<int32_t>(stream, (int32_t)stage);
+			Utils::Write<uint32_t>(stream, (uint32_t)spirv.size());
+			stream.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+		}
+
+		// Uniform buffers
+		Utils::Write<uint32_t>(stream, (uint32_t)entry.UniformBufferDescriptions.size());
+		for (const UniformBufferDescription& buffer : entry.UniformBufferDescriptions)
+		{
+			Utils::WriteString(stream, buffer.Name);
+			Utils::Write(stream, buffer.Size);
+			Utils::Write(stream, buffer.BindingPoint);
+			Utils::Write(stream, buffer.DescriptorSetIndex);
+			Utils::Write(stream, buffer.Index);
+
+			Utils::Write<uint32_t>(stream, (uint32_t)buffer.Uniforms.size());
+			for (const ShaderUniform& uniform : buffer.Uniforms)
+			{
+				Utils::WriteString(stream, uniform.Name);
+				Utils::Write<int32_t>(stream, (int32_t)uniform.Type);
+				Utils::Write(stream, uniform.Size);
+				Utils::Write(stream, uniform.Offset);
+			}
+		}
+
+		// Resources
+		Utils::Write<uint32_t>(stream, (uint32_t)entry.ShaderResourceDescriptions.size());
+		for (const ShaderResource& resource : entry.ShaderResourceDescriptions)
+		{
+			Utils::WriteString(stream, resource.Name);
+			Utils::Write<int32_t>(stream, (int32_t)resource.Type);
+			Utils::Write(stream, resource.BindingPoint);
+			Utils::Write(stream, resource.DescriptorSetIndex);
+			Utils::Write(stream, resource.Index);
+			Utils::Write(stream, resource.Dimension);
+		}
+
+		// Vertex inputs
+		Utils::Write<uint32_t>(stream, (uint32_t)entry.VertexInputs.size());
+		for (const ShaderVertexInput& input : entry.VertexInputs)
+		{
+			Utils::WriteString(stream, input.Name);
+			Utils::Write(stream, input.Location);
+			Utils::Write(stream, input.Columns);
+		}
+	}
+
+	std::string ShaderCache::GetCachePath(const std::string& shaderPath)
+	{
+		// Include a hash of the full path so shaders with the same file name don't collide
+		std::stringstream ss;
+		ss << s_CacheDirectory << "/" << std::filesystem::path(shaderPath).stem().string() << "_" << std::hex << Hash::FNV1a(shaderPath) << ".cache";
+		return ss.str();
+	}
+
+}
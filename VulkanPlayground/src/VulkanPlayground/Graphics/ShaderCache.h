@@ -0,0 +1,37 @@
+#pragma once
+#include "VulkanPlayground/Graphics/Shader.h"
+#include <atomic>
+
+namespace VKPlayground {
+
+	struct ShaderCacheEntry
+	{
+		std::vector<std::pair<ShaderStage, std::vector<uint32_t>>> Binaries;
+
+		std::vector<UniformBufferDescription> UniformBufferDescriptions;
+		std::vector<ShaderResource> ShaderResourceDescriptions;
+		std::vector<ShaderVertexInput> VertexInputs;
+	};
+
+	// On-disk cache of compiled SPIR-V and reflection data, one file per shader source
+	class ShaderCache
+	{
+	public:
+		static uint64_t ComputeKey(const std::unordered_map<ShaderStage, std::string>& shaderSrc, uint64_t compileOptionsHash);
+
+		static bool Load(const std::string& shaderPath, uint64_t key, ShaderCacheEntry& outEntry);
+		static void Store(const std::string& shaderPath, uint64_t key, const ShaderCacheEntry& entry);
+
+		inline static uint32_t GetHitCount() { return s_HitCount; }
+		inline static uint32_t GetMissCount() { return s_MissCount; }
+
+	private:
+		static std::string GetCachePath(const std::string& shaderPath);
+
+	private:
+		// Shaders can be compiled on background jobs
+		static std::atomic<uint32_t> s_HitCount;
+		static std::atomic<uint32_t> s_MissCount;
+	};
+
+}
@@ -13,6 +13,7 @@ namespace VKPlayground {
 		~Texture2D();
 
 		inline const VkDescriptorImageInfo& GetDescriptorImageInfo() const { return m_Image->GetDescriptorImageInfo(); }
+		inline uint32_t GetBindlessIndex() const { return m_Image->GetBindlessIndex(); }
 
 	private:
 		std::string m_Path;
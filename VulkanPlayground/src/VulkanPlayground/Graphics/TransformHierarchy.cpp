@@ -0,0 +1,328 @@
+#include "pch.h"
+#include "TransformHierarchy.h"
+
+#if defined(__AVX__)
+	#define TRANSFORM_AVX
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define TRANSFORM_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		// Raw pointers into the hierarchy's arrays, the world arrays start at the identity slot
+		struct TransformStreams
+		{
+			const uint32_t* ParentSlots;
+			const float* Translation[3];
+			const float* Rotation[4];
+			const float* Scale[3];
+			float* World[12];
+		};
+
+		// One node at a time, for the nodes that don't fill a whole register or have their parent in the same batch
+		struct ScalarLanes
+		{
+			using Type = float;
+			static constexpr uint32_t Count = 1;
+
+			static inline Type Load(const float* data) { return *data; }
+			static inline void Store(float* data, Type value) { *data = value; }
+			static inline Type Gather(const float* data, const uint32_t* indices) { return data[indices[0]]; }
+			static inline Type Set(float value) { return value; }
+			static inline Type Add(Type a, Type b) { return a + b; }
+			static inline Type Sub(Type a, Type b) { return a - b; }
+			static inline Type Mul(Type a, Type b) { return a * b; }
+		};
+
+#if defined(TRANSFORM_AVX)
+		// 8 nodes per batch
+		struct SIMDLanes
+		{
+			using Type = __m256;
+			static constexpr uint32_t Count = 8;
+
+			static inline Type Load(const float* data) { return _mm256_loadu_ps(data); }
+			static inline void Store(float* data, Type value) { _mm256_storeu_ps(data, value); }
+			static inline Type Set(float value) { return _mm256_set1_ps(value); }
+			static inline Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+			static inline Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+			static inline Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+
+			static inline Type Gather(const float* data, const uint32_t* indices)
+			{
+				return _mm256_setr_ps(data[indices[0]], data[indices[1]], data[indices[2]], data[indices[3]], data[indices[4]], data[indices[5]], data[indices[6]], data[indices[7]]);
+			}
+		};
+#elif defined(TRANSFORM_SSE)
+		// 4 nodes per batch
+		struct SIMDLanes
+		{
+			using Type = __m128;
+			static constexpr uint32_t Count = 4;
+
+			static inline Type Load(const float* data) { return _mm_loadu_ps(data); }
+			static inline void Store(float* data, Type value) { _mm_storeu_ps(data, value); }
+			static inline Type Set(float value) { return _mm_set1_ps(value); }
+			static inline Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+			static inline Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+			static inline Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+
+			static inline Type Gather(const float* data, const uint32_t* indices)
+			{
+				return _mm_setr_ps(data[indices[0]], data[indices[1]], data[indices[2]], data[indices[3]]);
+			}
+		};
+#else
+		using SIMDLanes = ScalarLanes;
+#endif
+
+		// World matrices of the L::Count nodes starting at first, their parents have to be up to date already
+		template<typename L>
+		static void ComputeWorldTransforms(const TransformStreams& streams, uint32_t first)
+		{
+			using T = typename L::Type;
+
+			T x = L::Load(streams.Rotation[0] + first);
+			T y = L::Load(streams.Rotation[1] + first);
+			T z = L::Load(streams.Rotation[2] + first);
+			T w = L::Load(streams.Rotation[3] + first);
+
+			// Rotation matrix of a unit quaternion, columns scaled by the local scale
+			T two = L::Set(2.0f);
+			T one = L::Set(1.0f);
+			T xx = L::Mul(x, x), yy = L::Mul(y, y), zz = L::Mul(z, z);
+			T xy = L::Mul(x, y), xz = L::Mul(x, z), yz = L::Mul(y, z);
+			T wx = L::Mul(w, x), wy = L::Mul(w, y), wz = L::Mul(w, z);
+
+			T scaleX = L::Load(streams.Scale[0] + first);
+			T scaleY = L::Load(streams.Scale[1] + first);
+			T scaleZ = L::Load(streams.Scale[2] + first);
+
+			T local[4][3];
+			local[0][0] = L::Mul(L::Sub(one, L::Mul(two, L::Add(yy, zz))), scaleX);
+			local[0][1] = L::Mul(L::Mul(two, L::Add(xy, wz)), scaleX);
+			local[0][2] = L::Mul(L::Mul(two, L::Sub(xz, wy)), scaleX);
+			local[1][0] = L::Mul(L::Mul(two, L::Sub(xy, wz)), scaleY);
+			local[1][1] = L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, zz))), scaleY);
+			local[1][2] = L::Mul(L::Mul(two, L::Add(yz, wx)), scaleY);
+			local[2][0] = L::Mul(L::Mul(two, L::Add(xz, wy)), scaleZ);
+			local[2][1] = L::Mul(L::Mul(two, L::Sub(yz, wx)), scaleZ);
+			local[2][2] = L::Mul(L::Sub(one, L::Mul(two, L::Add(xx, yy))), scaleZ);
+			local[3][0] = L::Load(streams.Translation[0] + first);
+			local[3][1] = L::Load(streams.Translation[1] + first);
+			local[3][2] = L::Load(streams.Translation[2] + first);
+
+			const uint32_t* parentSlots = streams.ParentSlots + first;
+
+			T parent[4][3];
+			for (uint32_t column = 0; column < 4; column++)
+			{
+				for (uint32_t row = 0; row < 3; row++)
+					parent[column][row] = L::Gather(streams.World[column * 3 + row], parentSlots);
+			}
+
+			// Both matrices are affine, so the bottom row is always 0 0 0 1 and only the translation column picks up the parent's
+			for (uint32_t column = 0; column < 4; column++)
+			{
+				for (uint32_t row = 0; row < 3; row++)
+				{
+					T value = L::Add(L::Add(L::Mul(parent[0][row], local[column][0]), L::Mul(parent[1][row], local[column][1])), L::Mul(parent[2][row], local[column][2]));
+					if (column == 3)
+						value = L::Add(value, parent[3][row]);
+
+					L::Store(streams.World[column * 3 + row] + first + 1, value);
+				}
+			}
+		}
+
+	}
+
+	uint32_t TransformHierarchy::AddNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		uint32_t node = GetNodeCount();
+		ASSERT(parent == InvalidTransformNode || parent < node, "Parents have to be added before their children");
+
+		// Identity in front of the world matrices for the roots to multiply with
+		if (m_World[0].empty())
+		{
+			for (uint32_t i = 0; i < 12; i++)
+				m_World[i].push_back(i % 4 == 0 ? 1.0f : 0.0f);
+		}
+
+		m_Parents.push_back(parent);
+		m_ParentSlots.push_back(parent == InvalidTransformNode ? 0 : parent + 1);
+
+		m_TranslationX.push_back(translation.x); m_TranslationY.push_back(translation.y); m_TranslationZ.push_back(translation.z);
+		m_RotationX.push_back(rotation.x); m_RotationY.push_back(rotation.y); m_RotationZ.push_back(rotation.z); m_RotationW.push_back(rotation.w);
+		m_ScaleX.push_back(scale.x); m_ScaleY.push_back(scale.y); m_ScaleZ.push_back(scale.z);
+
+		for (uint32_t i = 0; i < 12; i++)
+			m_World[i].push_back(0.0f);
+
+		m_Dirty.push_back(0);
+		MarkDirty(node);
+
+		return node;
+	}
+
+	void TransformHierarchy::Clear()
+	{
+		m_Parents.clear();
+		m_ParentSlots.clear();
+		m_TranslationX.clear(); m_TranslationY.clear(); m_TranslationZ.clear();
+		m_RotationX.clear(); m_RotationY.clear(); m_RotationZ.clear(); m_RotationW.clear();
+		m_ScaleX.clear(); m_ScaleY.clear(); m_ScaleZ.clear();
+
+		for (uint32_t i = 0; i < 12; i++)
+			m_World[i].clear();
+
+		m_Dirty.clear();
+		m_FirstDirty = InvalidTransformNode;
+	}
+
+	void TransformHierarchy::Reserve(uint32_t count)
+	{
+		m_Parents.reserve(count);
+		m_ParentSlots.reserve(count);
+		m_TranslationX.reserve(count); m_TranslationY.reserve(count); m_TranslationZ.reserve(count);
+		m_RotationX.reserve(count); m_RotationY.reserve(count); m_RotationZ.reserve(count); m_RotationW.reserve(count);
+		m_ScaleX.reserve(count); m_ScaleY.reserve(count); m_ScaleZ.reserve(count);
+
+		for (uint32_t i = 0; i < 12; i++)
+			m_World[i].reserve(count + 1);
+
+		m_Dirty.reserve(count);
+	}
+
+	void TransformHierarchy::SetTranslation(uint32_t node, const glm::vec3& translation)
+	{
+		m_TranslationX[node] = translation.x; m_TranslationY[node] = translation.y; m_TranslationZ[node] = translation.z;
+		MarkDirty(node);
+	}
+
+	void TransformHierarchy::SetRotation(uint32_t node, const glm::quat& rotation)
+	{
+		m_RotationX[node] = rotation.x; m_RotationY[node] = rotation.y; m_RotationZ[node] = rotation.z; m_RotationW[node] = rotation.w;
+		MarkDirty(node);
+	}
+
+	void TransformHierarchy::SetScale(uint32_t node, const glm::vec3& scale)
+	{
+		m_ScaleX[node] = scale.x; m_ScaleY[node] = scale.y; m_ScaleZ[node] = scale.z;
+		MarkDirty(node);
+	}
+
+	glm::vec3 TransformHierarchy::GetTranslation(uint32_t node) const
+	{
+		return glm::vec3(m_TranslationX[node], m_TranslationY[node], m_TranslationZ[node]);
+	}
+
+	glm::quat TransformHierarchy::GetRotation(uint32_t node) const
+	{
+		return glm::quat(m_RotationW[node], m_RotationX[node], m_RotationY[node], m_RotationZ[node]);
+	}
+
+	glm::vec3 TransformHierarchy::GetScale(uint32_t node) const
+	{
+		return glm::vec3(m_ScaleX[node], m_ScaleY[node], m_ScaleZ[node]);
+	}
+
+	void TransformHierarchy::MarkDirty(uint32_t node)
+	{
+		// Children come after their parents, so the update only has to look at nodes from the first dirty one on
+		m_Dirty[node] = 1;
+		m_FirstDirty = std::min(m_FirstDirty, node);
+	}
+
+	uint32_t TransformHierarchy::Update()
+	{
+		if (m_FirstDirty == InvalidTransformNode)
+			return 0;
+
+		Utils::TransformStreams streams;
+		streams.ParentSlots = m_ParentSlots.data();
+		streams.Translation[0] = m_TranslationX.data(); streams.Translation[1] = m_TranslationY.data(); streams.Translation[2] = m_TranslationZ.data();
+		streams.Rotation[0] = m_RotationX.data(); streams.Rotation[1] = m_RotationY.data(); streams.Rotation[2] = m_RotationZ.data(); streams.Rotation[3] = m_RotationW.data();
+		streams.Scale[0] = m_ScaleX.data(); streams.Scale[1] = m_ScaleY.data(); streams.Scale[2] = m_ScaleZ.data();
+		for (uint32_t i = 0; i < 12; i++)
+			streams.World[i] = m_World[i].data();
+
+		const uint32_t count = GetNodeCount();
+		const uint32_t laneCount = Utils::SIMDLanes::Count;
+		uint32_t updatedCount = 0;
+
+		for (uint32_t first = m_FirstDirty; first < count; first += laneCount)
+		{
+			uint32_t end = std::min(first + laneCount, count);
+
+			// Dirty flags are pushed down to the children before the batch is computed, clean lanes of a dirty batch are
+			// recomputed from unchanged inputs and keep their values
+			uint32_t dirtyCount = 0;
+			bool independent = end - first == laneCount;
+			for (uint32_t i = first; i < end; i++)
+			{
+				uint32_t parent = m_Parents[i];
+				if (parent != InvalidTransformNode)
+				{
+					m_Dirty[i] |= m_Dirty[parent];
+					independent &= parent < first;
+				}
+
+				dirtyCount += m_Dirty[i];
+			}
+
+			if (dirtyCount == 0)
+				continue;
+
+			if (independent)
+			{
+				Utils::ComputeWorldTransforms<Utils::SIMDLanes>(streams, first);
+			}
+			else
+			{
+				for (uint32_t i = first; i < end; i++)
+				{
+					if (m_Dirty[i])
+						Utils::ComputeWorldTransforms<Utils::ScalarLanes>(streams, i);
+				}
+			}
+
+			updatedCount += dirtyCount;
+		}
+
+		std::fill(m_Dirty.begin() + m_FirstDirty, m_Dirty.end(), (uint8_t)0);
+		m_FirstDirty = InvalidTransformNode;
+
+		return updatedCount;
+	}
+
+	glm::mat4 TransformHierarchy::GetWorldTransform(uint32_t node) const
+	{
+		uint32_t slot = node + 1;
+
+		glm::mat4 transform(1.0f);
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			for (uint32_t row = 0; row < 3; row++)
+				transform[column][row] = m_World[column * 3 + row][slot];
+		}
+
+		return transform;
+	}
+
+	const char* TransformHierarchy::GetInstructionSet()
+	{
+#if defined(TRANSFORM_AVX)
+		return "AVX";
+#elif defined(TRANSFORM_SSE)
+		return "SSE";
+#else
+		return "Scalar";
+#endif
+	}
+
+}
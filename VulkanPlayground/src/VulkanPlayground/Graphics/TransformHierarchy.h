@@ -0,0 +1,61 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace VKPlayground {
+
+	static constexpr uint32_t InvalidTransformNode = ~0u;
+
+	// Node hierarchy flattened into arrays with every parent before its children, local translation, rotation and scale
+	// are stored one component per array so world matrices can be computed for several nodes per SIMD instruction.
+	// Setting a local transform only marks the node dirty, Update() then recomputes it and the nodes below it.
+	class TransformHierarchy
+	{
+	public:
+		// parent has to be InvalidTransformNode or a node that was added before
+		uint32_t AddNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+		void Clear();
+		void Reserve(uint32_t count);
+
+		void SetTranslation(uint32_t node, const glm::vec3& translation);
+		void SetRotation(uint32_t node, const glm::quat& rotation);
+		void SetScale(uint32_t node, const glm::vec3& scale);
+
+		glm::vec3 GetTranslation(uint32_t node) const;
+		glm::quat GetRotation(uint32_t node) const;
+		glm::vec3 GetScale(uint32_t node) const;
+
+		// Recomputes the world matrices of dirty nodes and their descendants, returns how many nodes were recomputed.
+		// Costs nothing if no node changed since the last update.
+		uint32_t Update();
+
+		// Last result of Update() for the node, includes the transforms of all of its parents
+		glm::mat4 GetWorldTransform(uint32_t node) const;
+
+		inline uint32_t GetParent(uint32_t node) const { return m_Parents[node]; }
+		inline uint32_t GetNodeCount() const { return (uint32_t)m_Parents.size(); }
+
+		// Name of the instruction set Update() was compiled for
+		static const char* GetInstructionSet();
+
+	private:
+		void MarkDirty(uint32_t node);
+
+	private:
+		std::vector<uint32_t> m_Parents;
+
+		// Parent of every node offset by one, roots point at the identity matrix stored in front of the world matrices
+		std::vector<uint32_t> m_ParentSlots;
+
+		std::vector<float> m_TranslationX, m_TranslationY, m_TranslationZ;
+		std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+		std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+
+		// Upper 3x4 of every world matrix, m_World[column * 3 + row] holds one element of all nodes, node i is stored at i + 1
+		std::vector<float> m_World[12];
+
+		std::vector<uint8_t> m_Dirty;
+		uint32_t m_FirstDirty = InvalidTransformNode;
+	};
+
+}
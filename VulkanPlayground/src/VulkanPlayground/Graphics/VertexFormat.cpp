@@ -0,0 +1,365 @@
+#include "pch.h"
+#include "VertexFormat.h"
+#include "VulkanPlayground/Core/Hash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VERTEX_FORMAT_SSE
+	#include <emmintrin.h>
+#endif
+
+// F16C isn't part of AVX but every AVX2 CPU has it
+#if defined(__F16C__) || defined(__AVX2__)
+	#define VERTEX_FORMAT_F16C
+	#include <immintrin.h>
+#endif
+
+namespace VKPlayground {
+
+	namespace Utils {
+
+		// Missing components default to (0, 0, 0, 1)
+		static glm::vec4 LoadValue(const uint8_t* source, uint32_t componentCount)
+		{
+			glm::vec4 value = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			memcpy(&value.x, source, componentCount * sizeof(float));
+			return value;
+		}
+
+		// Same operations as the SIMD paths below, cooked meshes must not depend on the instruction set they were cooked with
+		static uint32_t PackUnorm(float value, float scale)
+		{
+			return (uint32_t)(std::min(std::max(value, 0.0f), 1.0f) * scale + 0.5f);
+		}
+
+		// Rounds to nearest even like F16C does, glm rounds ties up so the two paths would cook different bytes
+		static uint16_t PackHalf(float value)
+		{
+			uint32_t bits = 0;
+			memcpy(&bits, &value, sizeof(bits));
+
+			uint32_t sign = (bits >> 16) & 0x8000;
+			bits &= 0x7FFFFFFF;
+
+			uint32_t half = 0;
+			if (bits >= 0x47800000)
+			{
+				// Too large for a half, infinity or NaN
+				half = bits > 0x7F800000 ? 0x7E00 : 0x7C00;
+			}
+			else if (bits < 0x38800000)
+			{
+				// Denormal result, adding 0.5 lines the mantissa up so the float addition does the rounding
+				float magnitude = 0.0f;
+				memcpy(&magnitude, &bits, sizeof(bits));
+				magnitude += 0.5f;
+
+				memcpy(&half, &magnitude, sizeof(half));
+				half -= 0x3F000000;
+			}
+			else
+			{
+				uint32_t mantissaOdd = (bits >> 13) & 1;
+				bits += 0xC8000FFF + mantissaOdd;
+				half = bits >> 13;
+			}
+
+			return (uint16_t)(half | sign);
+		}
+
+		// Maps the unit sphere onto the [-1, 1] square, two components keep more precision than three of the same size.
+		// The direction goes in RG remapped to [0, 1], the tangent's bitangent sign in A.
+		static uint32_t PackOctahedral(const glm::vec4& value, bool tangent)
+		{
+			float sum = (std::abs(value.x) + std::abs(value.y)) + std::abs(value.z);
+			float x = value.x / sum;
+			float y = value.y / sum;
+			float z = value.z / sum;
+
+			if (z < 0.0f)
+			{
+				float foldedX = 1.0f - std::abs(y);
+				float foldedY = 1.0f - std::abs(x);
+				x = x < 0.0f ? -foldedX : foldedX;
+				y = y < 0.0f ? -foldedY : foldedY;
+			}
+
+			uint32_t sign = tangent && value.w < 0.0f ? 0 : 3;
+			return PackUnorm(x * 0.5f + 0.5f, 1023.0f) | (PackUnorm(y * 0.5f + 0.5f, 1023.0f) << 10) | (sign << 30);
+		}
+
+		static void EncodeFloats(const uint8_t* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination, uint32_t destinationStride, uint32_t size)
+		{
+			if (componentCount * sizeof(float) >= size)
+			{
+				for (uint32_t i = 0; i < count; i++)
+					memcpy(destination + (size_t)i * destinationStride, source + (size_t)i * sourceStride, size);
+				return;
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				glm::vec4 value = LoadValue(source + (size_t)i * sourceStride, componentCount);
+				memcpy(destination + (size_t)i * destinationStride, &value.x, size);
+			}
+		}
+
+		static void EncodeHalf4(const uint8_t* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination, uint32_t destinationStride)
+		{
+#if defined(VERTEX_FORMAT_F16C)
+			// F16C keeps the upper bits of a NaN's payload, PackHalf writes the plain quiet NaN with the input's sign
+			const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+			const __m128 quietNaN = _mm_castsi128_ps(_mm_set1_epi32(0x7FC00000));
+#endif
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				glm::vec4 value = LoadValue(source + (size_t)i * sourceStride, componentCount);
+
+#if defined(VERTEX_FORMAT_F16C)
+				__m128 values = _mm_loadu_ps(&value.x);
+				__m128 isNaN = _mm_cmpunord_ps(values, values);
+				__m128 canonicalNaN = _mm_or_ps(_mm_and_ps(values, signMask), quietNaN);
+				values = _mm_or_ps(_mm_andnot_ps(isNaN, values), _mm_and_ps(isNaN, canonicalNaN));
+
+				__m128i packed = _mm_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + (size_t)i * destinationStride), packed);
+#else
+				uint16_t packed[4] = { PackHalf(value.x), PackHalf(value.y), PackHalf(value.z), PackHalf(value.w) };
+				memcpy(destination + (size_t)i * destinationStride, packed, sizeof(packed));
+#endif
+			}
+		}
+
+		static void EncodeHalf2(const uint8_t* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination, uint32_t destinationStride)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				glm::vec4 value = LoadValue(source + (size_t)i * sourceStride, componentCount);
+
+				uint16_t packed[2] = { PackHalf(value.x), PackHalf(value.y) };
+				memcpy(destination + (size_t)i * destinationStride, packed, sizeof(packed));
+			}
+		}
+
+		static void EncodeUnorm2x16(const uint8_t* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination, uint32_t destinationStride)
+		{
+			uint32_t i = 0;
+
+#if defined(VERTEX_FORMAT_SSE)
+			// 4 vertices per iteration, transposed so every register holds one component
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(65535.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			for (; i + 4 <= count; i += 4)
+			{
+				glm::vec4 values[4];
+				for (uint32_t lane = 0; lane < 4; lane++)
+					values[lane] = LoadValue(source + (size_t)(i + lane) * sourceStride, componentCount);
+
+				__m128 x = _mm_loadu_ps(&values[0].x);
+				__m128 y = _mm_loadu_ps(&values[1].x);
+				__m128 z = _mm_loadu_ps(&values[2].x);
+				__m128 w = _mm_loadu_ps(&values[3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				__m128i packedX = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, zero), one), scale), half));
+				__m128i packedY = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, zero), one), scale), half));
+
+				uint32_t packed[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(packed), _mm_or_si128(packedX, _mm_slli_epi32(packedY, 16)));
+
+				for (uint32_t lane = 0; lane < 4; lane++)
+					memcpy(destination + (size_t)(i + lane) * destinationStride, &packed[lane], sizeof(uint32_t));
+			}
+#endif
+
+			// Remaining vertices that don't fill a whole register
+			for (; i < count; i++)
+			{
+				glm::vec4 value = LoadValue(source + (size_t)i * sourceStride, componentCount);
+
+				uint32_t packed = PackUnorm(value.x, 65535.0f) | (PackUnorm(value.y, 65535.0f) << 16);
+				memcpy(destination + (size_t)i * destinationStride, &packed, sizeof(packed));
+			}
+		}
+
+		static void EncodeOctahedral(const uint8_t* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination, uint32_t destinationStride, bool tangent)
+		{
+			uint32_t i = 0;
+
+#if defined(VERTEX_FORMAT_SSE)
+			// 4 vertices per iteration, transposed so every register holds one component
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 scale = _mm_set1_ps(1023.0f);
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			const __m128i signBits = _mm_set1_epi32(3 << 30);
+
+			for (; i + 4 <= count; i += 4)
+			{
+				glm::vec4 values[4];
+				for (uint32_t lane = 0; lane < 4; lane++)
+					values[lane] = LoadValue(source + (size_t)(i + lane) * sourceStride, componentCount);
+
+				__m128 x = _mm_loadu_ps(&values[0].x);
+				__m128 y = _mm_loadu_ps(&values[1].x);
+				__m128 z = _mm_loadu_ps(&values[2].x);
+				__m128 w = _mm_loadu_ps(&values[3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z));
+				x = _mm_div_ps(x, sum);
+				y = _mm_div_ps(y, sum);
+				z = _mm_div_ps(z, sum);
+
+				// Fold the lower hemisphere over the diagonals, keeping the sign of each component
+				__m128 foldedX = _mm_xor_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, y)), _mm_and_ps(_mm_cmplt_ps(x, zero), signMask));
+				__m128 foldedY = _mm_xor_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_and_ps(_mm_cmplt_ps(y, zero), signMask));
+				__m128 lower = _mm_cmplt_ps(z, zero);
+				x = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, x));
+				y = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, y));
+
+				x = _mm_add_ps(_mm_mul_ps(x, half), half);
+				y = _mm_add_ps(_mm_mul_ps(y, half), half);
+				__m128i packedX = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, zero), one), scale), half));
+				__m128i packedY = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, zero), one), scale), half));
+
+				__m128i sign = tangent ? _mm_andnot_si128(_mm_castps_si128(_mm_cmplt_ps(w, zero)), signBits) : signBits;
+
+				uint32_t packed[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(packed), _mm_or_si128(_mm_or_si128(packedX, _mm_slli_epi32(packedY, 10)), sign));
+
+				for (uint32_t lane = 0; lane < 4; lane++)
+					memcpy(destination + (size_t)(i + lane) * destinationStride, &packed[lane], sizeof(uint32_t));
+			}
+#endif
+
+			// Remaining vertices that don't fill a whole register
+			for (; i < count; i++)
+			{
+				uint32_t packed = PackOctahedral(LoadValue(source + (size_t)i * sourceStride, componentCount), tangent);
+				memcpy(destination + (size_t)i * destinationStride, &packed, sizeof(packed));
+			}
+		}
+
+	}
+
+	VertexFormat::VertexFormat(std::initializer_list<VertexElement> elements, VkVertexInputRate inputRate)
+		: m_Elements(elements), m_InputRate(inputRate)
+	{
+		m_Hash = Hash::Combine(Hash::FNVOffsetBasis, inputRate);
+
+		for (VertexElement& element : m_Elements)
+		{
+			element.Offset = m_Stride;
+			m_Stride += GetFormatSize(element.Format) * element.Count;
+
+			m_Hash = Hash::Combine(m_Hash, element.Semantic);
+			m_Hash = Hash::Combine(m_Hash, element.Format);
+			m_Hash = Hash::Combine(m_Hash, element.Count);
+		}
+	}
+
+	const VertexElement* VertexFormat::GetElement(VertexSemantic semantic) const
+	{
+		for (const VertexElement& element : m_Elements)
+		{
+			if (element.Semantic == semantic)
+				return &element;
+		}
+
+		return nullptr;
+	}
+
+	void VertexFormat::EncodeElement(VertexSemantic semantic, const void* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination) const
+	{
+		ASSERT(componentCount <= 4, "Vertex elements have at most four components");
+
+		const VertexElement* element = GetElement(semantic);
+		if (!element)
+			return;
+
+		const uint8_t* sourceBytes = static_cast<const uint8_t*>(source);
+		uint8_t* destinationBytes = destination + element->Offset;
+
+		// Format is picked once per stream, each kernel then runs a tight loop over the vertices
+		switch (element->Format)
+		{
+			case VK_FORMAT_R32G32_SFLOAT:
+			case VK_FORMAT_R32G32B32_SFLOAT:
+			case VK_FORMAT_R32G32B32A32_SFLOAT:
+			{
+				Utils::EncodeFloats(sourceBytes, sourceStride, componentCount, count, destinationBytes, m_Stride, GetFormatSize(element->Format));
+				return;
+			}
+			case VK_FORMAT_R16G16B16A16_SFLOAT:
+			{
+				Utils::EncodeHalf4(sourceBytes, sourceStride, componentCount, count, destinationBytes, m_Stride);
+				return;
+			}
+			case VK_FORMAT_R16G16_SFLOAT:
+			{
+				Utils::EncodeHalf2(sourceBytes, sourceStride, componentCount, count, destinationBytes, m_Stride);
+				return;
+			}
+			case VK_FORMAT_R16G16_UNORM:
+			{
+				Utils::EncodeUnorm2x16(sourceBytes, sourceStride, componentCount, count, destinationBytes, m_Stride);
+				return;
+			}
+			case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+			{
+				ASSERT(semantic == VertexSemantic::NORMAL || semantic == VertexSemantic::TANGENT, "Only normals and tangents can be octahedral encoded");
+				Utils::EncodeOctahedral(sourceBytes, sourceStride, componentCount, count, destinationBytes, m_Stride, semantic == VertexSemantic::TANGENT);
+				return;
+			}
+			default:
+				break;
+		}
+
+		ASSERT(false, "Unsupported vertex format");
+	}
+
+	VertexFormat VertexFormat::Compact(bool halfPositions, bool unormTextureCoords)
+	{
+		return VertexFormat({
+			{ VertexSemantic::POSITION, halfPositions ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT },
+			{ VertexSemantic::NORMAL,   VK_FORMAT_A2B10G10R10_UNORM_PACK32 },
+			{ VertexSemantic::TANGENT,  VK_FORMAT_A2B10G10R10_UNORM_PACK32 },
+			{ VertexSemantic::TEXCOORD, unormTextureCoords ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R32G32_SFLOAT }
+		});
+	}
+
+	VertexSemantic VertexFormat::GetSemantic(const std::string& inputName)
+	{
+		if (inputName == "a_Position")	return VertexSemantic::POSITION;
+		if (inputName == "a_Normal")	return VertexSemantic::NORMAL;
+		if (inputName == "a_Tangent")	return VertexSemantic::TANGENT;
+		if (inputName == "a_TexCoord")	return VertexSemantic::TEXCOORD;
+		if (inputName == "a_Transform") return VertexSemantic::TRANSFORM;
+
+		return VertexSemantic::NONE;
+	}
+
+	uint32_t VertexFormat::GetFormatSize(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_R32G32_SFLOAT:			 return 8;
+			case VK_FORMAT_R32G32B32_SFLOAT:		 return 12;
+			case VK_FORMAT_R32G32B32A32_SFLOAT:		 return 16;
+			case VK_FORMAT_R16G16B16A16_SFLOAT:		 return 8;
+			case VK_FORMAT_R16G16_SFLOAT:			 return 4;
+			case VK_FORMAT_R16G16_UNORM:			 return 4;
+			case VK_FORMAT_A2B10G10R10_UNORM_PACK32: return 4;
+			default:								 break;
+		}
+
+		ASSERT(false, "Unsupported vertex format");
+		return 0;
+	}
+
+}
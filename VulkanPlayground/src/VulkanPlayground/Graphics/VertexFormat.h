@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+namespace VKPlayground {
+
+	// What a vertex attribute holds, shader inputs are matched to it by name (a_Position, a_Normal, ...)
+	enum class VertexSemantic
+	{
+		NONE = -1, POSITION, NORMAL, TANGENT, TEXCOORD, TRANSFORM
+	};
+
+	struct VertexElement
+	{
+		VertexSemantic Semantic = VertexSemantic::NONE;
+		VkFormat Format = VK_FORMAT_UNDEFINED;
+
+		// Consecutive locations taken up by the element, 4 for a mat4 made of vec4 columns
+		uint32_t Count = 1;
+		uint32_t Offset = 0;
+	};
+
+	// Layout of one vertex buffer binding. Shaders only declare what they read, the pipeline picks the matching elements.
+	class VertexFormat
+	{
+	public:
+		VertexFormat() = default;
+		VertexFormat(std::initializer_list<VertexElement> elements, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX);
+
+	public:
+		// nullptr if the format has no element with that semantic
+		const VertexElement* GetElement(VertexSemantic semantic) const;
+
+		inline const std::vector<VertexElement>& GetElements() const { return m_Elements; }
+		inline uint32_t GetStride() const { return m_Stride; }
+		inline VkVertexInputRate GetInputRate() const { return m_InputRate; }
+		inline uint64_t GetHash() const { return m_Hash; }
+
+		// Packs count float values of one semantic, read every sourceStride bytes, into vertices starting at destination.
+		// Missing components default to (0, 0, 0, 1), a source stride of 0 writes the same value to every vertex.
+		// Normals and tangents stored as A2B10G10R10_UNORM_PACK32 are octahedral encoded and have to be decoded in the shader.
+		void EncodeElement(VertexSemantic semantic, const void* source, uint32_t sourceStride, uint32_t componentCount, uint32_t count, uint8_t* destination) const;
+
+		inline bool operator==(const VertexFormat& other) const { return m_Hash == other.m_Hash; }
+		inline bool operator!=(const VertexFormat& other) const { return m_Hash != other.m_Hash; }
+
+	public:
+		// Octahedral normals and tangents with half positions and 16-bit UNORM texture coordinates (20 bytes per vertex),
+		// positions and texture coordinates fall back to 32-bit floats for meshes that need the range or precision
+		static VertexFormat Compact(bool halfPositions = true, bool unormTextureCoords = true);
+
+		static VertexSemantic GetSemantic(const std::string& inputName);
+		static uint32_t GetFormatSize(VkFormat format);
+
+	private:
+		std::vector<VertexElement> m_Elements;
+		VkVertexInputRate m_InputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		uint32_t m_Stride = 0;
+		uint64_t m_Hash = 0;
+	};
+
+}
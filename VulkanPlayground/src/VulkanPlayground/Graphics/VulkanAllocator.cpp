@@ -1,6 +1,7 @@
 #include "pch.h"
 #define VMA_IMPLEMENTATION
 #include "VulkanAllocator.h"
+#include "VulkanDescriptorCache.h"
 #include "VulkanPlayground/Core/Application.h"
 #include "VulkanPlayground/Core/Log.h"
 
@@ -56,6 +57,7 @@ namespace VKPlayground {
 
 	void VulkanAllocator::DestroyBuffer(VkBuffer buffer, VmaAllocation allocation)
 	{
+		VulkanDescriptorCache::Invalidate(buffer);
 		vmaDestroyBuffer(s_Data->Allocator, buffer, allocation);
 	}
 
@@ -64,6 +66,29 @@ namespace VKPlayground {
 		vmaDestroyImage(s_Data->Allocator, image, allocation);
 	}
 
+	VmaAllocation VulkanAllocator::AllocateMemory(const VkMemoryRequirements& memoryRequirements, VmaMemoryUsage usage)
+	{
+		VmaAllocationCreateInfo allocCreateInfo = {};
+		allocCreateInfo.usage = usage;
+
+		VmaAllocation allocation;
+		VK_CHECK_RESULT(vmaAllocateMemory(s_Data->Allocator, &memoryRequirements, &allocCreateInfo, &allocation, nullptr));
+
+		LOG_INFO("[{0}] - allocating memory; size = {1}", m_Tag, memoryRequirements.size);
+
+		return allocation;
+	}
+
+	void VulkanAllocator::BindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image)
+	{
+		VK_CHECK_RESULT(vmaBindImageMemory2(s_Data->Allocator, allocation, offset, image, nullptr));
+	}
+
+	void VulkanAllocator::FreeMemory(VmaAllocation allocation)
+	{
+		vmaFreeMemory(s_Data->Allocator, allocation);
+	}
+
 	void VulkanAllocator::UnmapMemory(VmaAllocation allocation)
 	{
 		vmaUnmapMemory(s_Data->Allocator, allocation);
@@ -17,6 +17,11 @@ namespace VKPlayground {
 
 		void DestroyBuffer(VkBuffer buffer, VmaAllocation allocation);
 		void DestroyImage(VkImage image, VmaAllocation allocation);
+
+		// Raw memory that several resources can be bound into, used for aliasing
+		VmaAllocation AllocateMemory(const VkMemoryRequirements& memoryRequirements, VmaMemoryUsage usage);
+		void BindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image);
+		void FreeMemory(VmaAllocation allocation);
 		
 		template<typename T>
 		T* MapMemory(VmaAllocation allocation)
@@ -1,54 +1,79 @@
 #include "pch.h"
 #include "VulkanBuffers.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanPlayground/Core/Application.h"
 
 namespace VKPlayground {
 
-	VulkanVertexBuffer::VulkanVertexBuffer(void* vertexData, uint32_t size)
-	{
-		// Create buffer info
-		VkBufferCreateInfo vertexBufferCreateInfo = {};
-		vertexBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		vertexBufferCreateInfo.size = size;
-		vertexBufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		vertexBufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	namespace Utils {
 
-		// Allocate memory
-		VulkanAllocator allocator("VertexBuffer");
-		m_BufferInfo.Allocation = allocator.AllocateBuffer(vertexBufferCreateInfo, VMA_MEMORY_USAGE_CPU_TO_GPU, m_BufferInfo.Buffer);
+		static BufferInfo CreateGeometryBuffer(const char* tag, void* data, uint32_t size, VkBufferUsageFlags usage, BufferUploadMode uploadMode)
+		{
+			BufferInfo bufferInfo;
+
+			// Create buffer info
+			VkBufferCreateInfo bufferCreateInfo = {};
+			bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferCreateInfo.size = size;
+			bufferCreateInfo.usage = usage;
+			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VulkanAllocator allocator(tag);
+
+			if (uploadMode == BufferUploadMode::DeviceLocal)
+			{
+				// Allocate device local memory and queue a copy from staging memory
+				bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+				bufferInfo.Allocation = allocator.AllocateBuffer(bufferCreateInfo, VMA_MEMORY_USAGE_GPU_ONLY, bufferInfo.Buffer);
+
+				if (data)
+					VulkanUploadQueue::UploadBuffer(bufferInfo.Buffer, data, size);
+			}
+			else
+			{
+				// Allocate memory
+				bufferInfo.Allocation = allocator.AllocateBuffer(bufferCreateInfo, VMA_MEMORY_USAGE_CPU_TO_GPU, bufferInfo.Buffer);
+
+				// Copy data into buffer
+				if (data)
+				{
+					void* dstBuffer = allocator.MapMemory<void>(bufferInfo.Allocation);
+					memcpy(dstBuffer, data, size);
+					allocator.UnmapMemory(bufferInfo.Allocation);
+				}
+			}
+
+			return bufferInfo;
+		}
 
-		// Copy data into buffer
-		void* dstBuffer = allocator.MapMemory<void>(m_BufferInfo.Allocation);
-		memcpy(dstBuffer, vertexData, size);
-		allocator.UnmapMemory(m_BufferInfo.Allocation);
+	}
+
+	VulkanVertexBuffer::VulkanVertexBuffer(void* vertexData, uint32_t size, BufferUploadMode uploadMode)
+		: m_UploadMode(uploadMode), m_Size(size)
+	{
+		m_BufferInfo = Utils::CreateGeometryBuffer("VertexBuffer", vertexData, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, uploadMode);
 	}
 
 	VulkanVertexBuffer::~VulkanVertexBuffer()
 	{
+		if (m_UploadMode == BufferUploadMode::DeviceLocal)
+			VulkanUploadQueue::Discard(m_BufferInfo.Buffer);
+
 		VulkanAllocator allocator("VertexBuffer");
 		allocator.DestroyBuffer(m_BufferInfo.Buffer, m_BufferInfo.Allocation);
 	}
 
-	VulkanIndexBuffer::VulkanIndexBuffer(void* indexData, uint32_t size, uint32_t count)
-		: m_Count(count) 
+	VulkanIndexBuffer::VulkanIndexBuffer(void* indexData, uint32_t size, uint32_t count, VkIndexType indexType, BufferUploadMode uploadMode)
+		: m_UploadMode(uploadMode), m_Count(count), m_IndexType(indexType)
 	{
-		// Create buffer info
-		VkBufferCreateInfo vertexBufferCreateInfo = {};
-		vertexBufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		vertexBufferCreateInfo.size = size;
-		vertexBufferCreateInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-
-		// Allocate memory
-		VulkanAllocator allocator("IndexBuffer");
-		m_BufferInfo.Allocation = allocator.AllocateBuffer(vertexBufferCreateInfo, VMA_MEMORY_USAGE_CPU_TO_GPU, m_BufferInfo.Buffer);
-
-		// Copy data into buffer
-		void* dstBuffer = allocator.MapMemory<void>(m_BufferInfo.Allocation);
-		memcpy(dstBuffer, indexData, size);
-		allocator.UnmapMemory(m_BufferInfo.Allocation);
+		m_BufferInfo = Utils::CreateGeometryBuffer("IndexBuffer", indexData, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, uploadMode);
 	}
 
 	VulkanIndexBuffer::~VulkanIndexBuffer()
 	{
+		if (m_UploadMode == BufferUploadMode::DeviceLocal)
+			VulkanUploadQueue::Discard(m_BufferInfo.Buffer);
+
 		VulkanAllocator allocator("IndexBuffer");
 		allocator.DestroyBuffer(m_BufferInfo.Buffer, m_BufferInfo.Allocation);
 	}
@@ -62,9 +87,10 @@ namespace VKPlayground {
 		vertexBufferCreateInfo.size = size;
 		vertexBufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 
-		// Allocate memory
+		// Allocate memory and keep it mapped for the lifetime of the buffer
 		VulkanAllocator allocator("UniformBuffer");
 		m_BufferInfo.Allocation = allocator.AllocateBuffer(vertexBufferCreateInfo, VMA_MEMORY_USAGE_CPU_TO_GPU, m_BufferInfo.Buffer);
+		m_MappedData = allocator.MapMemory<uint8_t>(m_BufferInfo.Allocation);
 
 		if (data)
 			UpdateBuffer(data);
@@ -77,19 +103,61 @@ namespace VKPlayground {
 	VulkanUniformBuffer::~VulkanUniformBuffer()
 	{
 		VulkanAllocator allocator("UniformBuffer");
+		allocator.UnmapMemory(m_BufferInfo.Allocation);
 		allocator.DestroyBuffer(m_BufferInfo.Buffer, m_BufferInfo.Allocation);
 	}
 
 	void VulkanUniformBuffer::UpdateBuffer(void* data)
 	{
-		// Copy data into buffer
-		VulkanAllocator allocator("UniformBuffer");
-		void* dstBuffer = allocator.MapMemory<void>(m_BufferInfo.Allocation);
-		memcpy(dstBuffer, data, m_Size);
+		memcpy(m_MappedData, data, m_Size);
+	}
+
+	VulkanRingBuffer::VulkanRingBuffer(uint32_t sizePerFrame, VkBufferUsageFlags usage, uint32_t alignment)
+		: m_Alignment(std::max(alignment, 1u))
+	{
+		m_SizePerFrame = (sizePerFrame + m_Alignment - 1) / m_Alignment * m_Alignment;
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+
+		// Create buffer info
+		VkBufferCreateInfo bufferCreateInfo = {};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = (VkDeviceSize)m_SizePerFrame * framesInFlight;
+		bufferCreateInfo.usage = usage;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		// Allocate memory and keep it mapped for the lifetime of the buffer
+		VulkanAllocator allocator("RingBuffer");
+		m_BufferInfo.Allocation = allocator.AllocateBuffer(bufferCreateInfo, VMA_MEMORY_USAGE_CPU_TO_GPU, m_BufferInfo.Buffer);
+		m_MappedData = allocator.MapMemory<uint8_t>(m_BufferInfo.Allocation);
+	}
+
+	VulkanRingBuffer::~VulkanRingBuffer()
+	{
+		VulkanAllocator allocator("RingBuffer");
 		allocator.UnmapMemory(m_BufferInfo.Allocation);
+		allocator.DestroyBuffer(m_BufferInfo.Buffer, m_BufferInfo.Allocation);
+	}
+
+	void VulkanRingBuffer::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameOffset = frameIndex * m_SizePerFrame;
+		m_Head = 0;
+	}
+
+	RingAllocation VulkanRingBuffer::Allocate(uint32_t size)
+	{
+		uint32_t offset = (m_Head + m_Alignment - 1) / m_Alignment * m_Alignment;
+		ASSERT(offset + size <= m_SizePerFrame, "Ring buffer is out of space for this frame");
+
+		m_Head = offset + size;
+
+		RingAllocation allocation;
+		allocation.Offset = m_FrameOffset + offset;
+		allocation.Data = m_MappedData + m_FrameOffset + offset;
+		return allocation;
 	}
 
-	VulkanBuffer::VulkanBuffer(void* data, uint32_t size, VkBufferUsageFlagBits bufferType, VmaMemoryUsage memoryType)
+	VulkanBuffer::VulkanBuffer(void* data, uint32_t size, VkBufferUsageFlags bufferType, VmaMemoryUsage memoryType)
 	{
 		// Create buffer info
 		VkBufferCreateInfo vertexBufferCreateInfo = {};
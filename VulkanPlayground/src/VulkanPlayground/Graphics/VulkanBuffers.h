@@ -10,34 +10,46 @@ namespace VKPlayground {
 		VmaAllocation Allocation = nullptr;
 	};
 
+	enum class BufferUploadMode
+	{
+		HostVisible = 0,	// CPU_TO_GPU memory written directly, the GPU reads it over the bus
+		DeviceLocal			// GPU_ONLY memory filled through VulkanUploadQueue
+	};
+
 	// Vertex Buffer
 	class VulkanVertexBuffer
 	{
 	public:
-		VulkanVertexBuffer(void* vertexData, uint32_t size);
+		VulkanVertexBuffer(void* vertexData, uint32_t size, BufferUploadMode uploadMode = BufferUploadMode::HostVisible);
 		~VulkanVertexBuffer();
 
 	public:
 		VkBuffer GetVulkanBuffer() { return m_BufferInfo.Buffer; }
+		uint32_t GetSize() { return m_Size; }
 
 	private:
 		BufferInfo m_BufferInfo;
+		BufferUploadMode m_UploadMode;
+		uint32_t m_Size = 0;
 	};
 
 	// Index Buffer
 	class VulkanIndexBuffer
 	{
 	public:
-		VulkanIndexBuffer(void* indexData, uint32_t size, uint32_t count);
+		VulkanIndexBuffer(void* indexData, uint32_t size, uint32_t count, VkIndexType indexType = VK_INDEX_TYPE_UINT16, BufferUploadMode uploadMode = BufferUploadMode::HostVisible);
 		~VulkanIndexBuffer();
 
 	public:
 		VkBuffer GetVulkanBuffer() { return m_BufferInfo.Buffer; }
 		uint32_t GetCount() { return m_Count; }
+		VkIndexType GetIndexType() { return m_IndexType; }
 
 	private:
 		BufferInfo m_BufferInfo;
+		BufferUploadMode m_UploadMode;
 		uint32_t m_Count = 0;
+		VkIndexType m_IndexType = VK_INDEX_TYPE_UINT16;
 	};
 
 	// Uniform Buffer
@@ -57,13 +69,54 @@ namespace VKPlayground {
 		BufferInfo m_BufferInfo;
 		VkDescriptorBufferInfo m_DescriptorBufferInfo;
 		uint32_t m_Size = 0;
+		uint8_t* m_MappedData = nullptr;
+	};
+
+	struct RingAllocation
+	{
+		uint32_t Offset = 0;
+		void* Data = nullptr;
+	};
+
+	// Ring Buffer
+	// Persistently mapped buffer split into one region per frame in flight. Allocations are only valid for the
+	// frame they were made in, so the CPU never writes into a region the GPU may still be reading.
+	class VulkanRingBuffer
+	{
+	public:
+		VulkanRingBuffer(uint32_t sizePerFrame, VkBufferUsageFlags usage, uint32_t alignment);
+		~VulkanRingBuffer();
+
+	public:
+		void BeginFrame(uint32_t frameIndex);
+		RingAllocation Allocate(uint32_t size);
+
+		template<typename T>
+		uint32_t Push(const T& data)
+		{
+			RingAllocation allocation = Allocate(sizeof(T));
+			memcpy(allocation.Data, &data, sizeof(T));
+			return allocation.Offset;
+		}
+
+		VkBuffer GetVulkanBuffer() { return m_BufferInfo.Buffer; }
+		VkDescriptorBufferInfo GetDescriptorBufferInfo(uint32_t range) const { return { m_BufferInfo.Buffer, 0, range }; }
+
+	private:
+		BufferInfo m_BufferInfo;
+		uint8_t* m_MappedData = nullptr;
+
+		uint32_t m_SizePerFrame = 0;
+		uint32_t m_Alignment = 0;
+		uint32_t m_FrameOffset = 0;
+		uint32_t m_Head = 0;
 	};
 
 	// Vulkan Buffer
 	class VulkanBuffer
 	{
 	public:
-		VulkanBuffer(void* data, uint32_t size, VkBufferUsageFlagBits bufferType, VmaMemoryUsage memoryType);
+		VulkanBuffer(void* data, uint32_t size, VkBufferUsageFlags bufferType, VmaMemoryUsage memoryType);
 		~VulkanBuffer();
 
 	public:
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "VulkanComputePipeline.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/VulkanTools.h"
+#include "PipelineCache.h"
+
+namespace VKPlayground {
+
+	VulkanComputePipeline::VulkanComputePipeline(Ref<Shader> shader)
+		: m_Shader(shader)
+	{
+		Init();
+		LOG_INFO("Initialized Vulkan compute pipeline");
+	}
+
+	VulkanComputePipeline::~VulkanComputePipeline()
+	{
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		vkDestroyPipeline(device, m_Pipeline, nullptr);
+		vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
+	}
+
+	void VulkanComputePipeline::Init()
+	{
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		const std::vector<VkPipelineShaderStageCreateInfo>& shaderCreateInfo = m_Shader->GetShaderCreateInfo();
+		ASSERT(shaderCreateInfo.size() == 1 && shaderCreateInfo[0].stage == VK_SHADER_STAGE_COMPUTE_BIT, "Compute pipeline requires a shader with a single compute stage");
+
+		// Set pipeline layout
+		const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts = m_Shader->GetDescriptorSetLayouts();
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = descriptorSetLayouts.size();
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout));
+
+		// Create pipeline
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = shaderCreateInfo[0];
+		pipelineInfo.layout = m_PipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		pipelineInfo.basePipelineIndex = -1;
+
+		VK_CHECK_RESULT(vkCreateComputePipelines(device, PipelineCache::GetVulkanPipelineCache(), 1, &pipelineInfo, nullptr, &m_Pipeline));
+	}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "VulkanPlayground/Graphics/Shader.h"
+#include <vulkan/vulkan.h>
+
+namespace VKPlayground {
+
+	class VulkanComputePipeline
+	{
+	public:
+		VulkanComputePipeline(Ref<Shader> shader);
+		~VulkanComputePipeline();
+
+	public:
+		inline VkPipeline GetPipeline() { return m_Pipeline; }
+		inline VkPipelineLayout GetPipelineLayout() { return m_PipelineLayout; }
+
+	private:
+		void Init();
+
+	private:
+		VkPipeline m_Pipeline = nullptr;
+		VkPipelineLayout m_PipelineLayout = nullptr;
+
+		Ref<Shader> m_Shader;
+	};
+
+}
@@ -0,0 +1,329 @@
+#include "pch.h"
+#include "VulkanDescriptorCache.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/Hash.h"
+
+namespace VKPlayground {
+
+	static const uint32_t s_MaxPoolSets = 4096;
+
+	// Every live cache, so resources can invalidate sets without knowing which caches they were written into
+	static std::mutex s_CachesMutex;
+	static std::vector<VulkanDescriptorCache*> s_Caches;
+
+	// Descriptors of each type reserved per set, pools are sized as a multiple of this
+	static const VkDescriptorPoolSize s_PoolSizesPerSet[] =
+	{
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 3 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 }
+	};
+
+	namespace Utils {
+
+		static bool IsImageDescriptor(VkDescriptorType type)
+		{
+			return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+				type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		}
+
+		static std::vector<uint64_t> CollectResources(const VkWriteDescriptorSet* writes, uint32_t writeCount)
+		{
+			std::vector<uint64_t> resources;
+			for (uint32_t i = 0; i < writeCount; i++)
+			{
+				const VkWriteDescriptorSet& write = writes[i];
+				for (uint32_t j = 0; j < write.descriptorCount; j++)
+				{
+					if (IsImageDescriptor(write.descriptorType))
+					{
+						if (write.pImageInfo[j].sampler)
+							resources.push_back((uint64_t)write.pImageInfo[j].sampler);
+						if (write.pImageInfo[j].imageView)
+							resources.push_back((uint64_t)write.pImageInfo[j].imageView);
+					}
+					else
+					{
+						resources.push_back((uint64_t)write.pBufferInfo[j].buffer);
+					}
+				}
+			}
+
+			std::sort(resources.begin(), resources.end());
+			resources.erase(std::unique(resources.begin(), resources.end()), resources.end());
+			return resources;
+		}
+
+	}
+
+	VulkanDescriptorCache::VulkanDescriptorCache()
+	{
+		CreatePool();
+
+		std::lock_guard<std::mutex> lock(s_CachesMutex);
+		s_Caches.push_back(this);
+	}
+
+	VulkanDescriptorCache::~VulkanDescriptorCache()
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_CachesMutex);
+			s_Caches.erase(std::find(s_Caches.begin(), s_Caches.end(), this));
+		}
+
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		for (VkDescriptorPool pool : m_Pools)
+		{
+			vkDestroyDescriptorPool(device, pool, nullptr);
+		}
+	}
+
+	void VulkanDescriptorCache::BeginFrame()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		m_FrameNumber++;
+
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+
+		// A set last bound more than framesInFlight frames ago has finished executing and can be written again
+		uint32_t recycled = 0;
+		for (auto it = m_Sets.begin(); it != m_Sets.end();)
+		{
+			if (m_FrameNumber - it->second.LastUsedFrame > framesInFlight)
+			{
+				UnlinkResources(it->first, it->second);
+				m_FreeSets[it->second.Layout].push_back(it->second.DescriptorSet);
+				it = m_Sets.erase(it);
+				recycled++;
+			}
+			else
+			{
+				it++;
+			}
+		}
+
+		auto invalidated = std::partition(m_InvalidatedSets.begin(), m_InvalidatedSets.end(), [&](const CachedSet& cachedSet)
+		{
+			return m_FrameNumber - cachedSet.LastUsedFrame <= framesInFlight;
+		});
+
+		for (auto it = invalidated; it != m_InvalidatedSets.end(); it++)
+		{
+			m_FreeSets[it->Layout].push_back(it->DescriptorSet);
+			recycled++;
+		}
+
+		m_InvalidatedSets.erase(invalidated, m_InvalidatedSets.end());
+
+		m_Stats.Hits = 0;
+		m_Stats.Misses = 0;
+		m_Stats.Recycled = recycled;
+		m_Stats.CachedSets = (uint32_t)m_Sets.size();
+		m_Stats.Pools = (uint32_t)m_Pools.size();
+	}
+
+	VkDescriptorSet VulkanDescriptorCache::GetDescriptorSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		std::vector<uint64_t> description = DescribeWrites(layout, writes, writeCount);
+		uint64_t key = Hash::FNV1a(description.data(), description.size() * sizeof(uint64_t));
+
+		auto it = m_Sets.find(key);
+		if (it != m_Sets.end())
+		{
+			if (it->second.Writes == description)
+			{
+				it->second.LastUsedFrame = m_FrameNumber;
+				m_Stats.Hits++;
+				return it->second.DescriptorSet;
+			}
+
+			// Hash collision, frames in flight may still bind the other set so it is retired like an invalidated one
+			UnlinkResources(key, it->second);
+			m_InvalidatedSets.push_back(std::move(it->second));
+			m_Sets.erase(it);
+			m_Stats.CachedSets--;
+		}
+
+		m_Stats.Misses++;
+		m_Stats.CachedSets++;
+
+		CachedSet& cachedSet = m_Sets[key];
+		cachedSet.LastUsedFrame = m_FrameNumber;
+		cachedSet.Layout = layout;
+		cachedSet.Writes = std::move(description);
+		cachedSet.DescriptorSet = AllocateDescriptorSet(layout);
+		cachedSet.Resources = Utils::CollectResources(writes, writeCount);
+
+		for (uint64_t resource : cachedSet.Resources)
+		{
+			m_SetsByResource[resource].push_back(key);
+		}
+
+		if (writeCount > 0)
+		{
+			std::vector<VkWriteDescriptorSet> setWrites(writes, writes + writeCount);
+			for (VkWriteDescriptorSet& write : setWrites)
+			{
+				write.dstSet = cachedSet.DescriptorSet;
+			}
+
+			VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+			vkUpdateDescriptorSets(device, writeCount, setWrites.data(), 0, nullptr);
+		}
+
+		return cachedSet.DescriptorSet;
+	}
+
+	VkDescriptorSet VulkanDescriptorCache::GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<VkWriteDescriptorSet>& writes)
+	{
+		return GetDescriptorSet(layout, writes.data(), (uint32_t)writes.size());
+	}
+
+	void VulkanDescriptorCache::InvalidateResource(uint64_t resource)
+	{
+		std::lock_guard<std::mutex> cachesLock(s_CachesMutex);
+
+		for (VulkanDescriptorCache* cache : s_Caches)
+		{
+			std::lock_guard<std::mutex> lock(cache->m_Mutex);
+
+			auto it = cache->m_SetsByResource.find(resource);
+			if (it == cache->m_SetsByResource.end())
+				continue;
+
+			std::vector<uint64_t> keys = std::move(it->second);
+			cache->m_SetsByResource.erase(it);
+
+			for (uint64_t key : keys)
+			{
+				auto setIt = cache->m_Sets.find(key);
+				if (setIt == cache->m_Sets.end())
+					continue;
+
+				cache->UnlinkResources(key, setIt->second);
+				cache->m_InvalidatedSets.push_back(std::move(setIt->second));
+				cache->m_Sets.erase(setIt);
+			}
+		}
+	}
+
+	void VulkanDescriptorCache::UnlinkResources(uint64_t key, const CachedSet& cachedSet)
+	{
+		for (uint64_t resource : cachedSet.Resources)
+		{
+			auto it = m_SetsByResource.find(resource);
+			if (it == m_SetsByResource.end())
+				continue;
+
+			std::vector<uint64_t>& keys = it->second;
+			auto keyIt = std::find(keys.begin(), keys.end(), key);
+			if (keyIt != keys.end())
+			{
+				*keyIt = keys.back();
+				keys.pop_back();
+			}
+
+			if (keys.empty())
+				m_SetsByResource.erase(it);
+		}
+	}
+
+	std::vector<uint64_t> VulkanDescriptorCache::DescribeWrites(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount) const
+	{
+		std::vector<uint64_t> description;
+		description.push_back((uint64_t)layout);
+
+		// Only the fields that describe the bound resources, the structs themselves contain pointers and padding
+		for (uint32_t i = 0; i < writeCount; i++)
+		{
+			const VkWriteDescriptorSet& write = writes[i];
+			description.push_back(write.dstBinding);
+			description.push_back(write.dstArrayElement);
+			description.push_back(write.descriptorType);
+			description.push_back(write.descriptorCount);
+
+			for (uint32_t j = 0; j < write.descriptorCount; j++)
+			{
+				if (Utils::IsImageDescriptor(write.descriptorType))
+				{
+					const VkDescriptorImageInfo& imageInfo = write.pImageInfo[j];
+					description.push_back((uint64_t)imageInfo.sampler);
+					description.push_back((uint64_t)imageInfo.imageView);
+					description.push_back(imageInfo.imageLayout);
+				}
+				else
+				{
+					const VkDescriptorBufferInfo& bufferInfo = write.pBufferInfo[j];
+					description.push_back((uint64_t)bufferInfo.buffer);
+					description.push_back(bufferInfo.offset);
+					description.push_back(bufferInfo.range);
+				}
+			}
+		}
+
+		return description;
+	}
+
+	VkDescriptorSet VulkanDescriptorCache::AllocateDescriptorSet(VkDescriptorSetLayout layout)
+	{
+		auto freeIt = m_FreeSets.find(layout);
+		if (freeIt != m_FreeSets.end() && !freeIt->second.empty())
+		{
+			VkDescriptorSet descriptorSet = freeIt->second.back();
+			freeIt->second.pop_back();
+			return descriptorSet;
+		}
+
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+		allocInfo.descriptorPool = m_Pools.back();
+
+		VkDescriptorSet descriptorSet;
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+
+		// The last pool is full, grow and try again
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			CreatePool();
+			allocInfo.descriptorPool = m_Pools.back();
+			result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+		}
+
+		VK_CHECK_RESULT(result);
+		return descriptorSet;
+	}
+
+	void VulkanDescriptorCache::CreatePool()
+	{
+		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		std::vector<VkDescriptorPoolSize> poolSizes(std::begin(s_PoolSizesPerSet), std::end(s_PoolSizesPerSet));
+		for (VkDescriptorPoolSize& poolSize : poolSizes)
+		{
+			poolSize.descriptorCount *= m_PoolMaxSets;
+		}
+
+		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+		descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCreateInfo.flags = 0;
+		descriptorPoolCreateInfo.maxSets = m_PoolMaxSets;
+		descriptorPoolCreateInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
+
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &m_Pools.emplace_back()));
+
+		// Each pool is twice the size of the previous one so a growing scene needs few of them
+		m_PoolMaxSets = std::min(m_PoolMaxSets * 2, s_MaxPoolSets);
+	}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+
+namespace VKPlayground {
+
+	struct DescriptorCacheStats
+	{
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;
+		uint32_t Recycled = 0;
+		uint32_t CachedSets = 0;
+		uint32_t Pools = 0;
+	};
+
+	// Descriptor sets keyed by their layout and the resources written into them. A set is only allocated and written
+	// the first time a combination is seen, sets that stop being used are recycled once no frame in flight can reference them.
+	class VulkanDescriptorCache
+	{
+	public:
+		VulkanDescriptorCache();
+		~VulkanDescriptorCache();
+
+	public:
+		void BeginFrame();
+
+		// dstSet of the writes is ignored, the returned set already holds the written resources
+		VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount);
+		VkDescriptorSet GetDescriptorSet(VkDescriptorSetLayout layout, const std::vector<VkWriteDescriptorSet>& writes);
+
+		inline const DescriptorCacheStats& GetStats() const { return m_Stats; }
+
+		// Drops the sets of every cache that reference a buffer, image view or sampler that is being destroyed,
+		// a new object can get the same handle value and must not hit the old sets
+		template<typename T>
+		static void Invalidate(T handle) { InvalidateResource((uint64_t)handle); }
+
+	private:
+		struct CachedSet
+		{
+			VkDescriptorSet DescriptorSet = nullptr;
+			VkDescriptorSetLayout Layout = nullptr;
+			uint64_t LastUsedFrame = 0;
+
+			// Layout and every write field the key was hashed from, compared on lookup so a hash collision can't return the wrong set
+			std::vector<uint64_t> Writes;
+
+			// Handles written into the set, used to find it again when one of them is invalidated
+			std::vector<uint64_t> Resources;
+		};
+
+	private:
+		static void InvalidateResource(uint64_t resource);
+
+		std::vector<uint64_t> DescribeWrites(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount) const;
+		void UnlinkResources(uint64_t key, const CachedSet& cachedSet);
+		VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout);
+		void CreatePool();
+
+	private:
+		std::unordered_map<uint64_t, CachedSet> m_Sets;
+		std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> m_FreeSets;
+		std::unordered_map<uint64_t, std::vector<uint64_t>> m_SetsByResource;
+
+		// Invalidated sets, frames in flight may still bind them so they are recycled like unused ones
+		std::vector<CachedSet> m_InvalidatedSets;
+
+		// Pools are never reset, a new and larger one is added when the last one runs out
+		std::vector<VkDescriptorPool> m_Pools;
+		uint32_t m_PoolMaxSets = 64;
+
+		uint64_t m_FrameNumber = 0;
+		DescriptorCacheStats m_Stats;
+
+		// Resources can be destroyed on other threads than the one recording
+		std::mutex m_Mutex;
+	};
+
+}
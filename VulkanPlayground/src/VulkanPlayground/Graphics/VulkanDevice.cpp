@@ -49,6 +49,7 @@ namespace VKPlayground {
 				m_SwapChainSupportDetails = QuerySwapChainSupport(devices[i]);
 				m_QueueIndices = indices;
 				m_PhysicalDevice = devices[i];
+				m_PhysicalDeviceProperties = deviceProperties;
 				LOG_INFO("Selected GPU: {0}", deviceProperties.deviceName);
 			}
 		}
@@ -69,17 +70,23 @@ namespace VKPlayground {
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
-		// Required device features
-		VkPhysicalDeviceFeatures deviceFeatures{};
+		// Optional device features, only the ones supported by the device get enabled
+		SelectFeatures();
+
+		VkPhysicalDeviceFeatures2 deviceFeatures{};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.pNext = &m_EnabledVulkan12Features;
+		deviceFeatures.features = m_EnabledFeatures;
 
 		// Logical device info
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &deviceFeatures;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.enabledExtensionCount = static_cast<uint32_t>(s_DeviceExtensions.size());
 		createInfo.ppEnabledExtensionNames = s_DeviceExtensions.data();
-		createInfo.pEnabledFeatures = &deviceFeatures;
+		createInfo.pEnabledFeatures = nullptr;
 
 		// Create logical device
 		VK_CHECK_RESULT(vkCreateDevice(m_PhysicalDevice, &createInfo, nullptr, &m_LogicalDevice));
@@ -152,6 +159,42 @@ namespace VKPlayground {
 		}
 	}
 
+	void VulkanDevice::SelectFeatures()
+	{
+		// Query supported features
+		VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+		supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supportedFeatures{};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &supportedVulkan12Features;
+
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &supportedFeatures);
+
+		// Indirect drawing
+		m_EnabledFeatures.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+		m_EnabledFeatures.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+
+		m_EnabledVulkan12Features = {};
+		m_EnabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		m_EnabledVulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+
+		// Descriptor indexing, used for the global bindless descriptor set
+		m_EnabledVulkan12Features.descriptorIndexing = supportedVulkan12Features.descriptorIndexing;
+		m_EnabledVulkan12Features.runtimeDescriptorArray = supportedVulkan12Features.runtimeDescriptorArray;
+		m_EnabledVulkan12Features.descriptorBindingPartiallyBound = supportedVulkan12Features.descriptorBindingPartiallyBound;
+		m_EnabledVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind;
+		m_EnabledVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind;
+		m_EnabledVulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
+		// Dynamic indexing of the bindless arrays, required alongside the non-uniform variants
+		m_EnabledFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.features.shaderSampledImageArrayDynamicIndexing;
+		m_EnabledFeatures.shaderStorageBufferArrayDynamicIndexing = supportedFeatures.features.shaderStorageBufferArrayDynamicIndexing;
+
+		LOG_INFO("Device features: multiDrawIndirect = {0}, drawIndirectFirstInstance = {1}, drawIndirectCount = {2}, descriptorIndexing = {3}",
+			m_EnabledFeatures.multiDrawIndirect, m_EnabledFeatures.drawIndirectFirstInstance, m_EnabledVulkan12Features.drawIndirectCount, m_EnabledVulkan12Features.descriptorIndexing);
+	}
+
 	bool VulkanDevice::IsDeviceSuitable(VkPhysicalDevice device)
 	{
 		VkPhysicalDeviceProperties deviceProperties;
@@ -31,6 +31,9 @@ namespace VKPlayground {
 	public:
 		inline VkPhysicalDevice GetPhysicalDevice() { return m_PhysicalDevice; };
 		inline VkDevice GetLogicalDevice() { return m_LogicalDevice; };
+		inline const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() { return m_PhysicalDeviceProperties; }
+		inline const VkPhysicalDeviceFeatures& GetEnabledFeatures() { return m_EnabledFeatures; }
+		inline const VkPhysicalDeviceVulkan12Features& GetEnabledVulkan12Features() { return m_EnabledVulkan12Features; }
 
 		VkCommandBuffer CreateCommandBuffer(VkCommandBufferLevel level, bool begin);
 		void FlushCommandBuffer(VkCommandBuffer commandBuffer, bool free);
@@ -45,12 +48,16 @@ namespace VKPlayground {
 	private:
 		void Init();
 
+		void SelectFeatures();
 		bool IsDeviceSuitable(VkPhysicalDevice device);
 		bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
 		QueueFamilyIndices FindQueueIndices(VkPhysicalDevice device);
 
 	private:
 		VkPhysicalDevice m_PhysicalDevice = nullptr;
+		VkPhysicalDeviceProperties m_PhysicalDeviceProperties;
+		VkPhysicalDeviceFeatures m_EnabledFeatures = {};
+		VkPhysicalDeviceVulkan12Features m_EnabledVulkan12Features = {};
 		VkDevice m_LogicalDevice = nullptr;
 
 		VkCommandPool m_CommandPool = nullptr;
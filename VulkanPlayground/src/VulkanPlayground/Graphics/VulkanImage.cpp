@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "VulkanImage.h"
+#include "BindlessDescriptors.h"
+#include "VulkanDescriptorCache.h"
 #include "VulkanPlayground/Core/Application.h"
 
 namespace VKPlayground {
@@ -12,11 +14,25 @@ namespace VKPlayground {
 
 	VulkanImage::~VulkanImage()
 	{
+		BindlessDescriptors::ReleaseImage(m_BindlessIndex);
+
+		VulkanDescriptorCache::Invalidate(m_ImageInfo.ImageView);
+		VulkanDescriptorCache::Invalidate(m_DepthImageView);
+		VulkanDescriptorCache::Invalidate(m_ImageInfo.Sampler);
+
 		VulkanAllocator allocator("Texture2D");
 		allocator.DestroyImage(m_ImageInfo.Image, m_ImageInfo.MemoryAlloc);
 
 		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
 		vkDestroyImageView(device, m_ImageInfo.ImageView, nullptr);
+		vkDestroyImageView(device, m_DepthImageView, nullptr);
+
+		for (VkImageView mipImageView : m_MipImageViews)
+		{
+			VulkanDescriptorCache::Invalidate(mipImageView);
+			vkDestroyImageView(device, mipImageView, nullptr);
+		}
+
 		vkDestroySampler(device, m_ImageInfo.Sampler, nullptr);
 	}
 
@@ -33,7 +49,7 @@ namespace VKPlayground {
 		imageCreateInfo.extent.width = m_Specification.Width;
 		imageCreateInfo.extent.height = m_Specification.Height;
 		imageCreateInfo.extent.depth = 1;
-		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.mipLevels = m_Specification.MipLevels;
 		imageCreateInfo.arrayLayers = m_Specification.LayerCount;
 		imageCreateInfo.samples = m_Specification.SampleCount;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -114,13 +130,36 @@ namespace VKPlayground {
 		imageViewCreateInfo.subresourceRange = {};
 		imageViewCreateInfo.subresourceRange.aspectMask = aspectFlag;
 		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.levelCount = m_Specification.MipLevels;
 		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 		imageViewCreateInfo.subresourceRange.layerCount = m_Specification.LayerCount;
 		imageViewCreateInfo.image = m_ImageInfo.Image;
 
 		VK_CHECK_RESULT(vkCreateImageView(device->GetLogicalDevice(), &imageViewCreateInfo, nullptr, &m_ImageInfo.ImageView));
 
+		// Create depth only view
+		if (IsDepthFormat(m_Specification.Format) && IsStencilFormat(m_Specification.Format))
+		{
+			VkImageViewCreateInfo depthViewCreateInfo = imageViewCreateInfo;
+			depthViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+			VK_CHECK_RESULT(vkCreateImageView(device->GetLogicalDevice(), &depthViewCreateInfo, nullptr, &m_DepthImageView));
+		}
+
+		// Create per mip views
+		if (m_Specification.MipLevels > 1)
+		{
+			m_MipImageViews.resize(m_Specification.MipLevels);
+			for (uint32_t mip = 0; mip < m_Specification.MipLevels; mip++)
+			{
+				VkImageViewCreateInfo mipViewCreateInfo = imageViewCreateInfo;
+				mipViewCreateInfo.subresourceRange.baseMipLevel = mip;
+				mipViewCreateInfo.subresourceRange.levelCount = 1;
+
+				VK_CHECK_RESULT(vkCreateImageView(device->GetLogicalDevice(), &mipViewCreateInfo, nullptr, &m_MipImageViews[mip]));
+			}
+		}
+
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = {};
 		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -140,6 +179,11 @@ namespace VKPlayground {
 		m_DescriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		m_DescriptorImageInfo.imageView = m_ImageInfo.ImageView;
 		m_DescriptorImageInfo.sampler = m_ImageInfo.Sampler;
+
+		// Depth-stencil views can't be sampled and storage images live in the general layout, everything else is readable by index
+		bool depthStencil = IsDepthFormat(m_Specification.Format) || IsStencilFormat(m_Specification.Format);
+		if (!depthStencil && !(m_Specification.Usage & VK_IMAGE_USAGE_STORAGE_BIT))
+			m_BindlessIndex = BindlessDescriptors::RegisterImage(m_DescriptorImageInfo);
 	}
 
 	bool VulkanImage::IsDepthFormat(VkFormat format)
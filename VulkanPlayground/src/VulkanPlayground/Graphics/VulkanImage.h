@@ -19,6 +19,7 @@ namespace VKPlayground {
 		uint32_t Height;
 		VkFormat Format;
 		uint32_t LayerCount = 1;
+		uint32_t MipLevels = 1;
 		VkImageUsageFlags Usage;
 		VkSampleCountFlagBits SampleCount = VK_SAMPLE_COUNT_1_BIT;
 		bool UseStagingBuffer = true;
@@ -33,6 +34,16 @@ namespace VKPlayground {
 	public:
 		inline const ImageSpecification& GetSpecification() const { return m_Specification; }
 		inline const VkDescriptorImageInfo& GetDescriptorImageInfo() const { return m_DescriptorImageInfo; }
+		inline VkImage GetVulkanImage() const { return m_ImageInfo.Image; }
+
+		// Views of a single mip level, only created for images with more than one mip
+		inline VkImageView GetMipImageView(uint32_t mip) const { return m_MipImageViews[mip]; }
+
+		// Depth-stencil images can only be sampled through a view with a single aspect
+		inline VkImageView GetDepthImageView() const { return m_DepthImageView ? m_DepthImageView : m_ImageInfo.ImageView; }
+
+		// Slot in the global bindless array, BindlessInvalidIndex for images that can't be sampled through it
+		inline uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
 
 	public:
 		static bool IsDepthFormat(VkFormat format);
@@ -44,6 +55,9 @@ namespace VKPlayground {
 	private:
 		ImageInfo m_ImageInfo;
 		VkDescriptorImageInfo m_DescriptorImageInfo;
+		std::vector<VkImageView> m_MipImageViews;
+		VkImageView m_DepthImageView = nullptr;
+		uint32_t m_BindlessIndex = UINT32_MAX;
 		uint32_t m_Size = 0;
 
 		ImageSpecification m_Specification;
@@ -2,6 +2,8 @@
 #include "VulkanPipeline.h"
 #include "VulkanPlayground/Core/Application.h"
 #include "VulkanPlayground/Core/VulkanTools.h"
+#include "VulkanPlayground/Core/Hash.h"
+#include "PipelineCache.h"
 
 namespace VKPlayground {
 
@@ -10,8 +12,31 @@ namespace VKPlayground {
 		VK_DYNAMIC_STATE_LINE_WIDTH
 	};
 
-	VulkanPipeline::VulkanPipeline(Ref<Shader> shader, VkRenderPass renderPass)
-		: m_Shader(shader), m_RenderPass(renderPass)
+	uint64_t PipelineSpecification::GetHash() const
+	{
+		uint64_t hash = Hash::Combine(Hash::FNVOffsetBasis, Shader ? Shader->GetHash() : 0);
+
+		for (const VertexFormat& format : VertexBuffers)
+			hash = Hash::Combine(hash, format.GetHash());
+
+		hash = Hash::Combine(hash, Topology);
+		hash = Hash::Combine(hash, PolygonMode);
+		hash = Hash::Combine(hash, CullMode);
+		hash = Hash::Combine(hash, FrontFace);
+		hash = Hash::Combine(hash, DepthTest);
+		hash = Hash::Combine(hash, DepthWrite);
+		hash = Hash::Combine(hash, DepthCompareOp);
+		hash = Hash::Combine(hash, BlendEnable);
+
+		for (VkFormat format : ColorFormats)
+			hash = Hash::Combine(hash, format);
+		hash = Hash::Combine(hash, DepthFormat);
+
+		return hash;
+	}
+
+	VulkanPipeline::VulkanPipeline(const PipelineSpecification& specification)
+		: m_Specification(specification)
 	{
 		Init();
 		LOG_INFO("Initialized Vulkan pipeline");
@@ -27,49 +52,58 @@ namespace VKPlayground {
 
 	void VulkanPipeline::Init()
 	{
-		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes(4);
-
-		// Vertex 0: Position
-		vertexInputAttributes[0].binding = 0;
-		vertexInputAttributes[0].location = 0;
-		vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexInputAttributes[0].offset = 0;
-
-		// Vertex 0: Normal
-		vertexInputAttributes[1].binding = 0;
-		vertexInputAttributes[1].location = 1;
-		vertexInputAttributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexInputAttributes[1].offset = 12;
-
-		// Vertex 0: Tangent
-		vertexInputAttributes[2].binding = 0;
-		vertexInputAttributes[2].location = 2;
-		vertexInputAttributes[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexInputAttributes[2].offset = 24;
-
-		// Vertex 0: TextureCoords
-		vertexInputAttributes[3].binding = 0;
-		vertexInputAttributes[3].location = 3;
-		vertexInputAttributes[3].format = VK_FORMAT_R32G32_SFLOAT;
-		vertexInputAttributes[3].offset = 36;
-
-		VkVertexInputBindingDescription vertexInputBinding = {};
-		vertexInputBinding.binding = 0;
-		vertexInputBinding.stride = sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2); // Size of entire vertex
-		vertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		ASSERT(m_Specification.Shader && m_Specification.RenderPass, "Pipeline requires a shader and a render pass");
+		const std::vector<VertexFormat>& vertexBuffers = m_Specification.VertexBuffers;
+
+		std::vector<VkVertexInputBindingDescription> vertexInputBindings(vertexBuffers.size());
+		for (uint32_t i = 0; i < vertexBuffers.size(); i++)
+		{
+			vertexInputBindings[i].binding = i;
+			vertexInputBindings[i].stride = vertexBuffers[i].GetStride();
+			vertexInputBindings[i].inputRate = vertexBuffers[i].GetInputRate();
+		}
+
+		// Every input the shader declares is fed from the first binding that has an element with its semantic
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes;
+		for (const ShaderVertexInput& input : m_Specification.Shader->GetVertexInputs())
+		{
+			VertexSemantic semantic = VertexFormat::GetSemantic(input.Name);
+
+			const VertexElement* element = nullptr;
+			uint32_t binding = 0;
+			for (; binding < vertexBuffers.size(); binding++)
+			{
+				element = vertexBuffers[binding].GetElement(semantic);
+				if (element)
+					break;
+			}
+
+			ASSERT(element, "No vertex buffer provides shader input " + input.Name);
+			ASSERT(element->Count == input.Columns, "Vertex element and shader input " + input.Name + " take up a different number of locations");
+
+			// Matrices take up one location per column
+			for (uint32_t column = 0; column < input.Columns; column++)
+			{
+				VkVertexInputAttributeDescription& attribute = vertexInputAttributes.emplace_back();
+				attribute.binding = binding;
+				attribute.location = input.Location + column;
+				attribute.format = element->Format;
+				attribute.offset = element->Offset + VertexFormat::GetFormatSize(element->Format) * column;
+			}
+		}
 
 		// Create vertex input
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &vertexInputBinding;
+		vertexInputInfo.vertexBindingDescriptionCount = vertexInputBindings.size();
+		vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings.data();
 		vertexInputInfo.vertexAttributeDescriptionCount = vertexInputAttributes.size();
 		vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes.data();
 
 		// Create input assembly
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		inputAssembly.topology = m_Specification.Topology;
 		inputAssembly.primitiveRestartEnable = VK_FALSE;
 
 		VkDevice device = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
@@ -103,10 +137,10 @@ namespace VKPlayground {
 		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 		rasterizer.depthClampEnable = VK_FALSE;
 		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.polygonMode = m_Specification.PolygonMode;
 		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_NONE;
-		rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		rasterizer.cullMode = m_Specification.CullMode;
+		rasterizer.frontFace = m_Specification.FrontFace;
 		rasterizer.depthBiasEnable = VK_FALSE;
 		rasterizer.depthBiasConstantFactor = 0.0f; // Optional
 		rasterizer.depthBiasClamp = 0.0f;          // Optional
@@ -125,7 +159,7 @@ namespace VKPlayground {
 		// Color blending attachment
 		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_TRUE;
+		colorBlendAttachment.blendEnable = m_Specification.BlendEnable ? VK_TRUE : VK_FALSE;
 		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;  // Optional
 		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA; // Optional
 		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;             // Optional
@@ -133,13 +167,16 @@ namespace VKPlayground {
 		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
 		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;             // Optional
 
-		// Color blend state (Disable color blending)
+		// Every color attachment shares the same blend state
+		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(m_Specification.ColorFormats.size(), colorBlendAttachment);
+
+		// Color blend state
 		VkPipelineColorBlendStateCreateInfo colorBlending{};
 		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 		colorBlending.logicOpEnable = VK_FALSE;
 		colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
+		colorBlending.attachmentCount = colorBlendAttachments.size();
+		colorBlending.pAttachments = colorBlendAttachments.data();
 		colorBlending.blendConstants[0] = 0.0f;   // Optional
 		colorBlending.blendConstants[1] = 0.0f;   // Optional
 		colorBlending.blendConstants[2] = 0.0f;   // Optional
@@ -158,7 +195,7 @@ namespace VKPlayground {
 		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		// Set pipeline layout
-		const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts = m_Shader->GetDescriptorSetLayouts();
+		const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts = m_Specification.Shader->GetDescriptorSetLayouts();
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -169,15 +206,14 @@ namespace VKPlayground {
 
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout));
 
-		const std::vector<VkPipelineShaderStageCreateInfo>& shaderCreateInfo = m_Shader->GetShaderCreateInfo();
-	//	VkRenderPass renderPass = swapChain->GetRenderPass();
-		VkRenderPass renderPass = m_RenderPass;
+		const std::vector<VkPipelineShaderStageCreateInfo>& shaderCreateInfo = m_Specification.Shader->GetShaderCreateInfo();
+		VkRenderPass renderPass = m_Specification.RenderPass;
 
 		VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
 		depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depthStencilState.depthTestEnable = VK_TRUE;
-		depthStencilState.depthWriteEnable = VK_TRUE;
-		depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		depthStencilState.depthTestEnable = m_Specification.DepthTest ? VK_TRUE : VK_FALSE;
+		depthStencilState.depthWriteEnable = m_Specification.DepthWrite ? VK_TRUE : VK_FALSE;
+		depthStencilState.depthCompareOp = m_Specification.DepthCompareOp;
 		depthStencilState.depthBoundsTestEnable = VK_FALSE;
 		depthStencilState.back.failOp = VK_STENCIL_OP_KEEP;
 		depthStencilState.back.passOp = VK_STENCIL_OP_KEEP;
@@ -204,7 +240,7 @@ namespace VKPlayground {
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 		pipelineInfo.basePipelineIndex = -1;              // Optional
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline));
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, PipelineCache::GetVulkanPipelineCache(), 1, &pipelineInfo, nullptr, &m_Pipeline));
 	}
 
 }
\ No newline at end of file
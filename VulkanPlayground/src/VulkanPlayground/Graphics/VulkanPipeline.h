@@ -1,18 +1,48 @@
 #pragma once
 #include "VulkanPlayground/Graphics/Shader.h"
+#include "VulkanPlayground/Graphics/VertexFormat.h"
 #include <vulkan/vulkan.h>
 
 namespace VKPlayground {
 
+	struct PipelineSpecification
+	{
+		Ref<VKPlayground::Shader> Shader;
+
+		// One format per vertex buffer binding, the attributes are whatever the shader's vertex inputs ask for
+		std::vector<VertexFormat> VertexBuffers;
+
+		VkPrimitiveTopology Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkPolygonMode PolygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags CullMode = VK_CULL_MODE_NONE;
+		VkFrontFace FrontFace = VK_FRONT_FACE_CLOCKWISE;
+
+		bool DepthTest = true;
+		bool DepthWrite = true;
+		VkCompareOp DepthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		bool BlendEnable = true;
+
+		// Render pass format signature, RenderPass only has to be compatible with these formats
+		std::vector<VkFormat> ColorFormats;
+		VkFormat DepthFormat = VK_FORMAT_UNDEFINED;
+		VkRenderPass RenderPass = nullptr;
+
+		// Covers everything above except the render pass handle, so compatible passes share pipelines.
+		// A null shader hashes as zero, which is how requests are keyed before their shader is compiled.
+		uint64_t GetHash() const;
+	};
+
 	class VulkanPipeline
 	{
 	public:
-		VulkanPipeline(Ref<Shader> shader, VkRenderPass renderPass);
+		VulkanPipeline(const PipelineSpecification& specification);
 		~VulkanPipeline();
 
 	public:
 		inline VkPipeline GetPipeline() { return m_Pipeline; }
 		inline VkPipelineLayout GetPipelineLayout() { return m_PipelineLayout; }
+		inline const PipelineSpecification& GetSpecification() const { return m_Specification; }
 
 	private:
 		void Init();
@@ -21,8 +51,7 @@ namespace VKPlayground {
 		VkPipeline m_Pipeline = nullptr;
 		VkPipelineLayout m_PipelineLayout = nullptr;
 
-		Ref<Shader> m_Shader;
-		VkRenderPass m_RenderPass;
+		PipelineSpecification m_Specification;
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,289 @@
+#include "pch.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanAllocator.h"
+#include "VulkanPlayground/Core/Application.h"
+#include "VulkanPlayground/Core/VulkanTools.h"
+#include <mutex>
+
+namespace VKPlayground {
+
+	static const VkDeviceSize s_StagingChunkSize = 8 * 1024 * 1024;
+	static const VkDeviceSize s_StagingAlignment = 16;
+
+	struct StagingChunk
+	{
+		VkBuffer Buffer = nullptr;
+		VmaAllocation Allocation = nullptr;
+		uint8_t* Data = nullptr;
+		VkDeviceSize Size = 0;
+		VkDeviceSize Offset = 0;
+	};
+
+	struct PendingCopy
+	{
+		VkBuffer SrcBuffer;
+		VkBuffer DstBuffer;
+		VkBufferCopy Region;
+	};
+
+	// Staging memory and command buffer for one submission, reused once its fence is signaled
+	struct UploadFrame
+	{
+		VkCommandPool CommandPool = nullptr;
+		VkCommandBuffer CommandBuffer = nullptr;
+		VkFence Fence = nullptr;
+		bool Submitted = false;
+
+		std::vector<StagingChunk> Chunks;
+	};
+
+	struct VulkanUploadQueueData
+	{
+		Ref<VulkanDevice> Device;
+
+		std::vector<UploadFrame> Frames;
+		uint32_t FrameIndex = 0;
+
+		std::vector<PendingCopy> PendingCopies;
+		VkDeviceSize PendingBytes = 0;
+
+		std::mutex Mutex;
+	};
+
+	static VulkanUploadQueueData* s_Data = nullptr;
+
+	namespace Utils {
+
+		static UploadFrame& AcquireFrame()
+		{
+			UploadFrame& frame = s_Data->Frames[s_Data->FrameIndex];
+
+			// The first upload into a frame after it was submitted has to wait for the GPU to finish reading its staging memory
+			if (frame.Submitted)
+			{
+				VkDevice device = s_Data->Device->GetLogicalDevice();
+				VK_CHECK_RESULT(vkWaitForFences(device, 1, &frame.Fence, VK_TRUE, UINT64_MAX));
+				VK_CHECK_RESULT(vkResetCommandPool(device, frame.CommandPool, 0));
+
+				for (StagingChunk& chunk : frame.Chunks)
+				{
+					chunk.Offset = 0;
+				}
+
+				frame.Submitted = false;
+			}
+
+			return frame;
+		}
+
+		static StagingChunk& AllocateStaging(UploadFrame& frame, VkDeviceSize size, VkDeviceSize& outOffset)
+		{
+			for (StagingChunk& chunk : frame.Chunks)
+			{
+				VkDeviceSize offset = (chunk.Offset + s_StagingAlignment - 1) & ~(s_StagingAlignment - 1);
+				if (offset + size <= chunk.Size)
+				{
+					chunk.Offset = offset + size;
+					outOffset = offset;
+					return chunk;
+				}
+			}
+
+			// No room left, create a new chunk that is kept around for future uploads
+			StagingChunk& chunk = frame.Chunks.emplace_back();
+			chunk.Size = std::max(size, s_StagingChunkSize);
+
+			VkBufferCreateInfo bufferCreateInfo = {};
+			bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferCreateInfo.size = chunk.Size;
+			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VulkanAllocator allocator("StagingBuffer");
+			chunk.Allocation = allocator.AllocateBuffer(bufferCreateInfo, VMA_MEMORY_USAGE_CPU_ONLY, chunk.Buffer);
+			chunk.Data = allocator.MapMemory<uint8_t>(chunk.Allocation);
+			chunk.Offset = size;
+
+			outOffset = 0;
+			return chunk;
+		}
+
+	}
+
+	void* VulkanUploadQueue::StageBuffer(VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		UploadFrame& frame = Utils::AcquireFrame();
+
+		VkDeviceSize srcOffset = 0;
+		StagingChunk& chunk = Utils::AllocateStaging(frame, size, srcOffset);
+
+		PendingCopy& copy = s_Data->PendingCopies.emplace_back();
+		copy.SrcBuffer = chunk.Buffer;
+		copy.DstBuffer = dstBuffer;
+		copy.Region.srcOffset = srcOffset;
+		copy.Region.dstOffset = dstOffset;
+		copy.Region.size = size;
+
+		s_Data->PendingBytes += size;
+
+		return chunk.Data + srcOffset;
+	}
+
+	void VulkanUploadQueue::UploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+	{
+		void* staging = StageBuffer(dstBuffer, size, dstOffset);
+		memcpy(staging, data, size);
+	}
+
+	void VulkanUploadQueue::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		PendingCopy& copy = s_Data->PendingCopies.emplace_back();
+		copy.SrcBuffer = srcBuffer;
+		copy.DstBuffer = dstBuffer;
+		copy.Region.srcOffset = srcOffset;
+		copy.Region.dstOffset = dstOffset;
+		copy.Region.size = size;
+
+		s_Data->PendingBytes += size;
+	}
+
+	void VulkanUploadQueue::Discard(VkBuffer dstBuffer)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		auto& copies = s_Data->PendingCopies;
+		copies.erase(std::remove_if(copies.begin(), copies.end(), [dstBuffer](const PendingCopy& copy) { return copy.DstBuffer == dstBuffer; }), copies.end());
+	}
+
+	void VulkanUploadQueue::Discard(VkBuffer dstBuffer, VkDeviceSize offset, VkDeviceSize size)
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		auto& copies = s_Data->PendingCopies;
+		copies.erase(std::remove_if(copies.begin(), copies.end(), [=](const PendingCopy& copy)
+		{
+			return copy.DstBuffer == dstBuffer && copy.Region.dstOffset < offset + size && offset < copy.Region.dstOffset + copy.Region.size;
+		}), copies.end());
+	}
+
+	void VulkanUploadQueue::Flush()
+	{
+		std::lock_guard<std::mutex> lock(s_Data->Mutex);
+
+		if (s_Data->PendingCopies.empty())
+			return;
+
+		VkDevice device = s_Data->Device->GetLogicalDevice();
+		UploadFrame& frame = s_Data->Frames[s_Data->FrameIndex];
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(frame.CommandBuffer, &beginInfo));
+
+		// Merge consecutive copies between the same pair of buffers into one command
+		std::vector<VkBufferCopy> regions;
+		const auto& copies = s_Data->PendingCopies;
+		for (size_t i = 0; i < copies.size(); i++)
+		{
+			regions.push_back(copies[i].Region);
+
+			bool lastInRun = i + 1 == copies.size() || copies[i + 1].SrcBuffer != copies[i].SrcBuffer || copies[i + 1].DstBuffer != copies[i].DstBuffer;
+			if (lastInRun)
+			{
+				vkCmdCopyBuffer(frame.CommandBuffer, copies[i].SrcBuffer, copies[i].DstBuffer, (uint32_t)regions.size(), regions.data());
+				regions.clear();
+			}
+		}
+
+		// Make the copies visible to everything submitted after this, the buffers can be used by any stage
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(frame.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(frame.CommandBuffer));
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.CommandBuffer;
+
+		VK_CHECK_RESULT(vkResetFences(device, 1, &frame.Fence));
+		VK_CHECK_RESULT(vkQueueSubmit(s_Data->Device->GetGraphicsQueue(), 1, &submitInfo, frame.Fence));
+
+		LOG_TRACE("Flushed {0} buffer uploads ({1} bytes)", copies.size(), s_Data->PendingBytes);
+
+		frame.Submitted = true;
+		s_Data->FrameIndex = (s_Data->FrameIndex + 1) % s_Data->Frames.size();
+		s_Data->PendingCopies.clear();
+		s_Data->PendingBytes = 0;
+	}
+
+	void VulkanUploadQueue::Init(Ref<VulkanDevice> device)
+	{
+		s_Data = new VulkanUploadQueueData();
+		s_Data->Device = device;
+
+		VkDevice logicalDevice = device->GetLogicalDevice();
+		uint32_t framesInFlight = Application::GetApp().GetVulkanSwapChain()->GetFramesInFlight();
+
+		s_Data->Frames.resize(framesInFlight);
+		for (UploadFrame& frame : s_Data->Frames)
+		{
+			// Create command pool
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = device->GetQueueIndices().GraphicsQueue.value();
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			VK_CHECK_RESULT(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &frame.CommandPool));
+
+			// Create command buffer
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &frame.CommandBuffer));
+
+			// Create fence
+			VkFenceCreateInfo fenceInfo{};
+			fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			VK_CHECK_RESULT(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &frame.Fence));
+		}
+
+		LOG_INFO("Initialized Vulkan upload queue");
+	}
+
+	void VulkanUploadQueue::Shutdown()
+	{
+		VkDevice device = s_Data->Device->GetLogicalDevice();
+		VulkanAllocator allocator("StagingBuffer");
+
+		for (UploadFrame& frame : s_Data->Frames)
+		{
+			if (frame.Submitted)
+			{
+				VK_CHECK_RESULT(vkWaitForFences(device, 1, &frame.Fence, VK_TRUE, UINT64_MAX));
+			}
+
+			for (StagingChunk& chunk : frame.Chunks)
+			{
+				allocator.UnmapMemory(chunk.Allocation);
+				allocator.DestroyBuffer(chunk.Buffer, chunk.Allocation);
+			}
+
+			vkDestroyFence(device, frame.Fence, nullptr);
+			vkDestroyCommandPool(device, frame.CommandPool, nullptr);
+		}
+
+		delete s_Data;
+		s_Data = nullptr;
+	}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "VulkanPlayground/Core/Core.h"
+#include "VulkanDevice.h"
+#include <vulkan/vulkan.h>
+
+namespace VKPlayground {
+
+	// Batches buffer uploads through persistently mapped staging memory and submits them once per frame
+	class VulkanUploadQueue
+	{
+	public:
+		// Returns staging memory for the caller to fill, it is copied into dstBuffer on the next Flush
+		static void* StageBuffer(VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+		static void UploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+		// Queues a copy between two device buffers, the regions must not overlap and srcBuffer needs TRANSFER_SRC usage
+		static void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset);
+
+		// Drops pending copies into a buffer that is about to be destroyed
+		static void Discard(VkBuffer dstBuffer);
+
+		// Drops pending copies into a range of a buffer that is handed out again
+		static void Discard(VkBuffer dstBuffer, VkDeviceSize offset, VkDeviceSize size);
+
+		// Records all pending copies into one command buffer and submits it to the graphics queue
+		static void Flush();
+
+	public:
+		static void Init(Ref<VulkanDevice> device);
+		static void Shutdown();
+	};
+
+}
@@ -18,7 +18,11 @@ namespace VKPlayground {
 	{
 		m_Camera = CreateRef<Camera>(glm::perspectiveFov(glm::radians(45.0f), 1280.0f, 720.0f, 0.1f, 100.0f));
 		m_Mesh = CreateRef<Mesh>("assets/models/Cube.gltf");
+		m_Texture = CreateRef<Texture2D>("assets/textures/ChernoLogo.png");
 		m_MeshTransform = glm::mat4(1.0f);
+
+		// Compiles in the background, the cube using it is drawn with the default pipeline until it is ready
+		m_FlatPipeline = Application::GetApp().GetRenderer()->LoadPipeline("assets/shaders/flat.shader");
 	}
 
 	void ViewerLayer::Update()
@@ -32,15 +36,9 @@ namespace VKPlayground {
 
 		renderer->BeginScene(m_Camera);
 
-		renderer->BeginRenderPass(renderer->GetFramebuffer());
 		renderer->SubmitMesh(m_Mesh, m_MeshTransform);
-		renderer->SubmitMesh(m_Mesh, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 3.0f)));
-		renderer->Render();
-		renderer->EndRenderPass();
-
-		renderer->BeginRenderPass();
-		renderer->RenderUI();
-		renderer->EndRenderPass();
+		renderer->SubmitMesh(m_Mesh, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 3.0f)), m_Texture);
+		renderer->SubmitMesh(m_Mesh, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f)), nullptr, m_FlatPipeline);
 
 		renderer->EndScene();
 	}
@@ -51,12 +49,12 @@ namespace VKPlayground {
 
 		ImGui::Begin("Viewport");
 
-		auto& descriptorInfo = renderer->GetFramebuffer()->GetImage(0)->GetDescriptorImageInfo();
+		auto& descriptorInfo = renderer->GetOutputImage()->GetDescriptorImageInfo();
 		ImTextureID imTex = ImGui_ImplVulkan_AddTexture(descriptorInfo.sampler, descriptorInfo.imageView, descriptorInfo.imageLayout);
 
-		const auto& fbSpec = renderer->GetFramebuffer()->GetSpecification();
+		const auto& imageSpec = renderer->GetOutputImage()->GetSpecification();
 		float width = ImGui::GetContentRegionAvail().x;
-		float aspect = (float)fbSpec.Height / (float)fbSpec.Width;
+		float aspect = (float)imageSpec.Height / (float)imageSpec.Width;
 
 		ImGui::Image(imTex, { width, width * aspect }, ImVec2(0, 1), ImVec2(1, 0));
 
@@ -2,6 +2,8 @@
 #include "VulkanPlayground/Core/Layer.h"
 #include "VulkanPlayground/Graphics/Camera.h"
 #include "VulkanPlayground/Graphics/Mesh.h"
+#include "VulkanPlayground/Graphics/Texture.h"
+#include "VulkanPlayground/Graphics/PipelineCache.h"
 #include <glm/gtc/type_ptr.hpp>
 
 namespace VKPlayground {
@@ -21,6 +23,8 @@ namespace VKPlayground {
 	private:
 		Ref<Camera> m_Camera;
 		Ref<Mesh> m_Mesh;
+		Ref<Texture2D> m_Texture;
+		Ref<AsyncPipeline> m_FlatPipeline;
 		glm::mat4 m_MeshTransform;
 	};
 
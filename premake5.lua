@@ -89,4 +89,103 @@ project "VulkanPlayground"
 
 	filter "configurations:Release"
 		runtime "Release"
-		optimize "On"
\ No newline at end of file
+		optimize "On"
+
+project "MeshCooker"
+	location "MeshCooker"
+	kind "ConsoleApp"
+	language "C++"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin/intermediates/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"%{prj.name}/src/**.cpp",
+		"%{prj.name}/src/**.h",
+		-- Engine code shared with the runtime, none of it calls into Vulkan
+		"VulkanPlayground/src/VulkanPlayground/Core/Log.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Core/JobSystem.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Core/MappedFile.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Graphics/VertexFormat.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Graphics/MeshImporter.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Graphics/MeshOptimizer.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Graphics/MeshFile.cpp",
+		-- STB
+		"VulkanPlayground/vendor/stb/**.cpp",
+		"VulkanPlayground/vendor/stb/**.h",
+		-- TinyGltf
+		"VulkanPlayground/vendor/tinygltf/**.cpp",
+		"VulkanPlayground/vendor/tinygltf/**.hpp",
+		"VulkanPlayground/vendor/tinygltf/**.h",
+	}
+
+	includedirs
+	{
+		"VulkanPlayground/src",
+		"VulkanPlayground/vendor",
+		"%{IncludeDir.VulkanSDK}",
+		"%{IncludeDir.glm}",
+		"%{IncludeDir.spdlog}",
+		"%{IncludeDir.stb_image}",
+	}
+
+	filter "system:windows"
+		cppdialect "C++17"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "On"
+
+	defines 
+	{
+		"ENABLE_ASSERTS"
+	}
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "On"
+
+project "CullingBenchmark"
+	location "CullingBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin/intermediates/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"%{prj.name}/src/**.cpp",
+		"%{prj.name}/src/**.h",
+		-- Engine code under test, culling only depends on glm
+		"VulkanPlayground/src/VulkanPlayground/Core/Log.cpp",
+		"VulkanPlayground/src/VulkanPlayground/Graphics/Culling.cpp",
+	}
+
+	includedirs
+	{
+		"VulkanPlayground/src",
+		"%{IncludeDir.glm}",
+		"%{IncludeDir.spdlog}",
+	}
+
+	filter "system:windows"
+		cppdialect "C++17"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "On"
+
+	defines 
+	{
+		"ENABLE_ASSERTS"
+	}
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "On"